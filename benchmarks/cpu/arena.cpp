@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include "bm_config.hpp"
+#include "core/arena.hpp"
+#include "core/thread_pool.hpp"
+#include "host/fused_pipeline.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// The fused pipeline on 'new[]' arrays vs. a 'core::arena' with plain pages,
+// transparent huge pages and explicit huge pages, at the default size and the
+// 10M-point config. Where perf events are readable, 'dtlb_misses' counts the
+// data TLB load misses of all pool threads per iteration.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// range(1) of the benchmarks
+enum Memory { kHeap, kArenaPlain, kArenaTransparent, kArenaExplicit };
+
+std::optional<core::arena_options> memory_options(const int memory) {
+  switch (memory) {
+    case kArenaPlain:
+      return core::arena_options{core::huge_pages::kNone};
+    case kArenaTransparent:
+      return core::arena_options{core::huge_pages::kTransparent};
+    case kArenaExplicit:
+      return core::arena_options{core::huge_pages::kExplicit};
+    default:
+      return std::nullopt;
+  }
+}
+
+// Data TLB load misses of the calling thread and every thread it starts
+// afterwards. The counts of those threads only arrive once they exit.
+class dtlb_counter {
+ public:
+  dtlb_counter() {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~dtlb_counter() {
+#if defined(__linux__)
+    if (fd >= 0) close(fd);
+#endif
+  }
+
+  [[nodiscard]] bool valid() const { return fd >= 0; }
+
+  void enable(const bool on) const {
+#if defined(__linux__)
+    if (fd >= 0) {
+      ioctl(fd, on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+  }
+
+  [[nodiscard]] long long read_count() const {
+    long long count = 0;
+#if defined(__linux__)
+    if (fd >= 0 && read(fd, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+#endif
+    return count;
+  }
+
+ private:
+  int fd = -1;
+};
+
+void gen_points(Pipe& p, const unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution dis(
+      Config::DEFAULT_MIN_COORD,
+      Config::DEFAULT_MIN_COORD + Config::DEFAULT_RANGE);
+  std::generate_n(p.u_points, p.n_input(), [&dis, &gen] {
+    return glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f);
+  });
+}
+
+}  // namespace
+
+static void BM_FusedMemory(benchmark::State& state) {
+  const auto n = static_cast<int>(state.range(0));
+  const auto memory = static_cast<int>(state.range(1));
+  const auto n_threads = static_cast<int>(std::thread::hardware_concurrency());
+
+  const auto p = std::make_shared<Pipe>(n,
+                                        Config::DEFAULT_MIN_COORD,
+                                        Config::DEFAULT_RANGE,
+                                        Config::DEFAULT_SEED,
+                                        memory_options(memory));
+
+  // opened before the pool, so its workers inherit it
+  const dtlb_counter tlb;
+  {
+    core::thread_pool pool(n_threads);
+    cpu::dispatch_FirstTouch(pool, n_threads, p);
+    gen_points(*p, Config::DEFAULT_SEED);
+    // the octree is sized (and touched) by its first build
+    cpu::run_fused_pipeline(pool, n_threads, p);
+
+    tlb.enable(true);
+    for (auto _ : state) {
+      cpu::run_fused_pipeline(pool, n_threads, p);
+    }
+    tlb.enable(false);
+  }
+
+  if (tlb.valid()) {
+    state.counters["dtlb_misses"] = benchmark::Counter(
+        static_cast<double>(tlb.read_count()),
+        benchmark::Counter::kAvgIterations);
+  }
+  if (p->arena != nullptr) {
+    state.counters["mapped_mb"] =
+        static_cast<double>(p->arena->bytes_mapped()) / (1 << 20);
+  }
+}
+
+BENCHMARK(BM_FusedMemory)
+    ->ArgNames({"n", "memory"})
+    ->ArgsProduct({{Config::DEFAULT_N, Config::LARGE_N},
+                   {kHeap, kArenaPlain, kArenaTransparent, kArenaExplicit}})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS / 4);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
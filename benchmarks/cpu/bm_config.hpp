@@ -11,13 +11,15 @@ namespace {
 
 struct Config {
   static constexpr int DEFAULT_N = 640 * 480;  // ~300k
+  static constexpr int LARGE_N = 10'000'000;   // the 10M-point config
   static constexpr float DEFAULT_MIN_COORD = 0.0f;
   static constexpr float DEFAULT_RANGE = 1024.0f;
   static constexpr unsigned DEFAULT_SEED = 114514;
   static constexpr int DEFAULT_ITERATIONS = 40;
 };
 
-inline void gen_data(const std::shared_ptr<Pipe>& p, unsigned seed) {
+template <typename Key>
+void gen_data(const std::shared_ptr<BasicPipe<Key>>& p, unsigned seed) {
   std::mt19937 gen(seed);
   std::uniform_real_distribution dis(
       Config::DEFAULT_MIN_COORD,
@@ -27,4 +29,20 @@ inline void gen_data(const std::shared_ptr<Pipe>& p, unsigned seed) {
   });
 }
 
+// Copies 'u_points' into the arrays of the pipe's active point layout, so
+// every layout encodes the same data.
+template <typename Key>
+void fill_point_layout(const std::shared_ptr<BasicPipe<Key>>& p) {
+  for (int i = 0; i < p->n_input(); ++i) {
+    const auto& point = p->u_points[i];
+    if (p->point_layout == shared::PointLayout::kSoA) {
+      p->u_xs[i] = point.x;
+      p->u_ys[i] = point.y;
+      p->u_zs[i] = point.z;
+    } else if (p->point_layout == shared::PointLayout::kPacked3) {
+      p->u_points3[i] = glm::vec3(point);
+    }
+  }
+}
+
 }  // namespace
@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/frame_pipeline.hpp"
+#include "shared/structures.h"
+#include "utils.hpp"
+
+// ----------------------------------------------------------------------------
+// Multi-frame pipelining: 'cpu::run_frame_pipeline' with K = 1 (frames back
+// to back) up to 3 pipes in flight. The morton/sort half runs on the upper
+// half of the available cores (the big cores on most phones), the tree half
+// on the lower half. Reports steady-state frames/sec and per-frame latency.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+constexpr int kFramesPerRun = Config::DEFAULT_ITERATIONS;
+
+// the lower and upper half of the cores, the same core twice if only one
+std::pair<std::vector<int>, std::vector<int>> split_cores() {
+  const auto cores = utils::get_available_cores();
+  if (cores.size() < 2) return {cores, cores};
+  const auto mid = cores.begin() + cores.size() / 2;
+  return {{cores.begin(), mid}, {mid, cores.end()}};
+}
+
+}  // namespace
+
+class CPU_Frames : public benchmark::Fixture {
+ public:
+  explicit CPU_Frames()
+      : source(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                      Config::DEFAULT_MIN_COORD,
+                                      Config::DEFAULT_RANGE,
+                                      Config::DEFAULT_SEED)),
+        little(split_cores().first, true),
+        big(split_cores().second, true) {
+    gen_data(source, Config::DEFAULT_SEED);
+  }
+
+  std::shared_ptr<Pipe> source;
+  core::thread_pool little;
+  core::thread_pool big;
+};
+
+BENCHMARK_DEFINE_F(CPU_Frames, BM_FramePipeline)(benchmark::State& state) {
+  const auto k = static_cast<int>(state.range(0));
+
+  std::vector<std::shared_ptr<Pipe>> pipes;
+  for (int i = 0; i < k; ++i) {
+    pipes.push_back(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                           Config::DEFAULT_MIN_COORD,
+                                           Config::DEFAULT_RANGE,
+                                           Config::DEFAULT_SEED));
+  }
+  const cpu::FillFrame fill = [this](Pipe& p, int) {
+    std::copy_n(source->u_points, p.n_input(), p.u_points);
+  };
+
+  const cpu::StageCluster<core::thread_pool> front{
+      big, static_cast<int>(big.get_thread_count())};
+  const cpu::StageCluster<core::thread_pool> back{
+      little, static_cast<int>(little.get_thread_count())};
+
+  double fps = 0.0;
+  double latency = 0.0;
+  double max_latency = 0.0;
+  for (auto _ : state) {
+    const auto stats =
+        cpu::run_frame_pipeline(front, back, pipes, kFramesPerRun, fill);
+    fps += stats.frames_per_sec;
+    latency += stats.mean_latency_ms;
+    max_latency = std::max(max_latency, stats.max_latency_ms);
+  }
+
+  const auto avg = [](const double v) {
+    return benchmark::Counter(v, benchmark::Counter::kAvgIterations);
+  };
+  state.counters["frames_per_sec"] = avg(fps);
+  state.counters["latency_ms"] = avg(latency);
+  state.counters["max_latency_ms"] = max_latency;
+}
+
+BENCHMARK_REGISTER_F(CPU_Frames, BM_FramePipeline)
+    ->ArgName("in_flight")
+    ->DenseRange(1, 3, 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(3);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
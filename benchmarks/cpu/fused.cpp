@@ -0,0 +1,197 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/fused_pipeline.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+
+// ----------------------------------------------------------------------------
+// Staged (seven dispatch_* calls) vs. fused (cpu::run_fused_pipeline) pipeline.
+// Both report the same per-phase counters, in ms per iteration, so the stages
+// that were fused can be compared directly.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+double ms_since(clock::time_point& last) {
+  const auto now = clock::now();
+  const std::chrono::duration<double, std::milli> elapsed = now - last;
+  last = now;
+  return elapsed.count();
+}
+
+void report(benchmark::State& state, const cpu::PipelineTimings& sum) {
+  const auto avg = [](const double ms) {
+    return benchmark::Counter(ms, benchmark::Counter::kAvgIterations);
+  };
+  state.counters["morton_ms"] = avg(sum.morton_ms);
+  state.counters["sort_unique_ms"] = avg(sum.sort_unique_ms);
+  state.counters["radix_tree_ms"] = avg(sum.radix_tree_ms);
+  state.counters["edge_ms"] = avg(sum.edge_ms);
+  state.counters["octree_ms"] = avg(sum.octree_ms);
+  state.counters["total_ms"] = avg(sum.total_ms);
+}
+
+}  // namespace
+
+class CPU_Fused : public benchmark::Fixture {
+ public:
+  explicit CPU_Fused()
+      : p(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                 Config::DEFAULT_MIN_COORD,
+                                 Config::DEFAULT_RANGE,
+                                 Config::DEFAULT_SEED)),
+        pool(std::thread::hardware_concurrency()) {
+    gen_data(p, Config::DEFAULT_SEED);
+  }
+
+  std::shared_ptr<Pipe> p;
+  core::thread_pool pool;
+};
+
+BENCHMARK_DEFINE_F(CPU_Fused, BM_Staged)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  cpu::PipelineTimings sum;
+  for (auto _ : state) {
+    cpu::PipelineTimings t;
+    const auto start = clock::now();
+    auto last = start;
+
+    cpu::dispatch_MortonCode(pool, n_threads, p);
+    t.morton_ms = ms_since(last);
+    cpu::dispatch_RadixSort(pool, n_threads, p);
+    cpu::dispatch_RemoveDuplicates(pool, n_threads, p);
+    t.sort_unique_ms = ms_since(last);
+    cpu::dispatch_BuildRadixTree(pool, n_threads, p);
+    t.radix_tree_ms = ms_since(last);
+    cpu::dispatch_EdgeCount(pool, n_threads, p);
+    cpu::dispatch_EdgeOffset(pool, n_threads, p);
+    t.edge_ms = ms_since(last);
+    cpu::dispatch_BuildOctree(pool, n_threads, p);
+    t.octree_ms = ms_since(last);
+
+    t.total_ms =
+        std::chrono::duration<double, std::milli>(last - start).count();
+    sum += t;
+  }
+  report(state, sum);
+}
+
+BENCHMARK_DEFINE_F(CPU_Fused, BM_Fused)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  cpu::PipelineTimings sum;
+  for (auto _ : state) {
+    cpu::PipelineTimings t;
+    cpu::run_fused_pipeline(pool, n_threads, p, &t);
+    sum += t;
+  }
+  report(state, sum);
+}
+
+BENCHMARK_REGISTER_F(CPU_Fused, BM_Staged)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK_REGISTER_F(CPU_Fused, BM_Fused)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+// ----------------------------------------------------------------------------
+// Streaming frames of varying size: a new 'Pipe' per frame vs. one 'Pipe'
+// that is reset for every frame and only grows when a frame exceeds it.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// between 60% and 100% of 'DEFAULT_N', so frames both shrink and grow
+constexpr int kFrameSizes[] = {
+    Config::DEFAULT_N * 6 / 10,
+    Config::DEFAULT_N * 9 / 10,
+    Config::DEFAULT_N * 7 / 10,
+    Config::DEFAULT_N,
+    Config::DEFAULT_N * 8 / 10,
+};
+constexpr int kNumFrameSizes = sizeof(kFrameSizes) / sizeof(kFrameSizes[0]);
+
+}  // namespace
+
+class CPU_Stream : public benchmark::Fixture {
+ public:
+  explicit CPU_Stream()
+      : source(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                      Config::DEFAULT_MIN_COORD,
+                                      Config::DEFAULT_RANGE,
+                                      Config::DEFAULT_SEED)),
+        pool(std::thread::hardware_concurrency()) {
+    gen_data(source, Config::DEFAULT_SEED);
+  }
+
+  // the first 'n' points of 'source' are the frame
+  void fill_frame(Pipe& p, const int n) const {
+    std::copy_n(source->u_points, n, p.u_points);
+  }
+
+  std::shared_ptr<Pipe> source;
+  core::thread_pool pool;
+};
+
+BENCHMARK_DEFINE_F(CPU_Stream, BM_StreamReconstruct)
+(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  int frame = 0;
+  for (auto _ : state) {
+    const auto n = kFrameSizes[frame++ % kNumFrameSizes];
+    const auto p = std::make_shared<Pipe>(n,
+                                          Config::DEFAULT_MIN_COORD,
+                                          Config::DEFAULT_RANGE,
+                                          Config::DEFAULT_SEED);
+    fill_frame(*p, n);
+    cpu::run_fused_pipeline(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_DEFINE_F(CPU_Stream, BM_StreamReset)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  // starts small, so the first frames also exercise the growth
+  const auto p = std::make_shared<Pipe>(kFrameSizes[0],
+                                        Config::DEFAULT_MIN_COORD,
+                                        Config::DEFAULT_RANGE,
+                                        Config::DEFAULT_SEED);
+  int frame = 0;
+  for (auto _ : state) {
+    const auto n = kFrameSizes[frame++ % kNumFrameSizes];
+    p->reset(n);
+    fill_frame(*p, n);
+    cpu::run_fused_pipeline(pool, n_threads, p);
+  }
+  state.counters["capacity"] = static_cast<double>(p->capacity);
+}
+
+BENCHMARK_REGISTER_F(CPU_Stream, BM_StreamReconstruct)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK_REGISTER_F(CPU_Stream, BM_StreamReset)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bm_config.hpp"
+#include "configs.hpp"
+#include "core/thread_pool.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+#include "third-party/CLI11.hpp"
+#include "utils.hpp"
+
+// ----------------------------------------------------------------------------
+// The staged pipeline on one cluster (the fastest one of '--device') vs. a
+// pool pinned to every cluster, with the 'submit_blocks' range cut into
+// equal blocks, blocks sized by the 'PhoneSpecs' clocks, blocks sized by a
+// calibration run, and dynamically claimed chunks.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// range(0) of the benchmark
+enum Schedule {
+  kClusterOnly,
+  kAllEqual,
+  kAllFrequency,
+  kAllCalibrated,
+  kAllDynamic
+};
+
+const PhoneSpecs* g_specs = nullptr;
+std::vector<int> g_cluster_cores;
+std::vector<int> g_all_cores;
+
+// the clocks of 'PhoneSpecs', or the ones the pool reads if any is unknown
+std::vector<double> spec_weights(const core::thread_pool& pool,
+                                 const std::vector<int>& cores) {
+  std::vector<double> weights;
+  for (const int core : cores) {
+    const double ghz = get_core_frequency(*g_specs, core);
+    if (ghz <= 0.0) return pool.frequency_weights();
+    weights.push_back(ghz);
+  }
+  return weights;
+}
+
+void run_stages(core::thread_pool& pool,
+                const int n_threads,
+                const std::shared_ptr<Pipe>& p) {
+  cpu::dispatch_MortonCode(pool, n_threads, p);
+  cpu::dispatch_RadixSort(pool, n_threads, p);
+  cpu::dispatch_RemoveDuplicates(pool, n_threads, p);
+  cpu::dispatch_BuildRadixTree(pool, n_threads, p);
+  cpu::dispatch_EdgeCount(pool, n_threads, p);
+  cpu::dispatch_EdgeOffset(pool, n_threads, p);
+  cpu::dispatch_BuildOctree(pool, n_threads, p);
+}
+
+}  // namespace
+
+static void BM_Schedule(benchmark::State& state) {
+  const auto schedule = static_cast<Schedule>(state.range(0));
+  const auto& cores =
+      schedule == kClusterOnly ? g_cluster_cores : g_all_cores;
+  const auto n_threads = static_cast<int>(cores.size());
+
+  const auto p = std::make_shared<Pipe>(Config::DEFAULT_N,
+                                        Config::DEFAULT_MIN_COORD,
+                                        Config::DEFAULT_RANGE,
+                                        Config::DEFAULT_SEED);
+  gen_data(p, Config::DEFAULT_SEED);
+
+  core::thread_pool pool(cores, true);
+  switch (schedule) {
+    case kAllFrequency:
+      pool.set_worker_weights(spec_weights(pool, cores));
+      pool.set_partition(core::thread_pool::partition::kWeighted);
+      break;
+    case kAllCalibrated:
+      pool.set_worker_weights(pool.calibrate_weights());
+      pool.set_partition(core::thread_pool::partition::kWeighted);
+      break;
+    case kAllDynamic:
+      pool.set_partition(core::thread_pool::partition::kDynamic);
+      break;
+    default:
+      break;
+  }
+
+  // the octree is sized by its first build
+  run_stages(pool, n_threads, p);
+
+  for (auto _ : state) {
+    run_stages(pool, n_threads, p);
+  }
+  state.counters["threads"] = n_threads;
+}
+
+BENCHMARK(BM_Schedule)
+    ->ArgName("schedule")
+    ->DenseRange(kClusterOnly, kAllDynamic, 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+int main(int argc, char** argv) {
+  CLI::App app("Heterogeneous scheduling benchmark");
+
+  std::string device;
+  app.add_option("--device", device, "Device ID")->default_val("jetson");
+  app.allow_extras();
+  CLI11_PARSE(app, argc, argv);
+
+  const auto phone_specs = get_phone_specs(device);
+  if (!phone_specs) {
+    std::cerr << "Failed to get phone specs" << std::endl;
+    return 1;
+  }
+  g_specs = phone_specs.value();
+
+  // the fastest cluster with a core we may run on
+  for (const auto* cluster :
+       {&g_specs->big_cores, &g_specs->mid_cores, &g_specs->small_cores}) {
+    const auto valid = utils::get_valid_cores(*cluster);
+    if (g_cluster_cores.empty()) g_cluster_cores = valid;
+    g_all_cores.insert(g_all_cores.end(), valid.begin(), valid.end());
+  }
+  if (g_all_cores.empty()) {
+    std::cerr << "No valid cores found" << std::endl;
+    return 1;
+  }
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+
+// ----------------------------------------------------------------------------
+// 32-bit ('Pipe') vs. 64-bit ('Pipe64') morton codes, stage by stage. The
+// 64-bit keys double the bytes every pass moves and the sort takes up to six
+// digits instead of three, the tree stages are mostly unaffected.
+// ----------------------------------------------------------------------------
+
+template <typename P>
+class CPU_Keys : public benchmark::Fixture {
+ public:
+  explicit CPU_Keys()
+      : p(std::make_shared<P>(Config::DEFAULT_N,
+                              Config::DEFAULT_MIN_COORD,
+                              Config::DEFAULT_RANGE,
+                              Config::DEFAULT_SEED)),
+        pool(std::thread::hardware_concurrency()) {
+    gen_data(p, Config::DEFAULT_SEED);
+
+    const auto n_max_threads = static_cast<int>(pool.get_thread_count());
+
+    // basically pregenerate the data
+    cpu::dispatch_MortonCode(pool, n_max_threads, p);
+    cpu::dispatch_RadixSort(pool, n_max_threads, p);
+    cpu::dispatch_RemoveDuplicates(pool, n_max_threads, p);
+    cpu::dispatch_BuildRadixTree(pool, n_max_threads, p);
+    cpu::dispatch_EdgeCount(pool, n_max_threads, p);
+    cpu::dispatch_EdgeOffset(pool, n_max_threads, p);
+  }
+
+  std::shared_ptr<P> p;
+  core::thread_pool pool;
+};
+
+#define DEFINE_KEY_BENCH(NAME, STAGE)                                 \
+  BENCHMARK_TEMPLATE_DEFINE_F(CPU_Keys, NAME##_32, Pipe)              \
+  (benchmark::State & state) {                                        \
+    const auto n_threads = static_cast<int>(state.range(0));          \
+    for (auto _ : state) {                                            \
+      cpu::STAGE(pool, n_threads, p);                                 \
+    }                                                                 \
+  }                                                                   \
+  BENCHMARK_TEMPLATE_DEFINE_F(CPU_Keys, NAME##_64, Pipe64)            \
+  (benchmark::State & state) {                                        \
+    const auto n_threads = static_cast<int>(state.range(0));          \
+    for (auto _ : state) {                                            \
+      cpu::STAGE(pool, n_threads, p);                                 \
+    }                                                                 \
+  }                                                                   \
+  BENCHMARK_REGISTER_F(CPU_Keys, NAME##_32)                           \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)         \
+      ->Unit(benchmark::kMillisecond)                                 \
+      ->Iterations(Config::DEFAULT_ITERATIONS);                       \
+  BENCHMARK_REGISTER_F(CPU_Keys, NAME##_64)                           \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)         \
+      ->Unit(benchmark::kMillisecond)                                 \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+DEFINE_KEY_BENCH(BM_Morton, dispatch_MortonCode)
+DEFINE_KEY_BENCH(BM_Sort, dispatch_RadixSort)
+DEFINE_KEY_BENCH(BM_RemoveDup, dispatch_RemoveDuplicates)
+DEFINE_KEY_BENCH(BM_BuildRadixTree, dispatch_BuildRadixTree)
+DEFINE_KEY_BENCH(BM_EdgeCount, dispatch_EdgeCount)
+DEFINE_KEY_BENCH(BM_BuildOctree, dispatch_BuildOctree)
+
+#undef DEFINE_KEY_BENCH
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
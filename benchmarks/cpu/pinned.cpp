@@ -58,8 +58,10 @@ static std::vector<int> get_cores_for_type(const std::string& core_type) {
   return std::vector<int>();
 }
 
-// Modify the benchmark macro to include core type
-#define DEFINE_PINNED_BENCHMARK(NAME)                                    \
+// Modify the benchmark macro to include core type. Extra arguments are
+// forwarded to the dispatcher, so a stage can be benchmarked in several
+// variants under different names.
+#define DEFINE_PINNED_BENCHMARK_VARIANT(NAME, STAGE, ...)                \
   BENCHMARK_DEFINE_F(CPU_Pinned, NAME)(benchmark::State & state) {       \
     const auto n_threads = state.range(0);                               \
     std::string core_type = state.name();                                \
@@ -71,19 +73,42 @@ static std::vector<int> get_cores_for_type(const std::string& core_type) {
     }                                                                    \
     core::thread_pool pinned_pool(cores_to_pin, true);                   \
     for (auto _ : state) {                                               \
-      cpu::dispatch_##NAME(pinned_pool, n_threads, p);                   \
+      cpu::dispatch_##STAGE(                                             \
+          pinned_pool, n_threads, p __VA_OPT__(, ) __VA_ARGS__);         \
     }                                                                    \
   }
 
+#define DEFINE_PINNED_BENCHMARK(NAME) \
+  DEFINE_PINNED_BENCHMARK_VARIANT(NAME, NAME)
+
 // Replace all individual benchmark definitions with the macro
 DEFINE_PINNED_BENCHMARK(MortonCode)
 DEFINE_PINNED_BENCHMARK(RadixSort)
 DEFINE_PINNED_BENCHMARK(RemoveDuplicates)
+DEFINE_PINNED_BENCHMARK(RadixSortAndRemoveDuplicates)
 DEFINE_PINNED_BENCHMARK(BuildRadixTree)
 DEFINE_PINNED_BENCHMARK(EdgeCount)
 DEFINE_PINNED_BENCHMARK(EdgeOffset)
+DEFINE_PINNED_BENCHMARK(EdgeCountAndOffset)
 DEFINE_PINNED_BENCHMARK(BuildOctree)
 
+// the old mutex/condition-variable sort, to compare against 'RadixSort'
+DEFINE_PINNED_BENCHMARK_VARIANT(RadixSortBinning,
+                                RadixSort,
+                                cpu::RadixSortVariant::kBinning)
+
+// same sort, staging the scatter in write-combining buffers
+DEFINE_PINNED_BENCHMARK_VARIANT(
+    RadixSortWriteCombining,
+    RadixSort,
+    cpu::RadixSortVariant::kParallelLSDWriteCombining)
+
+// the reference encoder, to compare against the SIMD one 'MortonCode' picks
+DEFINE_PINNED_BENCHMARK_VARIANT(MortonCodeScalar,
+                                MortonCode,
+                                cpu::MortonKernel::kScalar)
+
+#undef DEFINE_PINNED_BENCHMARK_VARIANT
 #undef DEFINE_PINNED_BENCHMARK
 
 // Modify RegisterBenchmarkWithRange to handle empty core sets
@@ -106,14 +131,30 @@ void RegisterBenchmarkWithRange(int n_small_cores,
   REGISTER_BENCHMARK(MortonCode, Medium, n_medium_cores);
   REGISTER_BENCHMARK(MortonCode, Big, n_big_cores);
 
+  REGISTER_BENCHMARK(MortonCodeScalar, Small, n_small_cores);
+  REGISTER_BENCHMARK(MortonCodeScalar, Medium, n_medium_cores);
+  REGISTER_BENCHMARK(MortonCodeScalar, Big, n_big_cores);
+
   REGISTER_BENCHMARK(RadixSort, Small, n_small_cores);
   REGISTER_BENCHMARK(RadixSort, Medium, n_medium_cores);
   REGISTER_BENCHMARK(RadixSort, Big, n_big_cores);
 
+  REGISTER_BENCHMARK(RadixSortBinning, Small, n_small_cores);
+  REGISTER_BENCHMARK(RadixSortBinning, Medium, n_medium_cores);
+  REGISTER_BENCHMARK(RadixSortBinning, Big, n_big_cores);
+
+  REGISTER_BENCHMARK(RadixSortWriteCombining, Small, n_small_cores);
+  REGISTER_BENCHMARK(RadixSortWriteCombining, Medium, n_medium_cores);
+  REGISTER_BENCHMARK(RadixSortWriteCombining, Big, n_big_cores);
+
   REGISTER_BENCHMARK(RemoveDuplicates, Small, n_small_cores);
   REGISTER_BENCHMARK(RemoveDuplicates, Medium, n_medium_cores);
   REGISTER_BENCHMARK(RemoveDuplicates, Big, n_big_cores);
 
+  REGISTER_BENCHMARK(RadixSortAndRemoveDuplicates, Small, n_small_cores);
+  REGISTER_BENCHMARK(RadixSortAndRemoveDuplicates, Medium, n_medium_cores);
+  REGISTER_BENCHMARK(RadixSortAndRemoveDuplicates, Big, n_big_cores);
+
   REGISTER_BENCHMARK(BuildRadixTree, Small, n_small_cores);
   REGISTER_BENCHMARK(BuildRadixTree, Medium, n_medium_cores);
   REGISTER_BENCHMARK(BuildRadixTree, Big, n_big_cores);
@@ -126,6 +167,10 @@ void RegisterBenchmarkWithRange(int n_small_cores,
   REGISTER_BENCHMARK(EdgeOffset, Medium, n_medium_cores);
   REGISTER_BENCHMARK(EdgeOffset, Big, n_big_cores);
 
+  REGISTER_BENCHMARK(EdgeCountAndOffset, Small, n_small_cores);
+  REGISTER_BENCHMARK(EdgeCountAndOffset, Medium, n_medium_cores);
+  REGISTER_BENCHMARK(EdgeCountAndOffset, Big, n_big_cores);
+
   REGISTER_BENCHMARK(BuildOctree, Small, n_small_cores);
   REGISTER_BENCHMARK(BuildOctree, Medium, n_medium_cores);
   REGISTER_BENCHMARK(BuildOctree, Big, n_big_cores);
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+
+// ----------------------------------------------------------------------------
+// Sorting the points into morton order: the key-value sort, which carries the
+// source position of every key, against the plain key sort, and the gather
+// that reorders 'u_points' with the resulting permutation.
+// ----------------------------------------------------------------------------
+
+class CPU_PointOrder : public benchmark::Fixture {
+ public:
+  explicit CPU_PointOrder()
+      : p(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                 Config::DEFAULT_MIN_COORD,
+                                 Config::DEFAULT_RANGE,
+                                 Config::DEFAULT_SEED)),
+        pool(std::thread::hardware_concurrency()) {
+    gen_data(p, Config::DEFAULT_SEED);
+    p->allocate_point_order();
+
+    const auto n_max_threads = static_cast<int>(pool.get_thread_count());
+
+    // basically pregenerate the data
+    cpu::dispatch_MortonCode(pool, n_max_threads, p);
+    cpu::dispatch_RadixSortWithIndices(pool, n_max_threads, p);
+    cpu::dispatch_GatherPoints(pool, n_max_threads, p);
+  }
+
+  std::shared_ptr<Pipe> p;
+  core::thread_pool pool;
+};
+
+// ----------------------------------------------------------------------------
+// Radix sort, keys only (the same as 'BM_Sort' of bench-cpu-unpinned)
+// ----------------------------------------------------------------------------
+
+BENCHMARK_DEFINE_F(CPU_PointOrder, BM_Sort)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    cpu::dispatch_RadixSort(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_PointOrder, BM_Sort)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+// ----------------------------------------------------------------------------
+// Radix sort carrying point indices
+// ----------------------------------------------------------------------------
+
+BENCHMARK_DEFINE_F(CPU_PointOrder, BM_SortWithIndices)
+(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    cpu::dispatch_RadixSortWithIndices(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_PointOrder, BM_SortWithIndices)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+// ----------------------------------------------------------------------------
+// Gather points into morton order
+// ----------------------------------------------------------------------------
+
+BENCHMARK_DEFINE_F(CPU_PointOrder, BM_GatherPoints)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    cpu::dispatch_GatherPoints(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_PointOrder, BM_GatherPoints)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <optional>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/structures.h"
+#include "third-party/BS_thread_pool.hpp"
+
+// ----------------------------------------------------------------------------
+// Compares the three pools every cpu::dispatch_* can run on:
+//   - core::thread_pool          (single mutex queue, futures per block)
+//   - core::work_stealing_pool   (Chase-Lev deques, no per-block allocation)
+//   - BS::thread_pool
+// ----------------------------------------------------------------------------
+
+template <typename Pool>
+class CPU_Pools : public benchmark::Fixture {
+ public:
+  void SetUp(const benchmark::State&) override {
+    p = std::make_shared<Pipe>(Config::DEFAULT_N,
+                               Config::DEFAULT_MIN_COORD,
+                               Config::DEFAULT_RANGE,
+                               Config::DEFAULT_SEED);
+    gen_data(p, Config::DEFAULT_SEED);
+
+    pool.emplace(std::thread::hardware_concurrency());
+
+    const auto n_max_threads = static_cast<int>(pool->get_thread_count());
+
+    // basically pregenerate the data
+    cpu::dispatch_MortonCode(*pool, n_max_threads, p);
+    cpu::dispatch_RadixSort(*pool, n_max_threads, p);
+    cpu::dispatch_RemoveDuplicates(*pool, n_max_threads, p);
+    cpu::dispatch_BuildRadixTree(*pool, n_max_threads, p);
+    cpu::dispatch_EdgeCount(*pool, n_max_threads, p);
+    cpu::dispatch_EdgeOffset(*pool, n_max_threads, p);
+    cpu::dispatch_BuildOctree(*pool, n_max_threads, p);
+  }
+
+  void TearDown(const benchmark::State&) override {
+    pool.reset();
+    p.reset();
+  }
+
+  std::shared_ptr<Pipe> p;
+  std::optional<Pool> pool;
+};
+
+#define DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, STAGE)                      \
+  BENCHMARK_TEMPLATE_DEFINE_F(CPU_Pools, POOL_NAME##_##STAGE, POOL)        \
+  (benchmark::State & state) {                                             \
+    const auto n_threads = static_cast<int>(state.range(0));               \
+    for (auto _ : state) {                                                 \
+      cpu::dispatch_##STAGE(*this->pool, n_threads, this->p);              \
+    }                                                                      \
+  }                                                                        \
+  BENCHMARK_REGISTER_F(CPU_Pools, POOL_NAME##_##STAGE)                     \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)              \
+      ->Unit(benchmark::kMillisecond)                                      \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+#define DEFINE_POOL_BENCHMARKS(POOL_NAME, POOL)            \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, MortonCode)       \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, RadixSort)        \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, RemoveDuplicates) \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, BuildRadixTree)   \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, EdgeCount)        \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, EdgeOffset)       \
+  DEFINE_POOL_BENCHMARK(POOL_NAME, POOL, BuildOctree)
+
+DEFINE_POOL_BENCHMARKS(Core, core::thread_pool)
+DEFINE_POOL_BENCHMARKS(WorkStealing, core::work_stealing_pool)
+DEFINE_POOL_BENCHMARKS(BS, BS::thread_pool)
+
+#undef DEFINE_POOL_BENCHMARKS
+#undef DEFINE_POOL_BENCHMARK
+
+int main(int argc, char** argv) {
+  // ignore the command line arguments from "--device=<device>"
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/brt_func.hpp"
+#include "host/host_dispatcher.hpp"
+#include "shared/edge_func.h"
+#include "shared/structures.h"
+
+// ----------------------------------------------------------------------------
+// core::thread_pool, futures path (submit_blocks + wait) vs. team mode
+// (parallel_for). 'WakeUp' runs empty blocks, so it measures the fork/join
+// cost alone; the stages are the short ones where that cost shows.
+// ----------------------------------------------------------------------------
+
+class CPU_Team : public benchmark::Fixture {
+ public:
+  explicit CPU_Team()
+      : p(std::make_shared<Pipe>(Config::DEFAULT_N,
+                                 Config::DEFAULT_MIN_COORD,
+                                 Config::DEFAULT_RANGE,
+                                 Config::DEFAULT_SEED)),
+        pool(std::thread::hardware_concurrency()) {
+    gen_data(p, Config::DEFAULT_SEED);
+
+    const auto n_max_threads = static_cast<int>(pool.get_thread_count());
+
+    // basically pregenerate the data
+    cpu::dispatch_MortonCode(pool, n_max_threads, p);
+    cpu::dispatch_RadixSort(pool, n_max_threads, p);
+    cpu::dispatch_RemoveDuplicates(pool, n_max_threads, p);
+    cpu::dispatch_BuildRadixTree(pool, n_max_threads, p);
+    cpu::dispatch_EdgeCount(pool, n_max_threads, p);
+  }
+
+  std::shared_ptr<Pipe> p;
+  core::thread_pool pool;
+};
+
+// ----------------------------------------------------------------------------
+// Wake-up latency
+// ----------------------------------------------------------------------------
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_WakeUp_Futures)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    pool.submit_blocks(
+            0, n_threads, [](int, int) {}, n_threads)
+        .wait();
+  }
+}
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_WakeUp_Team)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    pool.parallel_for(0, n_threads, [](int, int) {}, n_threads);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_Team, BM_WakeUp_Futures)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_REGISTER_F(CPU_Team, BM_WakeUp_Team)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMicrosecond);
+
+// ----------------------------------------------------------------------------
+// Stages
+// ----------------------------------------------------------------------------
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_EdgeCount_Futures)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    cpu::dispatch_EdgeCount(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_EdgeCount_Team)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    pool.parallel_for(
+        0,
+        p->brt.n_nodes(),
+        [this](const int start, const int end) {
+          const auto brt = p->brt.view<shared::BrtLayout::kSoA>();
+          for (auto i = start; i < end; ++i) {
+            shared::process_edge_count_i(i, brt, p->u_edge_counts);
+          }
+        },
+        n_threads);
+  }
+}
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_BuildRadixTree_Futures)
+(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    cpu::dispatch_BuildRadixTree(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_DEFINE_F(CPU_Team, BM_BuildRadixTree_Team)(benchmark::State& state) {
+  const auto n_threads = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    pool.parallel_for(
+        0,
+        p->brt.n_nodes(),
+        [this](const int start, const int end) {
+          for (auto i = start; i < end; ++i) {
+            cpu::process_radix_tree_i(
+                i, p->brt.n_nodes(), p->u_morton, &p->brt);
+          }
+        },
+        n_threads);
+  }
+}
+
+#define REGISTER_STAGE(NAME)                                  \
+  BENCHMARK_REGISTER_F(CPU_Team, NAME)                        \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1) \
+      ->Unit(benchmark::kMillisecond)                         \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+REGISTER_STAGE(BM_EdgeCount_Futures)
+REGISTER_STAGE(BM_EdgeCount_Team)
+REGISTER_STAGE(BM_BuildRadixTree_Futures)
+REGISTER_STAGE(BM_BuildRadixTree_Team)
+
+#undef REGISTER_STAGE
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
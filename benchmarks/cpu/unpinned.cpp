@@ -14,13 +14,8 @@
 class CPU_Unpined : public benchmark::Fixture {
  public:
   explicit CPU_Unpined()
-      : p(std::make_shared<Pipe>(Config::DEFAULT_N,
-                                 Config::DEFAULT_MIN_COORD,
-                                 Config::DEFAULT_RANGE,
-                                 Config::DEFAULT_SEED)),
+      : p(make_pipe()), p_packed(make_pipe()),
         pool(std::thread::hardware_concurrency()) {
-    gen_data(p, Config::DEFAULT_SEED);
-
     const auto n_max_threads = pool.get_thread_count();
 
     // basically pregenerate the data
@@ -31,9 +26,30 @@ class CPU_Unpined : public benchmark::Fixture {
     cpu::dispatch_EdgeCount(pool, n_max_threads, p);
     cpu::dispatch_EdgeOffset(pool, n_max_threads, p);
     cpu::dispatch_BuildOctree(pool, n_max_threads, p);
+
+    // same tree in the packed node layout, for the *_Packed benchmarks
+    p_packed->use_brt_layout(shared::BrtLayout::kPacked);
+    cpu::dispatch_MortonCode(pool, n_max_threads, p_packed);
+    cpu::dispatch_RadixSort(pool, n_max_threads, p_packed);
+    cpu::dispatch_RemoveDuplicates(pool, n_max_threads, p_packed);
+    cpu::dispatch_BuildRadixTree<shared::BrtLayout::kPacked>(
+        pool, n_max_threads, p_packed);
+    cpu::dispatch_EdgeCount<shared::BrtLayout::kPacked>(
+        pool, n_max_threads, p_packed);
+    cpu::dispatch_EdgeOffset(pool, n_max_threads, p_packed);
+  }
+
+  static std::shared_ptr<Pipe> make_pipe() {
+    auto p = std::make_shared<Pipe>(Config::DEFAULT_N,
+                                    Config::DEFAULT_MIN_COORD,
+                                    Config::DEFAULT_RANGE,
+                                    Config::DEFAULT_SEED);
+    gen_data(p, Config::DEFAULT_SEED);
+    return p;
   }
 
   std::shared_ptr<Pipe> p;
+  std::shared_ptr<Pipe> p_packed;
   core::thread_pool pool;
 };
 
@@ -54,6 +70,90 @@ BENCHMARK_REGISTER_F(CPU_Unpined, BM_Morton)
     ->Unit(benchmark::kMillisecond)
     ->Iterations(Config::DEFAULT_ITERATIONS);
 
+// One benchmark per encoder, the ones this CPU lacks are skipped
+#define DEFINE_MORTON_KERNEL_BENCHMARK(NAME, KERNEL)                  \
+  BENCHMARK_DEFINE_F(CPU_Unpined, BM_Morton_##NAME)                   \
+  (benchmark::State & state) {                                        \
+    if (!cpu::morton_kernel_supported(KERNEL)) {                      \
+      state.SkipWithError("Morton kernel unsupported on this CPU");   \
+      return;                                                         \
+    }                                                                 \
+    const auto n_threads = state.range(0);                            \
+    for (auto _ : state) {                                            \
+      cpu::dispatch_MortonCode(pool, n_threads, p, KERNEL);           \
+    }                                                                 \
+  }                                                                   \
+  BENCHMARK_REGISTER_F(CPU_Unpined, BM_Morton_##NAME)                 \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)         \
+      ->Unit(benchmark::kMillisecond)                                 \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+DEFINE_MORTON_KERNEL_BENCHMARK(Scalar, cpu::MortonKernel::kScalar)
+DEFINE_MORTON_KERNEL_BENCHMARK(Bmi2, cpu::MortonKernel::kBmi2)
+DEFINE_MORTON_KERNEL_BENCHMARK(Sse, cpu::MortonKernel::kSse)
+DEFINE_MORTON_KERNEL_BENCHMARK(Avx2, cpu::MortonKernel::kAvx2)
+DEFINE_MORTON_KERNEL_BENCHMARK(Avx512, cpu::MortonKernel::kAvx512)
+DEFINE_MORTON_KERNEL_BENCHMARK(Neon, cpu::MortonKernel::kNeon)
+
+#undef DEFINE_MORTON_KERNEL_BENCHMARK
+
+// The same points read from the other input layouts, best kernel
+#define DEFINE_MORTON_LAYOUT_BENCHMARK(NAME, LAYOUT)           \
+  BENCHMARK_DEFINE_F(CPU_Unpined, BM_Morton_##NAME)            \
+  (benchmark::State & state) {                                 \
+    p->use_point_layout(LAYOUT);                               \
+    fill_point_layout(p);                                      \
+    const auto n_threads = state.range(0);                     \
+    for (auto _ : state) {                                     \
+      cpu::dispatch_MortonCode(pool, n_threads, p);            \
+    }                                                          \
+    p->use_point_layout(shared::PointLayout::kVec4);           \
+  }                                                            \
+  BENCHMARK_REGISTER_F(CPU_Unpined, BM_Morton_##NAME)          \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)  \
+      ->Unit(benchmark::kMillisecond)                          \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+DEFINE_MORTON_LAYOUT_BENCHMARK(SoA, shared::PointLayout::kSoA)
+DEFINE_MORTON_LAYOUT_BENCHMARK(Packed3, shared::PointLayout::kPacked3)
+
+#undef DEFINE_MORTON_LAYOUT_BENCHMARK
+
+// The bounds reduction alone, and the morton stage per bounds mode ('BM_Morton'
+// above is the default, kAabb). kFixed skips the reduction.
+BENCHMARK_DEFINE_F(CPU_Unpined, BM_Bounds)(benchmark::State& state) {
+  const auto n_threads = state.range(0);
+
+  for (auto _ : state) {
+    cpu::dispatch_ComputeBounds(pool, n_threads, p);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_Unpined, BM_Bounds)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+#define DEFINE_MORTON_BOUNDS_BENCHMARK(NAME, MODE)             \
+  BENCHMARK_DEFINE_F(CPU_Unpined, BM_Morton_##NAME)            \
+  (benchmark::State & state) {                                 \
+    p->bounds_mode = MODE;                                     \
+    const auto n_threads = state.range(0);                     \
+    for (auto _ : state) {                                     \
+      cpu::dispatch_MortonCode(pool, n_threads, p);            \
+    }                                                          \
+    p->bounds_mode = shared::BoundsMode::kAabb;                \
+  }                                                            \
+  BENCHMARK_REGISTER_F(CPU_Unpined, BM_Morton_##NAME)          \
+      ->DenseRange(1, std::thread::hardware_concurrency(), 1)  \
+      ->Unit(benchmark::kMillisecond)                          \
+      ->Iterations(Config::DEFAULT_ITERATIONS);
+
+DEFINE_MORTON_BOUNDS_BENCHMARK(Fixed, shared::BoundsMode::kFixed)
+DEFINE_MORTON_BOUNDS_BENCHMARK(PerAxis, shared::BoundsMode::kPerAxis)
+
+#undef DEFINE_MORTON_BOUNDS_BENCHMARK
+
 // ----------------------------------------------------------------------------
 // Radix sort
 // ----------------------------------------------------------------------------
@@ -89,7 +189,7 @@ BENCHMARK_REGISTER_F(CPU_Unpined, BM_RemoveDuplicates)
     ->Iterations(Config::DEFAULT_ITERATIONS);
 
 // ----------------------------------------------------------------------------
-// Build radix tree
+// Build radix tree (the *_Packed variants use shared::BrtLayout::kPacked)
 // ----------------------------------------------------------------------------
 
 BENCHMARK_DEFINE_F(CPU_Unpined, BM_BuildRadixTree)(benchmark::State& state) {
@@ -105,6 +205,21 @@ BENCHMARK_REGISTER_F(CPU_Unpined, BM_BuildRadixTree)
     ->Unit(benchmark::kMillisecond)
     ->Iterations(Config::DEFAULT_ITERATIONS);
 
+BENCHMARK_DEFINE_F(CPU_Unpined, BM_BuildRadixTree_Packed)
+(benchmark::State& state) {
+  const auto n_threads = state.range(0);
+
+  for (auto _ : state) {
+    cpu::dispatch_BuildRadixTree<shared::BrtLayout::kPacked>(
+        pool, n_threads, p_packed);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_Unpined, BM_BuildRadixTree_Packed)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
 // ----------------------------------------------------------------------------
 // Edge count
 // ----------------------------------------------------------------------------
@@ -122,6 +237,20 @@ BENCHMARK_REGISTER_F(CPU_Unpined, BM_EdgeCount)
     ->Unit(benchmark::kMillisecond)
     ->Iterations(Config::DEFAULT_ITERATIONS);
 
+BENCHMARK_DEFINE_F(CPU_Unpined, BM_EdgeCount_Packed)(benchmark::State& state) {
+  const auto n_threads = state.range(0);
+
+  for (auto _ : state) {
+    cpu::dispatch_EdgeCount<shared::BrtLayout::kPacked>(
+        pool, n_threads, p_packed);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_Unpined, BM_EdgeCount_Packed)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
 // ----------------------------------------------------------------------------
 // Edge offset
 // ----------------------------------------------------------------------------
@@ -156,6 +285,21 @@ BENCHMARK_REGISTER_F(CPU_Unpined, BM_BuildOctree)
     ->Unit(benchmark::kMillisecond)
     ->Iterations(Config::DEFAULT_ITERATIONS);
 
+BENCHMARK_DEFINE_F(CPU_Unpined, BM_BuildOctree_Packed)
+(benchmark::State& state) {
+  const auto n_threads = state.range(0);
+
+  for (auto _ : state) {
+    cpu::dispatch_BuildOctree<shared::BrtLayout::kPacked>(
+        pool, n_threads, p_packed);
+  }
+}
+
+BENCHMARK_REGISTER_F(CPU_Unpined, BM_BuildOctree_Packed)
+    ->DenseRange(1, std::thread::hardware_concurrency(), 1)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
 int main(int argc, char** argv) {
   // ignore the command line arguments from "--device=<device>"
 
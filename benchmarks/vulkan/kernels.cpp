@@ -28,18 +28,23 @@ static void RunMortonCode(benchmark::State& state) {
   auto u_morton = engine.buffer(n_input * sizeof(uint32_t));
   u_morton->zeros();
 
+  // the fixed cube, and the key bits the radix sort plans from
+  auto u_box = engine.buffer(2 * sizeof(glm::vec4));
+  u_box->span<glm::vec4>()[0] = glm::vec4(Config::DEFAULT_MIN_COORD);
+  u_box->span<glm::vec4>()[1] = glm::vec4(Config::DEFAULT_RANGE);
+  auto u_key_bits = engine.buffer(2 * sizeof(uint32_t));
+  u_key_bits->zeros();
+
   struct PushConstants {
     uint n;
-    float min_coord;
-    float range;
-  } pc = {static_cast<uint>(n_input),
-          Config::DEFAULT_MIN_COORD,
-          Config::DEFAULT_RANGE};
+  } pc = {static_cast<uint>(n_input)};
 
   auto algo = engine.algorithm("morton.spv",
                                {
                                    u_points,
                                    u_morton,
+                                   u_box,
+                                   u_key_bits,
                                },
                                sizeof(pc));
   algo->set_push_constants(pc);
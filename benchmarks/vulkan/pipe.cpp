@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "../cpu/bm_config.hpp"
+#include "core/thread_pool.hpp"
+#include "host/fused_pipeline.hpp"
+#include "spdlog/common.h"
+#include "vulkan/pipe.hpp"
+
+// ----------------------------------------------------------------------------
+// One frame of the octree pipeline on the GPU ('vk::Pipe', one submit) vs. the
+// fused CPU pipeline on every hardware thread, over the same points.
+//
+// BM_VkPipeTuned sweeps the specialization constants: one workgroup size for
+// every shader (64..512) and the keys per thread of the radix sort.
+// ----------------------------------------------------------------------------
+
+static void BM_VkPipe(benchmark::State& state) {
+  const auto cpu_pipe = std::make_shared<Pipe>(Config::DEFAULT_N,
+                                               Config::DEFAULT_MIN_COORD,
+                                               Config::DEFAULT_RANGE,
+                                               Config::DEFAULT_SEED);
+  gen_data(cpu_pipe, Config::DEFAULT_SEED);
+
+  Engine engine;
+  vk::Pipe pipe(engine,
+                Config::DEFAULT_N,
+                Config::DEFAULT_MIN_COORD,
+                Config::DEFAULT_RANGE);
+  std::copy_n(cpu_pipe->u_points, Config::DEFAULT_N, pipe.u_points->begin());
+
+  // the octree is sized by the first frame, the timed ones submit once
+  pipe.run();
+
+  for (auto _ : state) {
+    pipe.run();
+  }
+  state.counters["oct_nodes"] = pipe.n_oct_nodes();
+}
+
+static void BM_VkPipeTuned(benchmark::State& state) {
+  const auto threads = static_cast<uint32_t>(state.range(0));
+  const vk::PipeTuning tuning = {
+      .morton_threads = threads,
+      .sort_threads = threads,
+      .items_per_thread = static_cast<uint32_t>(state.range(1)),
+      .scan_threads = threads,
+      .unique_threads = threads,
+      .brt_threads = threads,
+      .clear_threads = threads,
+      .edge_threads = threads,
+      .octree_threads = threads,
+  };
+
+  const auto cpu_pipe = std::make_shared<Pipe>(Config::DEFAULT_N,
+                                               Config::DEFAULT_MIN_COORD,
+                                               Config::DEFAULT_RANGE,
+                                               Config::DEFAULT_SEED);
+  gen_data(cpu_pipe, Config::DEFAULT_SEED);
+
+  Engine engine;
+  vk::Pipe pipe(engine,
+                Config::DEFAULT_N,
+                Config::DEFAULT_MIN_COORD,
+                Config::DEFAULT_RANGE,
+                tuning);
+  std::copy_n(cpu_pipe->u_points, Config::DEFAULT_N, pipe.u_points->begin());
+
+  // the octree is sized by the first frame, the timed ones submit once
+  pipe.run();
+
+  for (auto _ : state) {
+    pipe.run();
+  }
+  state.counters["oct_nodes"] = pipe.n_oct_nodes();
+}
+
+static void BM_CpuPipe(benchmark::State& state) {
+  const auto p = std::make_shared<Pipe>(Config::DEFAULT_N,
+                                        Config::DEFAULT_MIN_COORD,
+                                        Config::DEFAULT_RANGE,
+                                        Config::DEFAULT_SEED);
+  gen_data(p, Config::DEFAULT_SEED);
+
+  const auto n_threads =
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  core::thread_pool pool(n_threads);
+
+  // the octree is sized by its first build
+  cpu::run_fused_pipeline(pool, n_threads, p);
+
+  for (auto _ : state) {
+    cpu::run_fused_pipeline(pool, n_threads, p);
+  }
+  state.counters["threads"] = n_threads;
+  state.counters["oct_nodes"] = p->n_oct_nodes();
+}
+
+BENCHMARK(BM_VkPipe)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK(BM_VkPipeTuned)
+    ->ArgNames({"threads", "items"})
+    ->ArgsProduct({{64, 128, 256, 512}, {4, 8, 16}})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK(BM_CpuPipe)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+int main(int argc, char** argv) {
+  spdlog::set_level(spdlog::level::off);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+
+#include "../cpu/bm_config.hpp"
+#include "spdlog/common.h"
+#include "vulkan/engine.hpp"
+#include "vulkan/pipe.hpp"
+
+// ----------------------------------------------------------------------------
+// Startup: a new engine creating every pipeline of 'vk::Pipe', with an empty
+// pipeline cache (cold, the driver compiles all the SPIR-V) and with the one
+// saved by a previous run (warm). Only the creation is timed.
+//
+// Mesa drivers (lavapipe, turnip, panvk) keep their own shader cache on disk,
+// which would make the cold runs warm, so 'main' turns it off unless
+// MESA_SHADER_CACHE_DISABLE is already set.
+//
+// Then one algorithm: compiled for a new engine, and for an engine that
+// already has its kernel, which only allocates a descriptor set.
+// ----------------------------------------------------------------------------
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const fs::path kCacheDir =
+    fs::temp_directory_path() / "ppl-bench-pipeline-cache";
+
+// of morton.comp
+struct MortonPushConstants {
+  uint32_t n;
+};
+
+void clear_cache_dir() {
+  fs::remove_all(kCacheDir);
+  fs::create_directories(kCacheDir);
+}
+
+// seconds to create the engine and the pipe, which save the cache on the way
+// out
+double time_startup(benchmark::State& state) {
+  const auto start = std::chrono::steady_clock::now();
+  Engine engine(true, kCacheDir);
+  vk::Pipe pipe(engine,
+                Config::DEFAULT_N,
+                Config::DEFAULT_MIN_COORD,
+                Config::DEFAULT_RANGE);
+  const auto end = std::chrono::steady_clock::now();
+
+  state.counters["cache_bytes"] =
+      static_cast<double>(engine.pipeline_cache()->loaded_size());
+  return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+static void BM_ColdStartup(benchmark::State& state) {
+  for (auto _ : state) {
+    clear_cache_dir();
+    state.SetIterationTime(time_startup(state));
+  }
+}
+
+static void BM_WarmStartup(benchmark::State& state) {
+  clear_cache_dir();
+  benchmark::DoNotOptimize(time_startup(state));
+
+  for (auto _ : state) {
+    state.SetIterationTime(time_startup(state));
+  }
+}
+
+BENCHMARK(BM_ColdStartup)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK(BM_WarmStartup)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+static void BM_CreateAlgorithmCompile(benchmark::State& state) {
+  for (auto _ : state) {
+    Engine engine(true, "");
+    auto u_points = engine.buffer(Config::DEFAULT_N * sizeof(glm::vec4));
+    auto u_morton = engine.buffer(Config::DEFAULT_N * sizeof(uint32_t));
+    auto u_box = engine.buffer(2 * sizeof(glm::vec4));
+    auto u_key_bits = engine.buffer(2 * sizeof(uint32_t));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto algo = engine.algorithm("morton.spv",
+                                 {u_points, u_morton, u_box, u_key_bits},
+                                 sizeof(MortonPushConstants));
+    const auto end = std::chrono::steady_clock::now();
+
+    state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+  }
+}
+
+static void BM_CreateAlgorithmRegistered(benchmark::State& state) {
+  Engine engine(true, "");
+  auto u_points = engine.buffer(Config::DEFAULT_N * sizeof(glm::vec4));
+  auto u_morton = engine.buffer(Config::DEFAULT_N * sizeof(uint32_t));
+  auto u_box = engine.buffer(2 * sizeof(glm::vec4));
+  auto u_key_bits = engine.buffer(2 * sizeof(uint32_t));
+  // compiles the kernel
+  benchmark::DoNotOptimize(
+      engine.algorithm("morton.spv",
+                       {u_points, u_morton, u_box, u_key_bits},
+                       sizeof(MortonPushConstants)));
+
+  for (auto _ : state) {
+    auto algo = engine.algorithm("morton.spv",
+                                 {u_points, u_morton, u_box, u_key_bits},
+                                 sizeof(MortonPushConstants));
+    benchmark::DoNotOptimize(algo);
+  }
+  state.counters["kernels"] = static_cast<double>(engine.n_kernels());
+}
+
+BENCHMARK(BM_CreateAlgorithmCompile)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond)
+    ->Iterations(Config::DEFAULT_ITERATIONS);
+
+BENCHMARK(BM_CreateAlgorithmRegistered)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+  // before the first engine loads the driver
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 0);
+  spdlog::set_level(spdlog::level::off);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  fs::remove_all(kCacheDir);
+  return 0;
+}
@@ -6,6 +6,14 @@ target("bench-cpu-unpinned")
     add_deps("ppl")
     if is_plat("android") then on_run(run_on_android) end
 
+target("bench-cpu-point-order")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/point-order.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
 target("bench-cpu-pinned")
     set_kind("binary")
     add_includedirs("$(projectdir)/include")
@@ -23,6 +31,62 @@ target("bench-cpu-pinned-bs")
     add_deps("ppl")
     if is_plat("android") then on_run(run_on_android) end
 
+target("bench-cpu-pools")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/pools.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-fused")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/fused.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-team")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/team.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-morton64")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/morton64.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-arena")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/arena.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-frames")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/frames.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
+target("bench-cpu-hetero")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("cpu/hetero.cpp")
+    add_packages("benchmark", "glm")
+    add_deps("ppl")
+    if is_plat("android") then on_run(run_on_android) end
+
 target("bench-micro")
     set_kind("binary")
     add_includedirs("$(projectdir)/include")
@@ -37,3 +101,22 @@ target("bench-vk-kernels")
     add_packages("benchmark", "volk", "vulkan-memory-allocator", "glm", "spdlog")
     add_deps("ppl-vulkan")
     if is_plat("android") then on_run(run_on_android) end
+    after_build(compile_shaders)
+
+target("bench-vk-pipe")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("vulkan/pipe.cpp")
+    add_packages("benchmark", "volk", "vulkan-memory-allocator", "glm", "spdlog")
+    add_deps("ppl-vulkan", "ppl")
+    if is_plat("android") then on_run(run_on_android) end
+    after_build(compile_shaders)
+
+target("bench-vk-startup")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("vulkan/startup.cpp")
+    add_packages("benchmark", "volk", "vulkan-memory-allocator", "glm", "spdlog")
+    add_deps("ppl-vulkan", "ppl")
+    if is_plat("android") then on_run(run_on_android) end
+    after_build(compile_shaders)
@@ -7,6 +7,10 @@
 
 #include "configs.hpp"
 // #include "core/thread_pool.hpp"
+#include "core/trace.hpp"
+#include "host/autotune.hpp"
+#include "host/frame_pipeline.hpp"
+#include "host/fused_pipeline.hpp"
 #include "host/host_dispatcher.hpp"
 #include "shared/structures.h"
 #include "third-party/CLI11.hpp"
@@ -53,6 +57,11 @@ int main(int argc, char** argv) {
   int num_threads;
   int problem_size;
   int iterations;
+  bool fused = false;
+  bool autotune = false;
+  std::string tune_file;
+  std::string trace_file;
+  int in_flight = 0;
 
   std::string device_id;
   app.add_option("--device", device_id, "Device ID")->default_val("jetson");
@@ -68,8 +77,38 @@ int main(int argc, char** argv) {
       ->default_val(Config::DEFAULT_ITERATIONS)
       ->check(CLI::Range(1, 1000));
 
+  app.add_flag("--fused", fused, "Run the fused pipeline executor");
+
+  app.add_flag("--autotune",
+               autotune,
+               "Run the fused pipeline with a tuned cluster and thread count "
+               "per phase");
+
+  app.add_option("--tune-file", tune_file, "Where tuned plans are stored")
+      ->default_val("ppl_tuning.txt");
+
+  app.add_option("--trace",
+                 trace_file,
+                 "Write a Chrome trace of the run (build with --trace=y)");
+
+  app.add_option("-k,--in-flight",
+                 in_flight,
+                 "Pipeline this many frames across the core clusters")
+      ->default_val(0)
+      ->check(CLI::Range(0, 8));
+
   CLI11_PARSE(app, argc, argv);
 
+  // on every way out of 'main'
+  struct TraceWriter {
+    const std::string& path;
+    ~TraceWriter() {
+      if (!path.empty() && !core::trace::write_chrome_json(path)) {
+        std::cerr << "Failed to write " << path << std::endl;
+      }
+    }
+  } trace_writer{trace_file};
+
   try {
     auto phone_specs = get_phone_specs(device_id);
     if (!phone_specs) {
@@ -96,20 +135,114 @@ int main(int argc, char** argv) {
     gen_data(p, Config::DEFAULT_SEED);
     print_points(p, 5);
 
+    if (in_flight > 0) {
+      // morton + sort on the big cores, the tree stages on the others
+      auto front_cores = !big_cores.empty() ? big_cores : mid_cores;
+      auto back_cores = mid_cores;
+      back_cores.insert(
+          back_cores.end(), small_cores.begin(), small_cores.end());
+      if (front_cores.empty()) front_cores = back_cores;
+      if (back_cores.empty()) back_cores = front_cores;
+
+      core::thread_pool front_pool(front_cores, true);
+      core::thread_pool back_pool(back_cores, true);
+
+      // every frame is a copy of 'p'
+      std::vector<std::shared_ptr<Pipe>> pipes;
+      for (int i = 0; i < in_flight; ++i) {
+        pipes.push_back(std::make_shared<Pipe>(problem_size,
+                                               Config::DEFAULT_MIN_COORD,
+                                               Config::DEFAULT_RANGE,
+                                               Config::DEFAULT_SEED));
+      }
+      const auto stats = cpu::run_frame_pipeline(
+          cpu::StageCluster<core::thread_pool>{
+              front_pool, static_cast<int>(front_cores.size())},
+          cpu::StageCluster<core::thread_pool>{
+              back_pool, static_cast<int>(back_cores.size())},
+          pipes,
+          iterations,
+          [&p](Pipe& frame, int) {
+            std::copy_n(p->u_points, frame.n_input(), frame.u_points);
+          });
+
+      std::cout << "\nPipelined (" << in_flight << " frames in flight):\n"
+                << "- Frames/second:  " << std::fixed << std::setprecision(2)
+                << stats.frames_per_sec << "\n"
+                << "- Mean latency:   " << stats.mean_latency_ms << " ms\n"
+                << "- Max latency:    " << stats.max_latency_ms << " ms\n";
+      return EXIT_SUCCESS;
+    }
+
+    if (autotune) {
+      // one pool per cluster, tuned over the first frames of this run or
+      // loaded from an earlier one
+      std::vector<std::unique_ptr<core::thread_pool>> cluster_pools;
+      std::vector<core::thread_pool*> clusters;
+      std::vector<int> cluster_threads;
+      for (const auto& cores : {big_cores, mid_cores, small_cores}) {
+        const auto valid = utils::get_valid_cores(cores);
+        if (valid.empty()) continue;
+        cluster_pools.push_back(
+            std::make_unique<core::thread_pool>(valid, true));
+        clusters.push_back(cluster_pools.back().get());
+        cluster_threads.push_back(static_cast<int>(valid.size()));
+      }
+      if (clusters.empty()) {
+        std::cerr << "No valid cores found" << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      cpu::PipelineTuner tuner(device_id, cluster_threads, tune_file);
+      const bool loaded = tuner.tuned();
+
+      int frames = 0;
+      double total_ms = 0.0;
+      while (!tuner.tuned() || frames < iterations) {
+        cpu::PipelineTimings t;
+        const bool tuning = !tuner.tuned();
+        cpu::run_tuned_pipeline(
+            std::span<core::thread_pool* const>(clusters), tuner, p, &t);
+        if (!tuning) {
+          total_ms += t.total_ms;
+          ++frames;
+        }
+      }
+
+      std::cout << "\nTuned plan (" << (loaded ? "loaded from " : "saved to ")
+                << tune_file << "), cluster:threads per phase:\n";
+      constexpr const char* kPhases[] = {
+          "Morton", "Sort + unique", "Radix tree", "Edge offsets", "Octree"};
+      for (int i = 0; i < cpu::kNumFusedPhases; ++i) {
+        std::cout << "- " << kPhases[i] << ": " << tuner.plan()[i].cluster
+                  << ":" << tuner.plan()[i].num_threads << "\n";
+      }
+      std::cout << "- Average time: " << std::fixed << std::setprecision(3)
+                << total_ms / frames << " ms\n";
+      return EXIT_SUCCESS;
+    }
+
     // Warmup run
     cpu::dispatch_MortonCode(pool, num_threads, p);
 
     // Benchmark
     auto start = std::chrono::high_resolution_clock::now();
 
+    cpu::PipelineTimings timings;
     for (int i = 0; i < iterations; ++i) {
-      cpu::dispatch_MortonCode(pool, num_threads, p);
-      cpu::dispatch_RadixSort(pool, num_threads, p);
-      cpu::dispatch_RemoveDuplicates(pool, num_threads, p);
-      cpu::dispatch_BuildRadixTree(pool, num_threads, p);
-      cpu::dispatch_EdgeCount(pool, num_threads, p);
-      cpu::dispatch_EdgeOffset(pool, num_threads, p);
-      cpu::dispatch_BuildOctree(pool, num_threads, p);
+      if (fused) {
+        cpu::PipelineTimings t;
+        cpu::run_fused_pipeline(pool, num_threads, p, &t);
+        timings += t;
+      } else {
+        cpu::dispatch_MortonCode(pool, num_threads, p);
+        cpu::dispatch_RadixSort(pool, num_threads, p);
+        cpu::dispatch_RemoveDuplicates(pool, num_threads, p);
+        cpu::dispatch_BuildRadixTree(pool, num_threads, p);
+        cpu::dispatch_EdgeCount(pool, num_threads, p);
+        cpu::dispatch_EdgeOffset(pool, num_threads, p);
+        cpu::dispatch_BuildOctree(pool, num_threads, p);
+      }
 
       std::cout << '.' << std::flush;
     }
@@ -131,6 +264,19 @@ int main(int argc, char** argv) {
               << "- Throughput: " << std::fixed << std::setprecision(2)
               << (problem_size / avg_ms * 1000) << " points/second\n";
 
+    if (fused) {
+      std::cout << "- Morton + hints:   " << timings.morton_ms / iterations
+                << " ms\n"
+                << "- Sort + unique:    " << timings.sort_unique_ms / iterations
+                << " ms\n"
+                << "- Radix tree:       " << timings.radix_tree_ms / iterations
+                << " ms\n"
+                << "- Edge offsets:     " << timings.edge_ms / iterations
+                << " ms\n"
+                << "- Octree:           " << timings.octree_ms / iterations
+                << " ms\n";
+    }
+
   } catch (const std::exception& e) {
     std::cerr << "Error: " << e.what() << std::endl;
     return EXIT_FAILURE;
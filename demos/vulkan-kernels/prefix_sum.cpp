@@ -42,26 +42,34 @@ int main() {
                                    output,
                                    block_sums,
                                },
-                               sizeof(pc));
-  algo->set_push_constants(pc);
-
-  auto seq = engine.sequence();
-  seq->record_commands_with_blocks(algo.get(), n_blocks);
-  seq->launch_kernel_async();
-  // seq->sync();
+                               sizeof(pc),
+                               {
+                                   BufferAccess::kRead,
+                                   BufferAccess::kWrite,
+                                   BufferAccess::kWrite,
+                               });
 
   auto algo2 = engine.algorithm("block_add.spv",
                                 {
                                     block_sums,
                                     output,
                                 },
-                                sizeof(pc));
-  algo2->set_push_constants(pc);
+                                sizeof(pc),
+                                {
+                                    BufferAccess::kRead,
+                                    BufferAccess::kReadWrite,
+                                });
+
+  // both passes in one submit, the sequence puts the barrier between them
+  auto seq = engine.sequence();
+  seq->cmd_begin();
+  seq->record_dispatch(algo.get(), pc, n_blocks);
+  seq->record_dispatch(algo2.get(), pc, n_blocks);
+  seq->cmd_end();
+  seq->launch_kernel_async();
+  seq->sync();
 
-  auto seq2 = engine.sequence();
-  seq2->record_commands_with_blocks(algo2.get(), n_blocks);
-  seq2->launch_kernel_async();
-  seq2->sync();
+  spdlog::info("{} barriers recorded", seq->n_recorded_barriers());
 
   // ---------------------------------------------------------------------------
   // Check the result
@@ -29,18 +29,6 @@ target("demo-vulkan-info")
     if is_plat("android") then on_run(run_on_android) end
 target_end()
 
-function compile_shaders()
-    local shader_files = os.files("$(projectdir)/ppl/vulkan/shaders/*.comp")
-
-    for _, shader_file in ipairs(shader_files) do
-        local output_path = "$(projectdir)/ppl/vulkan/shaders/compiled_shaders/" .. path.basename(shader_file) .. ".spv"
-        -- local command = "glslangValidator --target-env vulkan1.2 -e main -o " .. output_path .. " " .. shader_file
-        local command = "glslangValidator -V --target-env spirv1.3 " .. shader_file .. " -o " .. output_path
-        print(command)
-        os.run(command)
-    end
-end
-
 -- target("demo-vulkan")
 --     set_kind("binary")
 --     add_includedirs("$(projectdir)/include")
@@ -51,15 +39,15 @@ end
 --     after_build(compile_shaders)
 -- target_end()
 
--- target("demo-vulkan-pipe")
---     set_kind("binary")
---     add_includedirs("$(projectdir)/include")
---     add_files("vulkan-pipe/*.cpp")
---     add_deps("ppl-vulkan")
---     add_packages("glm", "spdlog", "volk", "vulkan-memory-allocator")
---     if is_plat("android") then on_run(run_on_android) end
---     after_build(compile_shaders)
--- target_end()
+target("demo-vulkan-pipe")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("vulkan-pipe/*.cpp")
+    add_deps("ppl-vulkan")
+    add_packages("glm", "spdlog", "volk", "vulkan-memory-allocator")
+    if is_plat("android") then on_run(run_on_android) end
+    after_build(compile_shaders)
+target_end()
 
 -- Vulkan kernels --------------------------------------------------------------
 
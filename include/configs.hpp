@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -91,3 +92,15 @@ inline std::optional<const PhoneSpecs*> get_phone_specs(
   }
   return std::nullopt;
 }
+
+// The nominal clock of 'core' in GHz, 0 if it is in none of the clusters or
+// the clock of its cluster is unknown
+inline double get_core_frequency(const PhoneSpecs& specs, const int core) {
+  const auto in = [core](const std::vector<int>& cores) {
+    return std::ranges::find(cores, core) != cores.end();
+  };
+  if (in(specs.big_cores)) return specs.big_core_freq;
+  if (in(specs.mid_cores)) return specs.mid_core_freq;
+  if (in(specs.small_cores)) return specs.small_core_freq;
+  return 0.0;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#define PPL_ARENA_MMAP 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+
+// How an 'arena' maps its memory.
+//   kNone:        plain pages
+//   kTransparent: 2 MiB aligned chunks with 'madvise(MADV_HUGEPAGE)', so the
+//                 kernel may back them with transparent huge pages
+//   kExplicit:    'MAP_HUGETLB', from the pages reserved in
+//                 /proc/sys/vm/nr_hugepages. Falls back to kTransparent when
+//                 none are left.
+enum class huge_pages { kNone, kTransparent, kExplicit };
+
+struct arena_options {
+  huge_pages pages = huge_pages::kTransparent;
+
+  // Binds the memory to this NUMA node with 'mbind', -1 leaves the placement
+  // to first touch. Ignored where 'mbind' is not available.
+  int numa_node = -1;
+};
+
+namespace detail {
+
+// the alignment of every allocation, 'arena::alignment'
+inline constexpr size_t kAlignment = 64;
+
+inline constexpr size_t kHugePageSize = size_t{2} << 20;
+
+// small requests share a chunk of at least this much
+inline constexpr size_t kMinChunkSize = kHugePageSize;
+
+inline size_t round_up(const size_t n, const size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+#if defined(PPL_ARENA_MMAP)
+
+// 'size' bytes aligned to 'align'. Pages are always aligned enough for the
+// arena, larger alignments map 'align' more and unmap the ends.
+inline char* map_aligned(const size_t size, const size_t align) {
+  const auto padded = align > kAlignment ? size + align : size;
+  void* p = mmap(nullptr,
+                 padded,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS,
+                 -1,
+                 0);
+  if (p == MAP_FAILED) throw std::bad_alloc();
+
+  const auto raw = reinterpret_cast<uintptr_t>(p);
+  const auto aligned = round_up(raw, align);
+  if (aligned > raw) {
+    munmap(p, aligned - raw);
+  }
+  if (const auto tail = raw + padded - (aligned + size); tail > 0) {
+    munmap(reinterpret_cast<void*>(aligned + size), tail);
+  }
+  return reinterpret_cast<char*>(aligned);
+}
+
+// MPOL_BIND from <numaif.h>, which is part of libnuma and not always there
+inline constexpr int kMpolBind = 2;
+
+inline void bind_to_node(char* base, const size_t size, const int node) {
+#if defined(SYS_mbind)
+  constexpr auto bits_per_word = 8 * sizeof(unsigned long);
+  if (node < 0 || static_cast<size_t>(node) >= 16 * bits_per_word) return;
+  unsigned long mask[16] = {};
+  mask[node / bits_per_word] = 1UL << (node % bits_per_word);
+  // best effort: on a single-node machine or without permission the memory
+  // simply stays with first touch
+  syscall(SYS_mbind, base, size, kMpolBind, mask, 16 * bits_per_word, 0);
+#else
+  (void)base;
+  (void)size;
+  (void)node;
+#endif
+}
+
+#endif  // PPL_ARENA_MMAP
+
+}  // namespace detail
+
+// A bump allocator over a few large 'mmap' chunks. Every allocation is
+// 64-byte aligned and uninitialized: pages are only placed when first
+// written, so have the threads that process a range touch it first (see
+// 'cpu::dispatch_FirstTouch'). Memory is returned by 'clear()' and the
+// destructor only, single allocations are never freed.
+//
+// Not thread-safe, allocate from one thread.
+class arena {
+ public:
+  static constexpr size_t alignment = detail::kAlignment;
+
+  explicit arena(const arena_options& options = {});
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+  arena(arena&&) = delete;
+  arena& operator=(arena&&) = delete;
+
+  ~arena();
+
+  // 'n' uninitialized elements of 'T' (an implicit-lifetime type)
+  template <typename T>
+  [[nodiscard]] T* allocate(const size_t n) {
+    return static_cast<T*>(allocate_bytes(n * sizeof(T)));
+  }
+
+  [[nodiscard]] void* allocate_bytes(size_t bytes);
+
+  // Makes sure the next 'bytes' of allocations come from a single chunk,
+  // mapping a new one if the current chunk has less room left.
+  void reserve(size_t bytes);
+
+  // Unmaps all chunks, every pointer handed out becomes invalid
+  void clear();
+
+  [[nodiscard]] const arena_options& options() const { return options_; }
+  [[nodiscard]] size_t bytes_mapped() const;
+
+ private:
+  struct chunk {
+    char* base;
+    size_t size;
+    size_t used;
+  };
+
+  void map_chunk(size_t min_bytes);
+
+  arena_options options_;
+  std::vector<chunk> chunks_;
+};
+
+// ----------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------
+
+inline arena::arena(const arena_options& options) : options_(options) {}
+
+inline arena::~arena() { clear(); }
+
+inline void arena::map_chunk(const size_t min_bytes) {
+  auto pages = options_.pages;
+  auto size = std::max(detail::round_up(min_bytes, detail::kHugePageSize),
+                       detail::kMinChunkSize);
+  char* base = nullptr;
+
+#if defined(PPL_ARENA_MMAP)
+  if (pages == huge_pages::kExplicit) {
+    void* p = mmap(nullptr,
+                   size,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                   -1,
+                   0);
+    if (p != MAP_FAILED) {
+      base = static_cast<char*>(p);
+    } else {
+      pages = huge_pages::kTransparent;
+    }
+  }
+  if (base == nullptr) {
+    base = detail::map_aligned(
+        size,
+        pages == huge_pages::kNone ? alignment : detail::kHugePageSize);
+  }
+#if defined(MADV_HUGEPAGE)
+  if (pages == huge_pages::kTransparent) {
+    madvise(base, size, MADV_HUGEPAGE);
+  }
+#endif
+  if (options_.numa_node >= 0) {
+    detail::bind_to_node(base, size, options_.numa_node);
+  }
+#else
+  base = static_cast<char*>(std::aligned_alloc(detail::kHugePageSize, size));
+  if (base == nullptr) throw std::bad_alloc();
+#endif
+
+  chunks_.push_back({base, size, 0});
+}
+
+inline void* arena::allocate_bytes(const size_t bytes) {
+  const auto n = detail::round_up(std::max(bytes, size_t{1}), alignment);
+  if (chunks_.empty() || chunks_.back().size - chunks_.back().used < n) {
+    map_chunk(n);
+  }
+  auto& c = chunks_.back();
+  void* p = c.base + c.used;
+  c.used += n;
+  return p;
+}
+
+inline void arena::reserve(const size_t bytes) {
+  if (chunks_.empty() || chunks_.back().size - chunks_.back().used < bytes) {
+    map_chunk(bytes);
+  }
+}
+
+inline void arena::clear() {
+  for (const auto& c : chunks_) {
+#if defined(PPL_ARENA_MMAP)
+    munmap(c.base, c.size);
+#else
+    std::free(c.base);
+#endif
+  }
+  chunks_.clear();
+}
+
+inline size_t arena::bytes_mapped() const {
+  size_t total = 0;
+  for (const auto& c : chunks_) {
+    total += c.size;
+  }
+  return total;
+}
+
+}  // namespace core
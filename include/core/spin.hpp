@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+namespace core::detail {
+
+constexpr size_t cache_line_size = 64;
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+}  // namespace core::detail
@@ -1,13 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "spin.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 namespace core {
@@ -28,60 +39,46 @@ struct multi_future {
 
 class thread_pool {
  public:
-
-  explicit thread_pool(int n_threads) : stopFlag(false) {
+  // How long a worker keeps spinning for the next 'parallel_for' region
+  // before it parks on the condition variable.
+  static constexpr int team_spin_iterations = 1 << 12;
+
+  // Chunks per task of a 'partition::kDynamic' range, small enough that a
+  // fast core keeps claiming while a slow one finishes its last chunk.
+  static constexpr size_t dynamic_chunks_per_task = 8;
+
+  // How 'submit_blocks' cuts the range of a block without a result:
+  //   kEqual     'num_blocks' equal blocks (the default)
+  //   kWeighted  one block per worker whatever 'num_blocks', sized by its
+  //              weight, so a pool pinned across big and little cores
+  //              finishes all blocks together
+  //   kDynamic   'num_blocks' tasks claim small chunks until none are left
+  // Blocks that return a value are always equal, there is one per result.
+  // The host stages that index partial results by block cut their ranges the
+  // same way ('partition_blocks' in ppl/host/block.hpp).
+  enum class partition { kEqual, kWeighted, kDynamic };
+
+  explicit thread_pool(int n_threads)
+      : stopFlag(false), worker_weights(n_threads, 1.0) {
     workers.reserve(n_threads);
 
     for (int i = 0; i < n_threads; ++i) {
-      workers.emplace_back([this] {
-        while (true) {
-          std::function<void()> task;
-
-          // Lock the queue to retrieve tasks safely
-          {
-            std::unique_lock lock(queueMutex);
-            condition.wait(lock, [this] { return stopFlag || !tasks.empty(); });
-
-            if (stopFlag && tasks.empty()) return;
-
-            task = std::move(tasks.front());
-            tasks.pop();
-          }
-
-          // Execute the retrieved task outside the lock
-          task();
-        }
-      });
+      workers.emplace_back([this, i] { worker_loop(i); });
     }
   }
 
   explicit thread_pool(std::vector<int> core_ids, bool enable_pinning = false)
-      : stopFlag(false) {
+      : stopFlag(false), worker_weights(core_ids.size(), 1.0) {
+    if (enable_pinning) pinned_cores = core_ids;
     workers.reserve(core_ids.size());
-    for (auto id : core_ids) {
-      workers.emplace_back([this, id, enable_pinning] {
+    for (size_t i = 0; i < core_ids.size(); ++i) {
+      workers.emplace_back([this, i, id = core_ids[i], enable_pinning] {
         // Pin the thread to the specified core only if enabled
         if (enable_pinning) {
           utils::set_cpu_affinity(id);
         }
 
-        while (true) {
-          std::function<void()> task;
-
-          // Lock the queue to retrieve tasks safely
-          {
-            std::unique_lock lock(queueMutex);
-            condition.wait(lock, [this] { return stopFlag || !tasks.empty(); });
-
-            if (stopFlag && tasks.empty()) return;
-
-            task = std::move(tasks.front());
-            tasks.pop();
-          }
-
-          // Execute the retrieved task outside the lock
-          task();
-        }
+        worker_loop(i);
       });
     }
   }
@@ -99,6 +96,127 @@ class thread_pool {
 
   [[nodiscard]] size_t get_thread_count() const { return workers.size(); }
 
+  // Set before submitting, the running blocks keep the old partition.
+  void set_partition(const partition mode) { partition_mode = mode; }
+  [[nodiscard]] partition get_partition() const { return partition_mode; }
+
+  // Relative throughput of every worker for 'partition::kWeighted', e.g.
+  // 'frequency_weights()' or 'calibrate_weights()'. Only the ratios matter.
+  void set_worker_weights(std::vector<double> weights) {
+    if (weights.size() != workers.size()) {
+      throw std::invalid_argument("one weight per worker expected");
+    }
+    for (const double w : weights) {
+      if (!std::isfinite(w) || w <= 0.0) {
+        throw std::invalid_argument("worker weights must be positive");
+      }
+    }
+    worker_weights = std::move(weights);
+  }
+
+  [[nodiscard]] const std::vector<double> &get_worker_weights() const {
+    return worker_weights;
+  }
+
+  // Cuts [first_index, index_after_last) into one share per weight, sized by
+  // it. 'bounds[i]' to 'bounds[i + 1]' is share i. No share is empty while
+  // the range has an index for each.
+  template <typename T>
+  [[nodiscard]] static std::vector<T> weighted_bounds(
+      const T first_index,
+      const T index_after_last,
+      const std::vector<double> &weights) {
+    const size_t M = weights.size();
+    double total = 0.0;
+    for (const double w : weights) total += w;
+
+    const auto size = static_cast<size_t>(index_after_last - first_index);
+    std::vector<T> bounds(M + 1);
+    double sum = 0.0;
+    bounds[0] = first_index;
+    for (size_t i = 0; i < M; ++i) {
+      sum += weights[i];
+      auto bound = first_index + static_cast<T>(std::llround(
+                                     static_cast<double>(size) * sum / total));
+      if (size >= M) {
+        // at least one index for this share and each one after it
+        bound = std::clamp<T>(bound,
+                              bounds[i] + 1,
+                              index_after_last - static_cast<T>(M - 1 - i));
+      }
+      bounds[i + 1] = bound;
+    }
+    bounds[M] = index_after_last;
+    return bounds;
+  }
+
+  // the worker index of the calling thread, 'get_thread_count()' if it is
+  // not one of ours
+  [[nodiscard]] size_t this_worker() const {
+    return current_pool == this ? current_worker : workers.size();
+  }
+
+  // The clock of each pinned core from 'utils::get_core_frequencies()'. 1
+  // for every worker of an unpinned pool and for cores without a reading.
+  [[nodiscard]] std::vector<double> frequency_weights() const {
+    std::vector<double> weights(workers.size(), 1.0);
+    const auto frequencies = utils::get_core_frequencies();
+    for (size_t i = 0; i < pinned_cores.size(); ++i) {
+      for (const auto &f : frequencies) {
+        if (f.core_id == pinned_cores[i] && f.frequency_ghz > 0.0) {
+          weights[i] = f.frequency_ghz;
+        }
+      }
+    }
+    return weights;
+  }
+
+  // Runs a short integer kernel on all workers at once (best of three) and
+  // returns their relative throughput, which unlike the clock also covers
+  // the micro-architecture of each cluster. Call it on an idle pool.
+  [[nodiscard]] std::vector<double> calibrate_weights() {
+    constexpr int rounds = 3;
+    constexpr int iterations = 1 << 18;
+
+    const size_t n = workers.size();
+    std::vector<double> seconds(n, 0.0);
+    std::atomic<uint64_t> sink{0};
+
+    // one block per team member, member k runs block k
+    parallel_for(
+        size_t{0},
+        n + 1,
+        [&](size_t, size_t) {
+          const size_t me = this_worker();
+          if (me >= n) return;  // the calling thread
+
+          double best = 0.0;
+          for (int round = 0; round < rounds; ++round) {
+            const auto start = std::chrono::steady_clock::now();
+            uint64_t x = me + 1;
+            for (int i = 0; i < iterations; ++i) {
+              x ^= x << 13;
+              x ^= x >> 7;
+              x ^= x << 17;
+              x *= 0x9e3779b97f4a7c15ull;
+            }
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            sink.fetch_add(x, std::memory_order_relaxed);
+            if (round == 0 || elapsed.count() < best) best = elapsed.count();
+          }
+          seconds[me] = best;
+        },
+        n + 1);
+
+    std::vector<double> weights(n, 1.0);
+    const double fastest = *std::min_element(seconds.begin(), seconds.end());
+    for (size_t i = 0; i < n; ++i) {
+      if (seconds[i] > 0.0) weights[i] = fastest / seconds[i];
+    }
+    return weights;
+  }
+
   template <class F, class... Args>
   auto submit_task(F &&f, Args &&...args)
       -> std::future<typename std::invoke_result_t<F, Args...>> {
@@ -113,7 +231,11 @@ class thread_pool {
       if (stopFlag)
         throw std::runtime_error("submit_task on stopped ThreadPool");
 
-      tasks.emplace([task]() { (*task)(); });
+      tasks.emplace([task, queued = trace::queue_stamp{}]() {
+        queued.record();
+        (*task)();
+      });
+      n_queued.fetch_add(1, std::memory_order_relaxed);
     }
     condition.notify_one();
 
@@ -129,6 +251,23 @@ class thread_pool {
                                               const size_t num_blocks = 0) {
     multi_future<R> future_collection;
 
+    if constexpr (std::is_void_v<R>) {
+      if (index_after_last > first_index &&
+          partition_mode != partition::kEqual) {
+        if (partition_mode == partition::kWeighted) {
+          submit_weighted(
+              future_collection, first_index, index_after_last, block);
+        } else {
+          submit_dynamic(future_collection,
+                         first_index,
+                         index_after_last,
+                         block,
+                         num_blocks);
+        }
+        return future_collection;
+      }
+    }
+
     if (index_after_last > first_index) {
       size_t M = num_blocks ? num_blocks : workers.size();
       T block_size = (index_after_last - first_index + M - 1) / M;  // Round up
@@ -141,21 +280,266 @@ class thread_pool {
 
         // Submit each block as a separate task and add the future to
         // multi_future
-        future_collection.add(
-            submit_task([block = std::forward<F>(block), start, end] {
-              return block(start, end);
-            }));
+        future_collection.add(submit_task([block = std::forward<F>(block),
+                                           start,
+                                           end,
+                                           label = trace::block_label(i)] {
+          const trace::scope scope(label);
+          return block(start, end);
+        }));
       }
     }
     return future_collection;
   }
 
+  // ---------------------------------------------------------------------------
+  // Team mode
+  // ---------------------------------------------------------------------------
+
+  // OpenMP-style alternative to 'submit_blocks(...).wait()'. The range is cut
+  // into the same blocks, but instead of one task and one future per block,
+  // the calling thread and up to 'get_thread_count()' workers form a team and
+  // each member runs every n-th block. The region is announced by bumping a
+  // generation counter; workers that finished the previous region are still
+  // spinning on it, so back-to-back regions (the pipeline stages) neither
+  // allocate nor go through the condition variable.
+  //
+  // Regions from different threads are serialized. Must not be called from a
+  // task of this pool. The first exception thrown by a block is rethrown once
+  // the whole team has finished.
+  template <typename T, typename F>
+  void parallel_for(const T first_index,
+                    const T index_after_last,
+                    F &&block,
+                    const size_t num_blocks = 0) {
+    if (index_after_last <= first_index) return;
+
+    const size_t M = num_blocks ? num_blocks : workers.size();
+    const T block_size = (index_after_last - first_index + M - 1) / M;
+    const size_t n_blocks =
+        (index_after_last - first_index + block_size - 1) / block_size;
+
+    auto member = [&](const size_t id, const size_t n_members) {
+      for (size_t i = id; i < n_blocks; i += n_members) {
+        const T start = first_index + i * block_size;
+        const T end = std::min(start + block_size, index_after_last);
+        block(start, end);
+      }
+    };
+    using Member = decltype(member);
+
+    std::lock_guard team_lock(teamMutex);
+
+    const size_t n_members = std::min(n_blocks, workers.size() + 1);
+    team_fn = [](void *ctx, const size_t id, const size_t n) {
+      (*static_cast<Member *>(ctx))(id, n);
+    };
+    team_ctx = &member;
+    team_error = nullptr;
+    team_pending.store(n_members - 1, std::memory_order_relaxed);
+
+    // the generation and the team size in one word, so a worker never pairs
+    // one region's generation with another region's size
+    team_generation += 1;
+    team_state.store((team_generation << 16) | n_members);
+    if (n_parked.load() > 0) {
+      std::lock_guard lock(queueMutex);
+      condition.notify_all();
+    }
+
+    std::exception_ptr error;
+    try {
+      member(0, n_members);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    // the team still uses 'member', which lives on this stack frame
+    for (int i = 0; team_pending.load(std::memory_order_acquire) != 0; ++i) {
+      if (i < team_spin_iterations) {
+        detail::cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+
+    if (!error) error = team_error;
+    if (error) std::rethrow_exception(error);
+  }
+
  private:
+  // One share of the range per worker, sized by 'worker_weights'. A task
+  // takes the share of the worker that runs it, or the first one left if a
+  // worker got to two tasks; every task takes exactly one share. All workers
+  // take part, so the weights are normalized over the whole pool.
+  template <typename T, typename F>
+  void submit_weighted(multi_future<void> &futures,
+                       const T first_index,
+                       const T index_after_last,
+                       F &block) {
+    struct shares {
+      shares(F &f, std::vector<T> b, const size_t m)
+          : block(f), bounds(std::move(b)), taken(new std::atomic<bool>[m]{}) {}
+
+      std::decay_t<F> block;
+      std::vector<T> bounds;
+      std::unique_ptr<std::atomic<bool>[]> taken;
+    };
+
+    const size_t M = workers.size();
+    const auto state = std::make_shared<shares>(
+        block,
+        weighted_bounds(first_index, index_after_last, worker_weights),
+        M);
+
+    for (size_t i = 0; i < M; ++i) {
+      futures.add(submit_task([this, state, M, label = trace::block_label(i)] {
+        const trace::scope scope(label);
+        size_t share = this_worker();
+        if (share >= M || state->taken[share].exchange(true)) {
+          share = 0;
+          while (state->taken[share].exchange(true)) ++share;
+        }
+        if (state->bounds[share] < state->bounds[share + 1]) {
+          state->block(state->bounds[share], state->bounds[share + 1]);
+        }
+      }));
+    }
+  }
+
+  // 'num_blocks' tasks that claim 'dynamic_chunks_per_task' times smaller
+  // chunks from a shared cursor until the range is done.
+  template <typename T, typename F>
+  void submit_dynamic(multi_future<void> &futures,
+                      const T first_index,
+                      const T index_after_last,
+                      F &block,
+                      const size_t num_blocks) {
+    struct chunks {
+      chunks(F &f, const T first, const T size)
+          : block(f), next(first), chunk(size) {}
+
+      std::decay_t<F> block;
+      std::atomic<T> next;
+      T chunk;
+    };
+
+    const size_t M = num_blocks ? num_blocks : workers.size();
+    const auto total = static_cast<size_t>(index_after_last - first_index);
+    const auto chunk = static_cast<T>(
+        std::max<size_t>(1, total / (M * dynamic_chunks_per_task)));
+    const auto state = std::make_shared<chunks>(block, first_index, chunk);
+
+    for (size_t i = 0; i < std::min(M, total); ++i) {
+      futures.add(submit_task(
+          [state, index_after_last, label = trace::block_label(i)] {
+            const trace::scope scope(label);
+            while (true) {
+              const T start = state->next.fetch_add(state->chunk);
+              if (start >= index_after_last) break;
+              state->block(
+                  start, std::min<T>(start + state->chunk, index_after_last));
+            }
+          }));
+    }
+  }
+
+  void worker_loop(const size_t worker_id) {
+    current_pool = this;
+    current_worker = worker_id;
+
+    uint64_t seen = 0;  // no region yet, even if one is already announced
+    bool hot = false;  // ran a region, the next one is likely close
+
+    while (true) {
+      if (hot) {
+        for (int i = 0; i < team_spin_iterations; ++i) {
+          if (team_state.load(std::memory_order_acquire) != seen ||
+              n_queued.load(std::memory_order_relaxed) != 0) {
+            break;
+          }
+          detail::cpu_relax();
+        }
+
+        // fast path, the next region arrived while spinning
+        const auto state = team_state.load(std::memory_order_acquire);
+        if (state != seen) {
+          seen = state;
+          run_team_member(worker_id + 1, state & 0xffff);
+          continue;
+        }
+      }
+
+      std::function<void()> task;
+
+      // Lock the queue to retrieve tasks safely
+      {
+        std::unique_lock lock(queueMutex);
+        n_parked.fetch_add(1);
+        condition.wait(lock, [this, seen] {
+          return stopFlag || !tasks.empty() || team_state.load() != seen;
+        });
+        n_parked.fetch_sub(1);
+
+        const auto state = team_state.load(std::memory_order_acquire);
+        if (state != seen) {
+          lock.unlock();
+          seen = state;
+          hot = true;
+          run_team_member(worker_id + 1, state & 0xffff);
+          continue;
+        }
+
+        if (stopFlag && tasks.empty()) return;
+
+        task = std::move(tasks.front());
+        tasks.pop();
+        n_queued.fetch_sub(1, std::memory_order_relaxed);
+      }
+
+      // Execute the retrieved task outside the lock
+      hot = false;
+      task();
+    }
+  }
+
+  void run_team_member(const size_t id, const size_t n_members) {
+    if (id >= n_members) return;
+
+    try {
+      team_fn(team_ctx, id, n_members);
+    } catch (...) {
+      std::lock_guard lock(queueMutex);
+      if (!team_error) team_error = std::current_exception();
+    }
+    team_pending.fetch_sub(1, std::memory_order_release);
+  }
+
   std::vector<std::thread> workers;
   std::queue<std::function<void()>> tasks;
   std::mutex queueMutex;
   std::condition_variable condition;
   bool stopFlag;
+
+  // 'parallel_for' state. 'team_fn'/'team_ctx' are written before the
+  // release of 'team_state' and stay valid until 'team_pending' drops to 0.
+  std::mutex teamMutex;
+  void (*team_fn)(void *, size_t, size_t) = nullptr;
+  void *team_ctx = nullptr;
+  std::exception_ptr team_error;
+  uint64_t team_generation = 0;
+  alignas(detail::cache_line_size) std::atomic<uint64_t> team_state{0};
+  alignas(detail::cache_line_size) std::atomic<size_t> team_pending{0};
+  std::atomic<int> n_parked{0};
+  std::atomic<size_t> n_queued{0};
+
+  // 'submit_blocks' partition, and the cores the workers are pinned to
+  partition partition_mode = partition::kEqual;
+  std::vector<double> worker_weights;
+  std::vector<int> pinned_cores;
+
+  static inline thread_local const thread_pool *current_pool = nullptr;
+  static inline thread_local size_t current_worker = 0;
 };
 
 };  // namespace core
\ No newline at end of file
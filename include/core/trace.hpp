@@ -0,0 +1,273 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#if defined(PPL_TRACE)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#endif
+
+// ----------------------------------------------------------------------------
+// Hot-path tracing, compiled in with -DPPL_TRACE (xmake f --trace=y). Every
+// thread appends begin/end events to its own ring buffer, without locks, and
+// 'write_chrome_json()' exports all of them for chrome://tracing or Perfetto.
+// Without PPL_TRACE the types below are empty and every call compiles away.
+//
+//   PPL_TRACE_SCOPE("MortonCode");  // a stage on the calling thread
+//
+// The blocks a stage submits to a 'core::thread_pool' (or through
+// 'run_blocks') are recorded on the worker that runs them, labeled with the
+// stage, their block index and the core, plus how long they were queued.
+// ----------------------------------------------------------------------------
+
+namespace core::trace {
+
+#if defined(PPL_TRACE)
+
+inline constexpr bool enabled = true;
+
+// Events kept per thread; older ones are overwritten.
+inline constexpr size_t buffer_capacity = 1 << 16;
+
+struct event {
+  const char* name;  // a string literal
+  uint64_t begin_ns;
+  uint64_t end_ns;
+  int32_t block;  // -1 for stages
+  int32_t core;   // -1 if unknown
+};
+
+// One thread's events. Only that thread writes, 'size' is published with
+// release so an exporter sees every event before it.
+struct buffer {
+  explicit buffer(const int id) : tid(id) {}
+
+  const int tid;
+  std::unique_ptr<event[]> events{new event[buffer_capacity]};
+  std::atomic<size_t> size{0};
+};
+
+namespace detail {
+
+// all buffers ever created, they outlive their threads
+struct registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<buffer>> buffers;
+  std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+inline registry& get_registry() {
+  static registry r;
+  return r;
+}
+
+inline buffer& this_thread_buffer() {
+  thread_local buffer* local = [] {
+    auto& r = get_registry();
+    std::lock_guard lock(r.mutex);
+    r.buffers.push_back(
+        std::make_shared<buffer>(static_cast<int>(r.buffers.size())));
+    return r.buffers.back().get();
+  }();
+  return *local;
+}
+
+inline thread_local const char* current_stage = nullptr;
+
+}  // namespace detail
+
+[[nodiscard]] inline uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - detail::get_registry().epoch)
+      .count();
+}
+
+[[nodiscard]] inline int current_core() {
+#if defined(__linux__)
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+inline void record(const char* name,
+                   const uint64_t begin_ns,
+                   const uint64_t end_ns,
+                   const int block = -1) {
+  auto& b = detail::this_thread_buffer();
+  const auto i = b.size.load(std::memory_order_relaxed);
+  b.events[i % buffer_capacity] = {
+      name, begin_ns, end_ns, block, current_core()};
+  b.size.store(i + 1, std::memory_order_release);
+}
+
+// A block of the stage that runs on the submitting thread, captured when the
+// block is submitted.
+class block_label {
+ public:
+  explicit block_label(const size_t block)
+      : stage_(detail::current_stage), block_(static_cast<int>(block)) {}
+
+ private:
+  const char* stage_;
+  int block_;
+
+  friend class scope;
+};
+
+// The time the task was queued; 'record()' adds the wait as an event.
+class queue_stamp {
+ public:
+  queue_stamp() : queued_ns_(now_ns()) {}
+
+  void record() const { trace::record("queue wait", queued_ns_, now_ns()); }
+
+ private:
+  uint64_t queued_ns_;
+};
+
+// Records its lifetime as one event. A named scope is a stage: the blocks
+// the thread submits meanwhile are labeled with it.
+class scope {
+ public:
+  explicit scope(const char* stage)
+      : name_(stage), block_(-1), outer_(detail::current_stage),
+        begin_ns_(now_ns()) {
+    detail::current_stage = stage;
+  }
+
+  explicit scope(const block_label& label)
+      : name_(label.stage_ ? label.stage_ : "block"), block_(label.block_),
+        outer_(detail::current_stage), begin_ns_(now_ns()) {}
+
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+
+  ~scope() {
+    record(name_, begin_ns_, now_ns(), block_);
+    detail::current_stage = outer_;
+  }
+
+ private:
+  const char* name_;
+  int block_;
+  const char* outer_;
+  uint64_t begin_ns_;
+};
+
+// Drops every event recorded so far.
+inline void clear() {
+  auto& r = detail::get_registry();
+  std::lock_guard lock(r.mutex);
+  for (const auto& b : r.buffers) {
+    b->size.store(0, std::memory_order_relaxed);
+  }
+}
+
+#define PPL_TRACE_CONCAT_(a, b) a##b
+#define PPL_TRACE_CONCAT(a, b) PPL_TRACE_CONCAT_(a, b)
+#define PPL_TRACE_SCOPE(stage) \
+  const ::core::trace::scope PPL_TRACE_CONCAT(ppl_trace_, __LINE__)(stage)
+
+#else
+
+inline constexpr bool enabled = false;
+
+class block_label {
+ public:
+  explicit constexpr block_label(size_t) {}
+};
+
+class queue_stamp {
+ public:
+  constexpr void record() const {}
+};
+
+class scope {
+ public:
+  explicit constexpr scope(const char*) {}
+  explicit constexpr scope(const block_label&) {}
+};
+
+inline void clear() {}
+
+#define PPL_TRACE_SCOPE(stage) static_cast<void>(0)
+
+#endif
+
+#if defined(PPL_TRACE)
+
+namespace detail {
+
+// the names are string literals, but keep the JSON valid whatever they are
+inline void write_escaped(std::ostream& out, const char* s) {
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') out << '\\';
+    out << *s;
+  }
+}
+
+}  // namespace detail
+
+#endif
+
+// Writes the events of all threads as Chrome trace JSON, one complete ("X")
+// event each, with the block index and core as arguments. Call it once the
+// traced work has finished. Without PPL_TRACE, writes an empty trace.
+inline void write_chrome_json(std::ostream& out) {
+#if defined(PPL_TRACE)
+  auto& r = detail::get_registry();
+  std::lock_guard lock(r.mutex);
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& b : r.buffers) {
+    const auto size = b->size.load(std::memory_order_acquire);
+    const auto n = std::min(size, buffer_capacity);
+
+    out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\","
+        << "\"pid\":0,\"tid\":" << b->tid << ",\"args\":{\"name\":\"thread "
+        << b->tid << "\"}}";
+    first = false;
+
+    // oldest first, if the ring wrapped around
+    for (size_t i = size - n; i < size; ++i) {
+      const auto& e = b->events[i % buffer_capacity];
+      out << ",\n{\"name\":\"";
+      detail::write_escaped(out, e.name);
+      out << "\",\"cat\":\"ppl\",\"ph\":\"X\",\"pid\":0,\"tid\":" << b->tid
+          << ",\"ts\":" << e.begin_ns / 1000 << '.' << e.begin_ns % 1000 / 100
+          << ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000 << '.'
+          << (e.end_ns - e.begin_ns) % 1000 / 100
+          << ",\"args\":{\"block\":" << e.block << ",\"core\":" << e.core
+          << "}}";
+    }
+  }
+  out << "\n]}\n";
+#else
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}\n";
+#endif
+}
+
+// The same, to a file. false if it could not be written.
+inline bool write_chrome_json(const std::string& path) {
+  std::ofstream file(path);
+  if (!file) return false;
+  write_chrome_json(file);
+  return static_cast<bool>(file);
+}
+
+}  // namespace core::trace
@@ -0,0 +1,660 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "spin.hpp"
+#include "utils.hpp"
+
+namespace core {
+
+namespace detail {
+
+// Type-erased 'void()' callable with inline storage. Unlike std::function it
+// never allocates for callables that fit in 'storage_size' bytes (a lambda
+// capturing a few pointers/indices, which is what submit_blocks produces).
+// Larger callables spill to the heap so nothing is rejected at compile time.
+class inline_task {
+ public:
+  static constexpr size_t storage_size = 96;
+
+  inline_task() = default;
+  inline_task(const inline_task&) = delete;
+  inline_task& operator=(const inline_task&) = delete;
+
+  ~inline_task() { reset(); }
+
+  template <typename F>
+  void emplace(F&& f) {
+    using Fn = std::decay_t<F>;
+
+    if constexpr (sizeof(Fn) <= storage_size &&
+                  alignof(Fn) <= alignof(std::max_align_t)) {
+      ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+      invoke_ = [](void* s) { (*static_cast<Fn*>(s))(); };
+      destroy_ = [](void* s) { static_cast<Fn*>(s)->~Fn(); };
+    } else {
+      ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(f)));
+      invoke_ = [](void* s) { (**static_cast<Fn**>(s))(); };
+      destroy_ = [](void* s) { delete *static_cast<Fn**>(s); };
+    }
+  }
+
+  void operator()() { invoke_(storage_); }
+
+  void reset() {
+    if (destroy_) {
+      destroy_(storage_);
+      destroy_ = nullptr;
+      invoke_ = nullptr;
+    }
+  }
+
+ private:
+  alignas(std::max_align_t) std::byte storage_[storage_size];
+  void (*invoke_)(void*) = nullptr;
+  void (*destroy_)(void*) = nullptr;
+};
+
+struct alignas(cache_line_size) task_node {
+  inline_task fn;
+  std::atomic<uint32_t> next{0};
+  bool from_heap = false;
+};
+
+// Rounds a per-pool queue size up to a power of two, at least 'floor'.
+[[nodiscard]] inline size_t queue_capacity(const size_t wanted,
+                                           const size_t floor) {
+  return std::bit_ceil(std::max(wanted, floor));
+}
+
+// Arena of task nodes recycled through a lock-free (Treiber) free list, sized
+// by the owning pool. The head packs a 32-bit index with a 32-bit tag to avoid
+// ABA. When the arena is exhausted we fall back to 'new' instead of blocking
+// the submitter.
+class task_arena {
+ public:
+  explicit task_arena(const uint32_t capacity)
+      : nodes_(std::make_unique<task_node[]>(capacity)) {
+    for (uint32_t i = 0; i < capacity; ++i) {
+      nodes_[i].next.store(i + 1 < capacity ? i + 1 : nil,
+                           std::memory_order_relaxed);
+    }
+    head_.store(pack(capacity ? 0 : nil, 0), std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] task_node* acquire() {
+    auto head = head_.load(std::memory_order_acquire);
+    while (true) {
+      const auto idx = index_of(head);
+      if (idx == nil) {
+        auto* node = new task_node;
+        node->from_heap = true;
+        return node;
+      }
+      const auto next = nodes_[idx].next.load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head,
+                                      pack(next, tag_of(head) + 1),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        return &nodes_[idx];
+      }
+    }
+  }
+
+  void release(task_node* node) {
+    node->fn.reset();
+    if (node->from_heap) {
+      delete node;
+      return;
+    }
+
+    const auto idx = static_cast<uint32_t>(node - nodes_.get());
+    auto head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next.store(index_of(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head,
+                                          pack(idx, tag_of(head) + 1),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+ private:
+  static constexpr uint32_t nil = UINT32_MAX;
+
+  static constexpr uint64_t pack(const uint32_t idx, const uint32_t tag) {
+    return (static_cast<uint64_t>(tag) << 32) | idx;
+  }
+  static constexpr uint32_t index_of(const uint64_t v) {
+    return static_cast<uint32_t>(v);
+  }
+  static constexpr uint32_t tag_of(const uint64_t v) {
+    return static_cast<uint32_t>(v >> 32);
+  }
+
+  std::unique_ptr<task_node[]> nodes_;
+  alignas(cache_line_size) std::atomic<uint64_t> head_;
+};
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP'13) with a fixed ring. Only the
+// owning worker calls push()/pop(); any thread may steal(). The ring is sized
+// once by init() before the workers start; a full ring makes push() fail and
+// the task goes to the injection queue instead.
+class ws_deque {
+ public:
+  void init(const size_t capacity) {
+    buffer_ = std::make_unique<std::atomic<task_node*>[]>(capacity);
+    mask_ = static_cast<int64_t>(capacity) - 1;
+  }
+
+  [[nodiscard]] bool push(task_node* task) {
+    const auto b = bottom_.load(std::memory_order_relaxed);
+    const auto t = top_.load(std::memory_order_acquire);
+    if (b - t > mask_) return false;
+
+    buffer_[b & mask_].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  [[nodiscard]] task_node* pop() {
+    const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    auto* task = buffer_[b & mask_].load(std::memory_order_relaxed);
+    if (t == b) {
+      // last element, race against thieves
+      if (!top_.compare_exchange_strong(t,
+                                        t + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  [[nodiscard]] task_node* steal() {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+
+    auto* task = buffer_[t & mask_].load(std::memory_order_acquire);
+    if (!top_.compare_exchange_strong(t,
+                                      t + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+ private:
+  alignas(cache_line_size) std::atomic<int64_t> top_{0};
+  alignas(cache_line_size) std::atomic<int64_t> bottom_{0};
+  alignas(cache_line_size) std::unique_ptr<std::atomic<task_node*>[]> buffer_;
+  int64_t mask_ = -1;
+};
+
+// Bounded lock-free MPMC queue (D. Vyukov). Used as the injection queue for
+// tasks submitted from threads that are not part of the pool. 'capacity' must
+// be a power of two.
+class mpmc_queue {
+ public:
+  explicit mpmc_queue(const size_t capacity)
+      : cells_(std::make_unique<cell[]>(capacity)), mask(capacity - 1) {
+    for (size_t i = 0; i < capacity; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] bool try_push(task_node* task) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells_[pos & mask];
+      const auto seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          cell.data = task;
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  [[nodiscard]] task_node* try_pop() {
+    auto pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells_[pos & mask];
+      const auto seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          auto* task = cell.data;
+          cell.seq.store(pos + mask + 1, std::memory_order_release);
+          return task;
+        }
+      } else if (diff < 0) {
+        return nullptr;  // empty
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct alignas(cache_line_size) cell {
+    std::atomic<size_t> seq;
+    task_node* data;
+  };
+
+  std::unique_ptr<cell[]> cells_;
+  const size_t mask;
+  alignas(cache_line_size) std::atomic<size_t> head_{0};
+  alignas(cache_line_size) std::atomic<size_t> tail_{0};
+};
+
+// Shared completion state of one submit_blocks() call. One allocation per
+// call instead of one promise + shared_ptr + std::function per block.
+template <typename R>
+struct block_state_base {
+  explicit block_state_base(const size_t n_blocks)
+      : remaining(static_cast<uint32_t>(n_blocks)) {
+    if constexpr (!std::is_void_v<R>) results.resize(n_blocks);
+  }
+  virtual ~block_state_base() = default;
+
+  void finish_one() {
+    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      remaining.notify_all();
+    }
+  }
+
+  void set_exception(std::exception_ptr e) {
+    if (!has_error.exchange(true, std::memory_order_acq_rel)) {
+      error = std::move(e);
+    }
+  }
+
+  std::atomic<uint32_t> remaining;
+  std::atomic<bool> has_error{false};
+  std::exception_ptr error;
+  std::conditional_t<std::is_void_v<R>, std::nullptr_t, std::vector<R>>
+      results{};
+};
+
+template <typename R, typename F>
+struct block_state final : block_state_base<R> {
+  block_state(const size_t n_blocks, F&& f)
+      : block_state_base<R>(n_blocks), block(std::move(f)) {}
+
+  template <typename T>
+  void run(const size_t blk, const T start, const T end) {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        block(start, end);
+      } else {
+        this->results[blk] = block(start, end);
+      }
+    } catch (...) {
+      this->set_exception(std::current_exception());
+    }
+    this->finish_one();
+  }
+
+  F block;
+};
+
+}  // namespace detail
+
+class work_stealing_pool;
+
+/**
+ * @brief Future for a batch of blocks submitted with
+ * work_stealing_pool::submit_blocks. Mirrors multi_future::wait(), but is
+ * backed by a single atomic counter instead of one std::future per block.
+ */
+template <typename T>
+class block_future {
+ public:
+  block_future() = default;
+
+  // Wait for all blocks in the batch. When called from a worker of the owning
+  // pool, the caller keeps executing queued tasks instead of parking.
+  void wait() const;
+
+  // Wait, rethrow the first exception thrown by a block (if any), and return
+  // the per-block results for non-void blocks.
+  auto get() const {
+    wait();
+    if (state_ && state_->has_error.load(std::memory_order_acquire)) {
+      std::rethrow_exception(state_->error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+      return state_ ? state_->results : std::vector<T>{};
+    }
+  }
+
+  [[nodiscard]] bool ready() const {
+    return !state_ ||
+           state_->remaining.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  friend class work_stealing_pool;
+
+  block_future(std::shared_ptr<detail::block_state_base<T>> state,
+               work_stealing_pool* pool)
+      : state_(std::move(state)), pool_(pool) {}
+
+  std::shared_ptr<detail::block_state_base<T>> state_;
+  work_stealing_pool* pool_ = nullptr;
+};
+
+/**
+ * @brief Work-stealing drop-in alternative to core::thread_pool.
+ *
+ * Each worker owns a Chase-Lev deque; tasks submitted from outside the pool go
+ * through a lock-free injection queue, and idle workers steal from each other
+ * before parking on an atomic epoch. Task bodies live in pre-allocated nodes
+ * with inline storage, so submit_blocks() does not allocate per block.
+ *
+ * The submit_task()/submit_blocks() interface matches core::thread_pool, so the
+ * cpu::dispatch_* functions can be instantiated for either pool.
+ */
+class work_stealing_pool {
+ public:
+  explicit work_stealing_pool(int n_threads)
+      : queues_(static_cast<size_t>(n_threads)),
+        injection_(detail::queue_capacity(n_threads * injection_per_worker,
+                                          min_injection_capacity)),
+        arena_(static_cast<uint32_t>(n_threads * arena_per_worker)) {
+    init_deques();
+    workers_.reserve(n_threads);
+    for (int i = 0; i < n_threads; ++i) {
+      workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+  }
+
+  explicit work_stealing_pool(std::vector<int> core_ids,
+                              bool enable_pinning = false)
+      : queues_(core_ids.size()),
+        injection_(detail::queue_capacity(
+            core_ids.size() * injection_per_worker, min_injection_capacity)),
+        arena_(static_cast<uint32_t>(core_ids.size() * arena_per_worker)) {
+    init_deques();
+    workers_.reserve(core_ids.size());
+    for (size_t i = 0; i < core_ids.size(); ++i) {
+      workers_.emplace_back([this, i, id = core_ids[i], enable_pinning] {
+        // Pin the thread to the specified core only if enabled
+        if (enable_pinning) {
+          utils::set_cpu_affinity(id);
+        }
+        worker_loop(i);
+      });
+    }
+  }
+
+  work_stealing_pool(const work_stealing_pool&) = delete;
+  work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+  ~work_stealing_pool() {
+    stop_flag_.store(true, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    epoch_.notify_all();
+
+    for (std::thread& worker : workers_)
+      if (worker.joinable()) worker.join();
+  }
+
+  [[nodiscard]] size_t get_thread_count() const { return workers_.size(); }
+
+  template <class F, class... Args>
+  auto submit_task(F&& f, Args&&... args)
+      -> std::future<typename std::invoke_result_t<F, Args...>> {
+    using ReturnType = typename std::invoke_result_t<F, Args...>;
+
+    if (stop_flag_.load(std::memory_order_relaxed))
+      throw std::runtime_error("submit_task on stopped work_stealing_pool");
+
+    std::promise<ReturnType> promise;
+    auto future = promise.get_future();
+
+    enqueue([promise = std::move(promise),
+             fn = std::bind(std::forward<F>(f),
+                            std::forward<Args>(args)...)]() mutable {
+      try {
+        if constexpr (std::is_void_v<ReturnType>) {
+          fn();
+          promise.set_value();
+        } else {
+          promise.set_value(fn());
+        }
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+      }
+    });
+
+    return future;
+  }
+
+  template <typename T,
+            typename F,
+            typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+  [[nodiscard]] block_future<R> submit_blocks(const T first_index,
+                                              const T index_after_last,
+                                              F&& block,
+                                              const size_t num_blocks = 0) {
+    if (index_after_last <= first_index) return {};
+
+    const size_t M = num_blocks ? num_blocks : workers_.size();
+    const T block_size = (index_after_last - first_index + M - 1) / M;
+    const size_t n_blocks =
+        (index_after_last - first_index + block_size - 1) / block_size;
+
+    using state_t = detail::block_state<R, std::decay_t<F>>;
+    auto state = std::make_shared<state_t>(n_blocks, std::decay_t<F>(block));
+
+    for (size_t i = 0; i < n_blocks; ++i) {
+      const T start = first_index + i * block_size;
+      const T end = std::min<T>(start + block_size, index_after_last);
+      enqueue([state, i, start, end] { state->run(i, start, end); });
+    }
+
+    return block_future<R>(std::move(state), this);
+  }
+
+  // Execute one pending task on the calling thread, if there is any. Used by
+  // block_future::wait() so that workers never block on their own children.
+  bool try_run_pending_task() {
+    const auto self = (tl_pool_ == this) ? tl_index_ : npos;
+    if (auto* task = find_task(self)) {
+      run(task);
+      return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool is_worker_thread() const { return tl_pool_ == this; }
+
+ private:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+  static constexpr int spin_count = 2048;
+
+  // Queue and arena sizes scale with the worker count instead of being fixed
+  // per pool. A submit_blocks() batch is one block per worker by default, so a
+  // few batches in flight fit without touching the heap fallback; anything
+  // beyond that spills to the injection queue or to 'new' rather than failing.
+  static constexpr size_t deque_per_worker = 16;
+  static constexpr size_t min_deque_capacity = 64;
+  static constexpr size_t injection_per_worker = 32;
+  static constexpr size_t min_injection_capacity = 128;
+  static constexpr size_t arena_per_worker = 64;
+
+  void init_deques() {
+    const auto capacity = detail::queue_capacity(
+        queues_.size() * deque_per_worker, min_deque_capacity);
+    for (auto& q : queues_) q.deque.init(capacity);
+  }
+
+  struct alignas(detail::cache_line_size) worker_queue {
+    detail::ws_deque deque;
+  };
+
+  template <typename Fn>
+  void enqueue(Fn&& fn) {
+    auto* node = arena_.acquire();
+    node->fn.emplace(std::forward<Fn>(fn));
+
+    // Workers push onto their own deque (LIFO, cache-hot), everyone else goes
+    // through the injection queue. A worker that finds both full runs a
+    // pending task before retrying: if every worker only waited, nobody
+    // would drain the queues.
+    if (tl_pool_ != this || !queues_[tl_index_].deque.push(node)) {
+      while (!injection_.try_push(node)) {
+        if (tl_pool_ != this || !try_run_pending_task()) {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (n_sleeping_.load(std::memory_order_seq_cst) > 0) {
+      epoch_.notify_one();
+    }
+  }
+
+  detail::task_node* find_task(const size_t self) {
+    if (self != npos) {
+      if (auto* task = queues_[self].deque.pop()) return task;
+    }
+
+    if (auto* task = injection_.try_pop()) return task;
+
+    const auto n = queues_.size();
+    const auto begin = (self == npos) ? 0 : self + 1;
+    for (size_t k = 0; k < n; ++k) {
+      const auto victim = (begin + k) % n;
+      if (victim == self) continue;
+      if (auto* task = queues_[victim].deque.steal()) return task;
+    }
+    return nullptr;
+  }
+
+  void run(detail::task_node* task) {
+    task->fn();
+    arena_.release(task);
+  }
+
+  void worker_loop(const size_t index) {
+    tl_pool_ = this;
+    tl_index_ = index;
+
+    while (true) {
+      if (auto* task = find_task(index)) {
+        run(task);
+        continue;
+      }
+
+      // Spin for a short while before parking, the next stage usually follows
+      // right after the previous one finished.
+      bool found = false;
+      for (int i = 0; i < spin_count; ++i) {
+        detail::cpu_relax();
+        if (auto* task = find_task(index)) {
+          run(task);
+          found = true;
+          break;
+        }
+      }
+      if (found) continue;
+
+      const auto epoch = epoch_.load(std::memory_order_seq_cst);
+      n_sleeping_.fetch_add(1, std::memory_order_seq_cst);
+
+      if (auto* task = find_task(index)) {
+        n_sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+        run(task);
+        continue;
+      }
+
+      if (stop_flag_.load(std::memory_order_seq_cst)) {
+        n_sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+        return;
+      }
+
+      epoch_.wait(epoch, std::memory_order_seq_cst);
+      n_sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+  }
+
+  inline static thread_local work_stealing_pool* tl_pool_ = nullptr;
+  inline static thread_local size_t tl_index_ = npos;
+
+  std::vector<worker_queue> queues_;
+  detail::mpmc_queue injection_;
+  detail::task_arena arena_;
+
+  alignas(detail::cache_line_size) std::atomic<uint32_t> epoch_{0};
+  alignas(detail::cache_line_size) std::atomic<int> n_sleeping_{0};
+  std::atomic<bool> stop_flag_{false};
+
+  std::vector<std::thread> workers_;
+};
+
+template <typename T>
+void block_future<T>::wait() const {
+  if (!state_) return;
+
+  auto remaining = state_->remaining.load(std::memory_order_acquire);
+  if (remaining == 0) return;
+
+  // Help out instead of blocking when waiting from inside the pool
+  if (pool_ && pool_->is_worker_thread()) {
+    while (state_->remaining.load(std::memory_order_acquire) != 0) {
+      if (!pool_->try_run_pending_task()) detail::cpu_relax();
+    }
+    return;
+  }
+
+  while (remaining != 0) {
+    state_->remaining.wait(remaining, std::memory_order_acquire);
+    remaining = state_->remaining.load(std::memory_order_acquire);
+  }
+}
+
+}  // namespace core
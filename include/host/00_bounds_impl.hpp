@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+#include "shared/structures.h"
+
+namespace cpu {
+
+// Parallel min/max reduction over the input points of 'p', read from its
+// active point layout. Every block reduces its range, the block results are
+// merged on the calling thread. Returns an empty box ('lower > upper') for no
+// points. See the explicit instantiations in 00_bounds_impl.cpp for the
+// supported pools and keys.
+template <typename Pool, typename Key>
+[[nodiscard]] shared::Aabb dispatch_parallel_bounds(Pool& pool,
+                                                    size_t n_threads,
+                                                    const BasicPipe<Key>& p);
+
+}  // namespace cpu
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "shared/morton_func.h"
+#include "shared/structures.h"
+
+namespace cpu {
+
+// Vectorized variants of 'shared::xyz_to_morton32'. Every kernel produces
+// bit-identical codes for points inside [min_xyz, min_xyz + range_xyz]: the
+// float math is the same per-axis sub/div/mul in single precision, truncated,
+// masked to 10 bits and spread with the same magic bits (or 'pdep').
+//   kScalar: the reference loop, always available
+//   kBmi2:   scalar, spreads the bits with one 'pdep' per axis. Microcoded on
+//            AMD before Zen 3, so never picked by kAuto over a vector kernel.
+//   kSse:    4 points per iteration, SSE2 (the x86-64 baseline)
+//   kAvx2:   8 points per iteration
+//   kAvx512: 16 points per iteration (AVX-512F)
+//   kNeon:   4 points per iteration, AArch64 only
+// kAuto resolves to 'best_morton_kernel()'.
+enum class MortonKernel { kAuto, kScalar, kBmi2, kSse, kAvx2, kAvx512, kNeon };
+
+// Whether this build and the CPU it runs on can execute 'kernel', checked once.
+[[nodiscard]] bool morton_kernel_supported(MortonKernel kernel);
+
+// The widest supported vector kernel, kScalar if there is none.
+[[nodiscard]] MortonKernel best_morton_kernel();
+
+[[nodiscard]] const char* morton_kernel_name(MortonKernel kernel);
+
+// Encodes 'u_points[0, n)' into 'u_morton'. Single threaded, the dispatchers
+// call it per block. Throws std::invalid_argument if 'kernel' is not
+// supported.
+void encode_morton32(const glm::vec4* u_points,
+                     int n,
+                     const glm::vec3& min_xyz,
+                     const glm::vec3& range_xyz,
+                     morton_t* u_morton,
+                     MortonKernel kernel = MortonKernel::kAuto);
+
+// Same as above for the other point layouts (see 'shared::PointLayout'): one
+// array per axis, and 12-byte 'x y z' points.
+void encode_morton32_soa(const float* u_xs,
+                         const float* u_ys,
+                         const float* u_zs,
+                         int n,
+                         const glm::vec3& min_xyz,
+                         const glm::vec3& range_xyz,
+                         morton_t* u_morton,
+                         MortonKernel kernel = MortonKernel::kAuto);
+
+void encode_morton32_packed3(const glm::vec3* u_points,
+                             int n,
+                             const glm::vec3& min_xyz,
+                             const glm::vec3& range_xyz,
+                             morton_t* u_morton,
+                             MortonKernel kernel = MortonKernel::kAuto);
+
+// Encodes the points [begin, end) of 'p' from its active layout into
+// 'p.u_morton + begin', quantized to the pipe's box ('box_min', 'box_range').
+void encode_morton32(const Pipe& p,
+                     int begin,
+                     int end,
+                     MortonKernel kernel = MortonKernel::kAuto);
+
+}  // namespace cpu
@@ -1,17 +1,108 @@
 #pragma once
 
 #include <barrier>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "core/thread_pool.hpp"
 #include "shared/morton_func.h"
+#include "shared/sort_plan.h"
 
 namespace cpu {
 
-core::multi_future<void> dispatch_binning_pass(core::thread_pool& pool,
+// 'Pool' is any pool with a 'submit_task' returning std::future<void>, see
+// the explicit instantiations in 02_sort_impl.cpp
+template <typename Pool>
+core::multi_future<void> dispatch_binning_pass(Pool& pool,
                                                const size_t n_threads,
                                                std::barrier<>& barrier,
                                                const int n,
                                                const morton_t* u_sort,
                                                morton_t* u_sort_alt,
                                                const int shift);
-}
\ No newline at end of file
+
+// How the parallel LSD sort writes keys to their destination buckets.
+// kWriteCombining stages keys in per-digit cache-line buffers and flushes them
+// with non-temporal stores, which helps cores with small L1/TLBs. It plans
+// with digits of at most 8 bits so that the buffers stay L1 resident.
+enum class ScatterMode { kDirect, kWriteCombining };
+
+// Facts about the keys that a producer (e.g. the morton code stage) gathered
+// per block while writing them, so the sort can skip its planning scan and the
+// histogram of the first digit. Block i is 'bounds[i]' to 'bounds[i + 1]';
+// the sort only uses the hints if it cuts the keys into the same blocks.
+template <typename Key = morton_t>
+struct SortHints {
+  static constexpr int kBins = 1 << shared::kMaxRadixBits;
+
+  explicit SortHints(std::vector<int> block_bounds)
+      : bounds(std::move(block_bounds)),
+        and_bits(n_blocks(), ~Key{0}),
+        or_bits(n_blocks(), 0),
+        low_histograms(n_blocks() * kBins) {}
+
+  [[nodiscard]] size_t n_blocks() const { return bounds.size() - 1; }
+
+  // Count 'code' as part of block 'blk'
+  void add(const size_t blk, const Key code) {
+    and_bits[blk] &= code;
+    or_bits[blk] |= code;
+    ++histogram(blk)[code & (kBins - 1)];
+  }
+
+  [[nodiscard]] int* histogram(const size_t blk) {
+    return low_histograms.data() + blk * kBins;
+  }
+  [[nodiscard]] const int* histogram(const size_t blk) const {
+    return low_histograms.data() + blk * kBins;
+  }
+
+  std::vector<int> bounds;
+  std::vector<Key> and_bits;
+  std::vector<Key> or_bits;
+  std::vector<int> low_histograms;  // [block][lowest kMaxRadixBits bits]
+};
+
+// Reentrant parallel LSD radix sort. A first scan over the keys finds the bits
+// that vary and 'shared::make_radix_plan' picks the digit widths, constant
+// digits are skipped. Per-thread histograms form a [thread][digit] matrix that
+// is scanned in parallel, so the scatter needs no locks. The sorted keys end
+// up back in 'u_sort'. Blocks until done, 'pool' needs at least 'n_threads'
+// workers. 'Key' is 'morton_t' or 'morton64_t'; 64-bit keys take up to
+// 'shared::kMaxRadixPasses' passes, fewer when their high bits are constant.
+template <typename Pool, typename Key>
+void dispatch_parallel_radix_sort(Pool& pool,
+                                  size_t n_threads,
+                                  int n,
+                                  Key* u_sort,
+                                  Key* u_sort_alt,
+                                  ScatterMode mode = ScatterMode::kDirect);
+
+// Same sort, carrying a uint32 payload with every key. 'u_index' does not need
+// to be initialized: it receives the original position of each key, i.e. the
+// permutation that sorts the input.
+template <typename Pool, typename Key>
+void dispatch_parallel_radix_sort_kv(Pool& pool,
+                                     size_t n_threads,
+                                     int n,
+                                     Key* u_sort,
+                                     Key* u_sort_alt,
+                                     uint32_t* u_index,
+                                     uint32_t* u_index_alt,
+                                     ScatterMode mode = ScatterMode::kDirect);
+
+// Same sort with duplicate removal fused into the last scatter: run heads are
+// counted while scattering, so only the compacted write is left afterwards.
+// Sorted keys end in 'u_sort', unique keys in 'u_sort_alt'. Returns the number
+// of unique keys.
+template <typename Pool, typename Key>
+[[nodiscard]] int dispatch_parallel_radix_sort_unique(
+    Pool& pool,
+    size_t n_threads,
+    int n,
+    Key* u_sort,
+    Key* u_sort_alt,
+    ScatterMode mode = ScatterMode::kDirect,
+    const SortHints<Key>* hints = nullptr);
+}
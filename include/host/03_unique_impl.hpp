@@ -0,0 +1,21 @@
+#pragma once
+
+#include "shared/morton_func.h"
+
+namespace cpu {
+
+// Parallel stream compaction of a sorted array. Each block flags the heads of
+// its runs in 'u_flag_heads' and counts them, the block counts are scanned,
+// then every block writes its heads to 'u_unique' at its offset. Returns the
+// number of unique keys. 'u_sorted' and 'u_unique' must not overlap. See the
+// explicit instantiations in 03_unique_impl.cpp for the supported pools and
+// keys ('morton_t' and 'morton64_t').
+template <typename Pool, typename Key>
+[[nodiscard]] int dispatch_parallel_unique(Pool& pool,
+                                           size_t n_threads,
+                                           int n,
+                                           const Key* u_sorted,
+                                           Key* u_unique,
+                                           int* u_flag_heads);
+
+}  // namespace cpu
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cpu {
+
+// Parallel inclusive scan in three phases: every block reduces its range,
+// the block sums are scanned, and every block scans its range again starting
+// from its offset. The inner loops use NEON/SSE2/AVX2 where available.
+// Returns the total. 'u_in' and 'u_out' may be the same array. See the
+// explicit instantiations in 06_scan_impl.cpp for the supported pools.
+template <typename Pool>
+int dispatch_parallel_inclusive_scan(
+    Pool& pool, size_t n_threads, int n, const int* u_in, int* u_out);
+
+// Phases 2 and 3 only, for callers that already produced the block sums
+// while writing 'u_in'. 'block_sums' holds one entry per block of
+// 'partition_blocks(pool, 0, n, n_threads)'.
+template <typename Pool>
+int dispatch_scan_with_block_sums(Pool& pool,
+                                  size_t n_threads,
+                                  int n,
+                                  const int* u_in,
+                                  int* u_out,
+                                  const int* block_sums);
+
+}  // namespace cpu
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "host/fused_pipeline.hpp"
+#include "shared/structures.h"
+
+namespace cpu {
+
+// Picks the cluster and thread count of every 'FusedPhase' from the first
+// frames. While tuning, 'plan()' steps through the candidates (every cluster
+// with 1, 2, 4, ... and all of its threads) for all phases at once, for
+// 'frames_per_candidate' frames each, and 'record()' keeps the best time of
+// every phase per candidate. Once all candidates ran, each phase gets its
+// fastest one.
+//
+// The tuned plan is stored in 'path' under 'device_id', next to the plans of
+// other devices, and loaded instead of tuning again as long as the clusters
+// have the same thread counts. A plan that cannot be written is still used.
+class PipelineTuner {
+ public:
+  // 'cluster_threads[c]': the threads of the pool of cluster 'c'
+  PipelineTuner(std::string device_id,
+                std::vector<int> cluster_threads,
+                std::string path,
+                int frames_per_candidate = 2);
+
+  // false while trying candidates
+  [[nodiscard]] bool tuned() const { return tuned_; }
+
+  // for the next frame
+  [[nodiscard]] const PipelinePlan& plan() const { return plan_; }
+
+  // The timings of a frame that ran with 'plan()'.
+  void record(const PipelineTimings& t);
+
+ private:
+  [[nodiscard]] bool load();
+  void save() const;
+
+  std::string device_id_;
+  std::vector<int> cluster_threads_;
+  std::string path_;
+  int frames_per_candidate_;
+
+  std::vector<PhasePlacement> candidates_;
+  // best time of every phase per candidate, [candidate][phase]
+  std::vector<std::array<double, kNumFusedPhases>> best_ms_;
+  int frame_ = 0;
+
+  bool tuned_ = false;
+  PipelinePlan plan_;
+};
+
+// One frame of 'run_fused_pipeline' with the plan of 'tuner'.
+template <typename Pool>
+void run_tuned_pipeline(const std::span<Pool* const> clusters,
+                        PipelineTuner& tuner,
+                        const std::shared_ptr<Pipe>& p,
+                        PipelineTimings* timings = nullptr) {
+  PipelineTimings t;
+  run_fused_pipeline(clusters, tuner.plan(), p, &t);
+  tuner.record(t);
+  if (timings) *timings = t;
+}
+
+}  // namespace cpu
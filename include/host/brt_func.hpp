@@ -8,9 +8,11 @@
 namespace cpu {
 #if defined(__GNUC__) || defined(__clang__)
 #define CLZ(x) __builtin_clz(x)
+#define CLZ64(x) __builtin_clzll(x)
 #elif defined(_MSC_VER)
 #include <intrin.h>
 #define CLZ(x) _lzcnt_u32(x)
+#define CLZ64(x) _lzcnt_u64(x)
 #else
 #error "CLZ not supported on this platform"
 #endif
@@ -20,12 +22,30 @@ inline unsigned int ceil_div_u32(const unsigned int a, const unsigned int b) {
   return (a + b - 1) / b;
 }
 
+// Common prefix of two 30-bit keys, so at most 29 for distinct keys and the
+// leaves sit on level 10 like the 63-bit keys' sit on level 21
 inline uint8_t delta_u32(const unsigned int a, const unsigned int b) {
-  [[maybe_unused]] constexpr unsigned int bit1_mask =
-      static_cast<unsigned int>(1) << (sizeof(a) * 8 - 1);
+  constexpr int unused_bits = sizeof(a) * 8 - morton_bits;
+  [[maybe_unused]] constexpr unsigned int unused_mask =
+      ~((static_cast<unsigned int>(1) << morton_bits) - 1);
+  assert((a & unused_mask) == 0);
+  assert((b & unused_mask) == 0);
+  return static_cast<uint8_t>(CLZ(a ^ b) - unused_bits);
+}
+
+// Same for 63-bit keys, the result is at most 62 so it still fits 'prefix_n'
+inline uint8_t delta_u64(const uint64_t a, const uint64_t b) {
+  [[maybe_unused]] constexpr uint64_t bit1_mask = uint64_t{1} << 63;
   assert((a & bit1_mask) == 0);
   assert((b & bit1_mask) == 0);
-  return static_cast<uint8_t>(CLZ(a ^ b) - 1);
+  return static_cast<uint8_t>(CLZ64(a ^ b) - 1);
+}
+
+inline uint8_t delta(const morton_t a, const morton_t b) {
+  return delta_u32(a, b);
+}
+inline uint8_t delta(const morton64_t a, const morton64_t b) {
+  return delta_u64(a, b);
 }
 
 inline int log2_ceil_u32(const unsigned int x) {
@@ -38,10 +58,12 @@ inline int log2_ceil_u32(const unsigned int x) {
   return static_cast<int>(n_lower_bits + ((1 << n_lower_bits) < x));
 }
 
-inline void process_radix_tree_i(const int i,
-                                 const int n /*n_brt_nodes*/,
-                                 const morton_t* codes,
-                                 const RadixTree* out_brt) {
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA,
+          typename Key = morton_t>
+void process_radix_tree_i(const int i,
+                          const int n /*n_brt_nodes*/,
+                          const Key* codes,
+                          const RadixTree* out_brt) {
   // 'i' is the iterator within a chunk
   // 'codes' is the base address of the whole data, for each chunk, we need to
   // use the offset 'out_brt' is the base address of the whole data, for each
@@ -49,19 +71,18 @@ inline void process_radix_tree_i(const int i,
 
   const auto code_i = codes[i];
 
-  const auto prefix_n = out_brt->u_prefix_n;
-  const auto has_leaf_left = out_brt->u_has_leaf_left;
-  const auto has_leaf_right = out_brt->u_has_leaf_right;
-  const auto left_child = out_brt->u_left_child;
-  const auto parent = out_brt->u_parents;
+  const auto brt = out_brt->view<Layout>();
 
   // Determine direction of the range (+1 or -1)
   int d;
   if (i == 0) {
     d = 1;
+    // the root is its own parent, as on the GPU: it adds no edges, and the
+    // walks up the tree stop there
+    brt.set_parent(0, 0);
   } else {
-    const auto delta_diff_right = delta_u32(code_i, codes[i + 1]);
-    const auto delta_diff_left = delta_u32(code_i, codes[i - 1]);
+    const auto delta_diff_right = delta(code_i, codes[i + 1]);
+    const auto delta_diff_left = delta(code_i, codes[i - 1]);
     const auto direction_difference = delta_diff_right - delta_diff_left;
     d = (direction_difference > 0) - (direction_difference < 0);
   }
@@ -70,16 +91,16 @@ inline void process_radix_tree_i(const int i,
 
   auto l = 0;
   if (i == 0) {
-    // First node is root, covering whole tree
-    l = n - 1;
+    // First node is root, covering all 'n + 1' keys
+    l = n;
   } else {
-    const auto delta_min = delta_u32(code_i, codes[i - d]);
+    const auto delta_min = delta(code_i, codes[i - d]);
     auto l_max = 2;
     // Cast to ptrdiff_t so in case the result is negative (since d is +/- 1),
     // we can catch it and not index out of bounds
     while (i + static_cast<std::ptrdiff_t>(l_max) * d >= 0 &&
            i + l_max * d <= n &&
-           delta_u32(code_i, codes[i + l_max * d]) > delta_min) {
+           delta(code_i, codes[i + l_max * d]) > delta_min) {
       l_max *= 2;
     }
     const auto l_cutoff = (d == -1) ? i : n - i;
@@ -89,7 +110,7 @@ inline void process_radix_tree_i(const int i,
     for (t = l_max / 2, divisor = 2; t >= 1;
          divisor *= 2, t = l_max / divisor) {
       if (l + t <= l_cutoff &&
-          delta_u32(code_i, codes[i + (l + t) * d]) > delta_min) {
+          delta(code_i, codes[i + (l + t) * d]) > delta_min) {
         l += t;
       }
     }
@@ -98,8 +119,7 @@ inline void process_radix_tree_i(const int i,
   const auto j = i + l * d;
 
   // Find the split position using binary search
-  const auto delta_node = delta_u32(codes[i], codes[j]);
-  prefix_n[i] = delta_node;
+  const auto delta_node = delta(codes[i], codes[j]);
   auto s = 0;
   const auto max_divisor = 1 << log2_ceil_u32(l);
   auto divisor = 2;
@@ -107,24 +127,24 @@ inline void process_radix_tree_i(const int i,
   for (auto t = ceil_div_u32(l, 2); divisor <= max_divisor;
        divisor <<= 1, t = ceil_div_u32(l, divisor)) {
     if (s + t <= s_cutoff &&
-        delta_u32(code_i, codes[i + (s + t) * d]) > delta_node) {
+        delta(code_i, codes[i + (s + t) * d]) > delta_node) {
       s += t;
     }
   }
 
   // Split position
   const auto gamma = i + s * d + std::min(d, 0);
-  left_child[i] = gamma;
-  has_leaf_left[i] = (std::min(i, j) == gamma);
-  has_leaf_right[i] = (std::max(i, j) == gamma + 1);
+  const bool has_leaf_left = (std::min(i, j) == gamma);
+  const bool has_leaf_right = (std::max(i, j) == gamma + 1);
+  brt.set_node(i, delta_node, gamma, has_leaf_left, has_leaf_right);
   // Set parents of left and right children, if they aren't leaves
   // can't set this node as parent of its leaves, because the
   // leaf also represents an internal node with a differnent parent
-  if (!has_leaf_left[i]) {
-    parent[gamma] = i;
+  if (!has_leaf_left) {
+    brt.set_parent(gamma, i);
   }
-  if (!has_leaf_right[i]) {
-    parent[gamma + 1] = i;
+  if (!has_leaf_right) {
+    brt.set_parent(gamma + 1, i);
   }
 }
 }  // namespace cpu
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "shared/structures.h"
+
+namespace cpu {
+
+// A pool and how many of its threads a group of stages may use, e.g. a
+// 'core::thread_pool' pinned to the big cores of 'PhoneSpecs'.
+template <typename Pool>
+struct StageCluster {
+  Pool& pool;
+  int num_threads;
+};
+
+struct FrameStats {
+  int n_frames = 0;
+  // after the first 'pipes.size()' frames, which only fill the pipeline
+  double frames_per_sec = 0.0;
+  double mean_latency_ms = 0.0;
+  double max_latency_ms = 0.0;
+  // from the start of 'fill' to the end of 'consume', for every frame
+  std::vector<double> latency_ms;
+};
+
+// Called with the pipe that takes frame 'frame'. 'fill' writes the points
+// (calling 'Pipe::reset()' first if the frame size changes), 'consume' reads
+// the finished octree before the pipe is reused.
+using FillFrame = std::function<void(Pipe& p, int frame)>;
+using ConsumeFrame = std::function<void(const Pipe& p, int frame)>;
+
+// Runs 'n_frames' frames through the pipeline with up to 'pipes.size()'
+// frames in flight, so the stages of consecutive frames overlap:
+//   front (one thread + 'front'): fill, morton codes, sort + unique
+//   back  (one thread + 'back'):  radix tree, edge count + offset, octree
+// The stages are the staged 'dispatch_*' calls, so every frame produces the
+// same octree as on its own. Bounded queues connect the two halves: the
+// front waits for a free pipe, the back for a sorted frame. With one pipe
+// the frames run back to back.
+//
+// 'front' and 'back' may share a pool. Frames are consumed in order, on the
+// back thread. The first exception of either half stops both and is
+// rethrown. Instantiated for the same pools as host_dispatcher.hpp.
+template <typename Pool>
+FrameStats run_frame_pipeline(StageCluster<Pool> front,
+                              StageCluster<Pool> back,
+                              std::span<const std::shared_ptr<Pipe>> pipes,
+                              int n_frames,
+                              const FillFrame& fill,
+                              const ConsumeFrame& consume = {});
+
+}  // namespace cpu
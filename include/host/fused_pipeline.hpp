@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+
+#include "shared/structures.h"
+
+namespace cpu {
+
+// Wall time of every phase of 'run_fused_pipeline', in milliseconds.
+struct PipelineTimings {
+  double morton_ms = 0.0;       // bounds + morton codes + sort hints
+  double sort_unique_ms = 0.0;  // radix sort + remove duplicates
+  double radix_tree_ms = 0.0;
+  double edge_ms = 0.0;  // edge count + edge offset
+  double octree_ms = 0.0;
+  double total_ms = 0.0;
+
+  PipelineTimings& operator+=(const PipelineTimings& other) {
+    morton_ms += other.morton_ms;
+    sort_unique_ms += other.sort_unique_ms;
+    radix_tree_ms += other.radix_tree_ms;
+    edge_ms += other.edge_ms;
+    octree_ms += other.octree_ms;
+    total_ms += other.total_ms;
+    return *this;
+  }
+};
+
+// The phases of 'run_fused_pipeline', in order.
+enum class FusedPhase { kMorton, kSortUnique, kRadixTree, kEdge, kOctree };
+inline constexpr int kNumFusedPhases = 5;
+
+[[nodiscard]] inline double phase_ms(const PipelineTimings& t,
+                                     const FusedPhase phase) {
+  switch (phase) {
+    case FusedPhase::kMorton:
+      return t.morton_ms;
+    case FusedPhase::kSortUnique:
+      return t.sort_unique_ms;
+    case FusedPhase::kRadixTree:
+      return t.radix_tree_ms;
+    case FusedPhase::kEdge:
+      return t.edge_ms;
+    case FusedPhase::kOctree:
+      return t.octree_ms;
+  }
+  return 0.0;
+}
+
+// Where a phase runs: the index of a pool (one per core cluster) and how
+// many blocks to cut its work into.
+struct PhasePlacement {
+  int cluster = 0;
+  int num_threads = 1;
+
+  bool operator==(const PhasePlacement&) const = default;
+};
+
+// One placement per 'FusedPhase'
+using PipelinePlan = std::array<PhasePlacement, kNumFusedPhases>;
+
+// Runs all seven stages of the pipeline, fusing the ones that can share a
+// sweep over the data:
+//   1. bounds, then morton codes, while the same block also gathers the key
+//      bits and the first digit histogram the radix sort would otherwise read
+//      them for,
+//   2. radix sort + remove duplicates (run heads counted in the last pass),
+//   3. radix tree,
+//   4. edge count + the block sums of the edge offset scan, then the scan,
+//   5. octree.
+// Only the phase boundaries are global barriers: the radix tree needs all
+// unique codes, the edge count reads the prefix length of the parent, which may
+// be in any block, and the octree links nodes across blocks.
+//
+// The radix tree stages use the layout 'p->brt' is allocated in, see
+// 'BasicPipe::use_brt_layout()'.
+//
+// Produces the same 'p' as the staged 'dispatch_*' calls. 'timings', if given,
+// receives the time of every phase. Instantiated for the same pools as
+// host_dispatcher.hpp.
+template <typename Pool>
+void run_fused_pipeline(Pool& pool,
+                        int num_threads,
+                        const std::shared_ptr<Pipe>& p,
+                        PipelineTimings* timings = nullptr);
+
+// The same, with every phase on the pool and thread count 'plan' picks for
+// it, e.g. from a 'PipelineTuner'. The sort reuses the morton hints only if
+// both phases cut the input into the same blocks.
+template <typename Pool>
+void run_fused_pipeline(std::span<Pool* const> clusters,
+                        const PipelinePlan& plan,
+                        const std::shared_ptr<Pipe>& p,
+                        PipelineTimings* timings = nullptr);
+
+}  // namespace cpu
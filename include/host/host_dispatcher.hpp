@@ -3,67 +3,181 @@
 #include <memory>
 
 #include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "host/01_morton_impl.hpp"
+#include "shared/brt_layout.h"
 #include "shared/structures.h"
 #include "third-party/BS_thread_pool.hpp"
 
 namespace cpu {
 
-void dispatch_MortonCode(core::thread_pool& pool,
+// Every stage is a template over the pool type. They are explicitly
+// instantiated (in host_dispatcher.cpp) for:
+//   - core::thread_pool
+//   - core::work_stealing_pool
+//   - BS::thread_pool
+//
+// The stages from the radix tree on also take the node layout of the radix
+// tree (see shared/brt_layout.h), e.g.
+// 'dispatch_BuildRadixTree<shared::BrtLayout::kPacked>(pool, n, p)'. All of
+// them must use the layout the tree is allocated in ('use_brt_layout()'),
+// they throw otherwise.
+//
+// Every stage has an overload for 'Pipe' (32-bit morton codes) and 'Pipe64'
+// (64-bit, 21 levels). The 64-bit sort has no 'RadixSortVariant::kBinning'.
+
+// Zeroes all per-point arrays of 'p' in the same blocks the stages process,
+// from the pool's workers. With an arena-backed pipe (or any fresh 'mmap'
+// memory) the pages are placed on the node of the worker that uses them.
+// Call it once after constructing or growing the pipe, before the points
+// are filled in.
+template <typename Pool>
+void dispatch_FirstTouch(Pool& pool,
                          int num_threads,
-                         const std::shared_ptr<const Pipe>& p);
-
-void dispatch_RadixSort(core::thread_pool& pool,
-                        int num_threads,
-                        const std::shared_ptr<const Pipe>& p);
-
-void dispatch_RemoveDuplicates(core::thread_pool& pool,
-                               int num_threads,
-                               const std::shared_ptr<Pipe>& p);
-
-void dispatch_BuildRadixTree(core::thread_pool& pool,
-                             int num_threads,
-                             const std::shared_ptr<const Pipe>& p);
-
-void dispatch_EdgeCount(core::thread_pool& pool,
-                        int num_threads,
-                        const std::shared_ptr<const Pipe>& p);
-
-void dispatch_EdgeOffset(core::thread_pool& pool,
+                         const std::shared_ptr<Pipe>& p);
+template <typename Pool>
+void dispatch_FirstTouch(Pool& pool,
                          int num_threads,
-                         const std::shared_ptr<const Pipe>& p);
-
-void dispatch_BuildOctree(core::thread_pool& pool,
-                          int num_threads,
-                          const std::shared_ptr<const Pipe>& p);
-
-// ----------------------------------------------------------------------------
-
-void dispatch_MortonCode(BS::thread_pool& pool,
+                         const std::shared_ptr<Pipe64>& p);
+
+// Sets the quantization box of 'p' ('box_min', 'box_range') for its
+// 'bounds_mode': a parallel min/max reduction over the points in the kAabb
+// modes, the fixed cube in kFixed. 'dispatch_MortonCode' runs it first, so
+// it is only needed on its own to inspect the box.
+template <typename Pool>
+void dispatch_ComputeBounds(Pool& pool,
+                            int num_threads,
+                            const std::shared_ptr<Pipe>& p);
+template <typename Pool>
+void dispatch_ComputeBounds(Pool& pool,
+                            int num_threads,
+                            const std::shared_ptr<Pipe64>& p);
+
+// Computes the bounds (see above), then the codes. 'kernel' picks the SIMD
+// encoder, see host/01_morton_impl.hpp. All of them give the same codes,
+// kAuto takes the widest one the CPU supports.
+template <typename Pool>
+void dispatch_MortonCode(Pool& pool,
                          int num_threads,
-                         const std::shared_ptr<const Pipe>& p);
-
-void dispatch_RadixSort(BS::thread_pool& pool,
-                        int num_threads,
-                        const std::shared_ptr<const Pipe>& p);
-                        
-void dispatch_RemoveDuplicates(BS::thread_pool& pool,
+                         const std::shared_ptr<Pipe>& p,
+                         MortonKernel kernel = MortonKernel::kAuto);
+template <typename Pool>
+void dispatch_MortonCode(Pool& pool,
+                         int num_threads,
+                         const std::shared_ptr<Pipe64>& p);
+
+// kBinning is the original mutex/condition-variable binning pass, kept around
+// for comparison. kParallelLSD is the lock-free, reentrant LSD sort, and
+// kParallelLSDWriteCombining the same sort with a write-combining scatter.
+enum class RadixSortVariant {
+  kBinning,
+  kParallelLSD,
+  kParallelLSDWriteCombining
+};
+
+template <typename Pool>
+void dispatch_RadixSort(
+    Pool& pool,
+    int num_threads,
+    const std::shared_ptr<const Pipe>& p,
+    RadixSortVariant variant = RadixSortVariant::kParallelLSD);
+template <typename Pool>
+void dispatch_RadixSort(
+    Pool& pool,
+    int num_threads,
+    const std::shared_ptr<const Pipe64>& p,
+    RadixSortVariant variant = RadixSortVariant::kParallelLSD);
+
+// Optional alternative to 'dispatch_RadixSort' that also records the input
+// position of every sorted code in 'p->u_point_index'. Requires
+// 'Pipe::allocate_point_order()'.
+template <typename Pool>
+void dispatch_RadixSortWithIndices(Pool& pool,
+                                   int num_threads,
+                                   const std::shared_ptr<const Pipe>& p);
+template <typename Pool>
+void dispatch_RadixSortWithIndices(Pool& pool,
+                                   int num_threads,
+                                   const std::shared_ptr<const Pipe64>& p);
+
+// Optional stage after 'dispatch_RadixSortWithIndices', gathers 'u_points'
+// into morton order in 'p->u_points_sorted'.
+template <typename Pool>
+void dispatch_GatherPoints(Pool& pool,
+                           int num_threads,
+                           const std::shared_ptr<const Pipe>& p);
+template <typename Pool>
+void dispatch_GatherPoints(Pool& pool,
+                           int num_threads,
+                           const std::shared_ptr<const Pipe64>& p);
+
+template <typename Pool>
+void dispatch_RemoveDuplicates(Pool& pool,
                                int num_threads,
                                const std::shared_ptr<Pipe>& p);
-
-void dispatch_BuildRadixTree(BS::thread_pool& pool,
+template <typename Pool>
+void dispatch_RemoveDuplicates(Pool& pool,
+                               int num_threads,
+                               const std::shared_ptr<Pipe64>& p);
+
+// Replaces 'dispatch_RadixSort' + 'dispatch_RemoveDuplicates', the run heads
+// are counted during the last scatter pass of the sort.
+template <typename Pool>
+void dispatch_RadixSortAndRemoveDuplicates(Pool& pool,
+                                           int num_threads,
+                                           const std::shared_ptr<Pipe>& p);
+template <typename Pool>
+void dispatch_RadixSortAndRemoveDuplicates(Pool& pool,
+                                           int num_threads,
+                                           const std::shared_ptr<Pipe64>& p);
+
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_BuildRadixTree(Pool& pool,
                              int num_threads,
                              const std::shared_ptr<const Pipe>& p);
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_BuildRadixTree(Pool& pool,
+                             int num_threads,
+                             const std::shared_ptr<const Pipe64>& p);
 
-void dispatch_EdgeCount(BS::thread_pool& pool,
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_EdgeCount(Pool& pool,
                         int num_threads,
                         const std::shared_ptr<const Pipe>& p);
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_EdgeCount(Pool& pool,
+                        int num_threads,
+                        const std::shared_ptr<const Pipe64>& p);
 
-void dispatch_EdgeOffset(BS::thread_pool& pool,
+template <typename Pool>
+void dispatch_EdgeOffset(Pool& pool,
                          int num_threads,
                          const std::shared_ptr<const Pipe>& p);
-
-void dispatch_BuildOctree(BS::thread_pool& pool,
+template <typename Pool>
+void dispatch_EdgeOffset(Pool& pool,
+                         int num_threads,
+                         const std::shared_ptr<const Pipe64>& p);
+
+// Replaces 'dispatch_EdgeCount' + 'dispatch_EdgeOffset', the block sums of
+// the scan are accumulated while the edge counts are written.
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_EdgeCountAndOffset(Pool& pool,
+                                 int num_threads,
+                                 const std::shared_ptr<const Pipe>& p);
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_EdgeCountAndOffset(Pool& pool,
+                                 int num_threads,
+                                 const std::shared_ptr<const Pipe64>& p);
+
+// Sizes 'p->oct' to the total of the edge offsets (growing it if needed),
+// then builds it.
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_BuildOctree(Pool& pool,
+                          int num_threads,
+                          const std::shared_ptr<Pipe>& p);
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA, typename Pool>
+void dispatch_BuildOctree(Pool& pool,
                           int num_threads,
-                          const std::shared_ptr<const Pipe>& p);
+                          const std::shared_ptr<Pipe64>& p);
 
 }  // namespace cpu
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+#include "defines.h"
+
+namespace shared {
+
+// How the binary radix tree nodes are stored.
+//   kSoA:    one array per field ('RadixTree::u_prefix_n', ...).
+//   kPacked: the fields a node visit needs in one 8-byte 'PackedBrtNode', so a
+//            walk up the tree touches one cache line per node instead of three
+//            to five. The parents stay a separate array in both layouts.
+//            Also what 'vk::Pipe' writes, as it needs no 8-bit storage.
+enum class BrtLayout { kSoA, kPacked };
+
+struct PackedBrtNode {
+  int left_child;
+  uint32_t meta;  // [7:0] prefix_n, [8] has_leaf_left, [9] has_leaf_right
+
+  static constexpr uint32_t kLeafLeft = 1u << 8;
+  static constexpr uint32_t kLeafRight = 1u << 9;
+};
+static_assert(sizeof(PackedBrtNode) == 8);
+
+// Uniform accessors over both layouts, so the builder and its consumers are
+// written once and take the layout as a template parameter. Views are cheap to
+// copy and do not own the arrays.
+template <BrtLayout Layout>
+struct BrtView;
+
+template <>
+struct BrtView<BrtLayout::kSoA> {
+  uint8_t* u_prefix_n;
+  bool* u_has_leaf_left;
+  bool* u_has_leaf_right;
+  int* u_left_child;
+  int* u_parents;
+
+  [[nodiscard]] H_D_I uint8_t prefix_n(const int i) const {
+    return u_prefix_n[i];
+  }
+  [[nodiscard]] H_D_I bool has_leaf_left(const int i) const {
+    return u_has_leaf_left[i];
+  }
+  [[nodiscard]] H_D_I bool has_leaf_right(const int i) const {
+    return u_has_leaf_right[i];
+  }
+  [[nodiscard]] H_D_I int left_child(const int i) const {
+    return u_left_child[i];
+  }
+  [[nodiscard]] H_D_I int parent(const int i) const { return u_parents[i]; }
+
+  H_D_I void set_node(const int i,
+                      const uint8_t prefix_n,
+                      const int left_child,
+                      const bool has_leaf_left,
+                      const bool has_leaf_right) const {
+    u_prefix_n[i] = prefix_n;
+    u_left_child[i] = left_child;
+    u_has_leaf_left[i] = has_leaf_left;
+    u_has_leaf_right[i] = has_leaf_right;
+  }
+  H_D_I void set_parent(const int i, const int parent) const {
+    u_parents[i] = parent;
+  }
+};
+
+template <>
+struct BrtView<BrtLayout::kPacked> {
+  PackedBrtNode* u_nodes;
+  int* u_parents;
+
+  [[nodiscard]] H_D_I uint8_t prefix_n(const int i) const {
+    return static_cast<uint8_t>(u_nodes[i].meta);
+  }
+  [[nodiscard]] H_D_I bool has_leaf_left(const int i) const {
+    return u_nodes[i].meta & PackedBrtNode::kLeafLeft;
+  }
+  [[nodiscard]] H_D_I bool has_leaf_right(const int i) const {
+    return u_nodes[i].meta & PackedBrtNode::kLeafRight;
+  }
+  [[nodiscard]] H_D_I int left_child(const int i) const {
+    return u_nodes[i].left_child;
+  }
+  [[nodiscard]] H_D_I int parent(const int i) const { return u_parents[i]; }
+
+  H_D_I void set_node(const int i,
+                      const uint8_t prefix_n,
+                      const int left_child,
+                      const bool has_leaf_left,
+                      const bool has_leaf_right) const {
+    u_nodes[i] = {left_child,
+                  prefix_n | (has_leaf_left ? PackedBrtNode::kLeafLeft : 0u) |
+                      (has_leaf_right ? PackedBrtNode::kLeafRight : 0u)};
+  }
+  H_D_I void set_parent(const int i, const int parent) const {
+    u_parents[i] = parent;
+  }
+};
+
+}  // namespace shared
@@ -2,16 +2,17 @@
 
 #include <cstdint>
 
+#include "brt_layout.h"
 #include "defines.h"
 
 namespace shared {
 
+template <BrtLayout Layout>
 H_D_I void process_edge_count_i(const int i,
-                                const uint8_t *prefix_n,
-                                const int *parents,
+                                const BrtView<Layout> brt,
                                 int *edge_count) {
-  const auto my_depth = prefix_n[i] / 3;
-  const auto parent_depth = prefix_n[parents[i]] / 3;
+  const auto my_depth = brt.prefix_n(i) / 3;
+  const auto parent_depth = brt.prefix_n(brt.parent(i)) / 3;
   edge_count[i] = my_depth - parent_depth;
 }
 
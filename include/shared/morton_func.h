@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #include "defines.h"
@@ -7,6 +8,10 @@
 using morton_t = unsigned int;
 constexpr auto morton_bits = 30;
 
+// 63-bit keys, 21 bits (2^21 cells) per axis. Opt-in through 'Pipe64'.
+using morton64_t = uint64_t;
+constexpr auto morton64_bits = 63;
+
 namespace shared {
 
 // ---------------------------------------------------------------------
@@ -29,16 +34,61 @@ H_D_I unsigned int m3D_e_magicbits(const unsigned int x,
          (morton3D_SplitBy3bits(z) << 2);
 }
 
+// The overloads taking 'glm::vec3' quantize every axis with its own box
+// (see 'shared::BoundsMode'), the scalar ones map the cube
+// [min_coord, min_coord + range]^3. Both compute the same per axis.
 [[nodiscard]] H_D_I unsigned int xyz_to_morton32(const glm::vec4 &xyz,
-                                                 const float min_coord,
-                                                 const float range) {
+                                                 const glm::vec3 &min_xyz,
+                                                 const glm::vec3 &range_xyz) {
   constexpr auto bit_scale = 1024;
-  const auto i = static_cast<uint32_t>((xyz.x - min_coord) / range * bit_scale);
-  const auto j = static_cast<uint32_t>((xyz.y - min_coord) / range * bit_scale);
-  const auto k = static_cast<uint32_t>((xyz.z - min_coord) / range * bit_scale);
+  const auto i =
+      static_cast<uint32_t>((xyz.x - min_xyz.x) / range_xyz.x * bit_scale);
+  const auto j =
+      static_cast<uint32_t>((xyz.y - min_xyz.y) / range_xyz.y * bit_scale);
+  const auto k =
+      static_cast<uint32_t>((xyz.z - min_xyz.z) / range_xyz.z * bit_scale);
   return m3D_e_magicbits(i, j, k);
 }
 
+[[nodiscard]] H_D_I unsigned int xyz_to_morton32(const glm::vec4 &xyz,
+                                                 const float min_coord,
+                                                 const float range) {
+  return xyz_to_morton32(xyz, glm::vec3(min_coord), glm::vec3(range));
+}
+
+H_D_I uint64_t morton3D_SplitBy3bits64(const uint32_t a) {
+  auto x = static_cast<uint64_t>(a) & 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+[[nodiscard]] H_D_I uint64_t xyz_to_morton64(const glm::vec4 &xyz,
+                                             const glm::vec3 &min_xyz,
+                                             const glm::vec3 &range_xyz) {
+  constexpr auto bit_scale = 1u << 21;
+  // clamp, the float product of the largest coordinate can round up to 2^21
+  constexpr auto max_cell = bit_scale - 1;
+  const auto quantize = [&](const float v, const float lo, const float range) {
+    const auto cell = static_cast<uint32_t>((v - lo) / range * bit_scale);
+    return cell < max_cell ? cell : max_cell;
+  };
+  return morton3D_SplitBy3bits64(quantize(xyz.x, min_xyz.x, range_xyz.x)) |
+         (morton3D_SplitBy3bits64(quantize(xyz.y, min_xyz.y, range_xyz.y))
+          << 1) |
+         (morton3D_SplitBy3bits64(quantize(xyz.z, min_xyz.z, range_xyz.z))
+          << 2);
+}
+
+[[nodiscard]] H_D_I uint64_t xyz_to_morton64(const glm::vec4 &xyz,
+                                             const float min_coord,
+                                             const float range) {
+  return xyz_to_morton64(xyz, glm::vec3(min_coord), glm::vec3(range));
+}
+
 // ---------------------------------------------------------------------
 // Decode
 // ---------------------------------------------------------------------
@@ -60,19 +110,19 @@ H_D_I void m3D_d_magicbits(const unsigned int m, unsigned int *xyz) {
 
 H_D_I void morton32_to_xyz(glm::vec4 *ret,
                            const unsigned int code,
-                           const float min_coord,
-                           const float range) {
+                           const glm::vec3 &min_xyz,
+                           const glm::vec3 &range_xyz) {
   constexpr auto bit_scale = 1024.0f;
 
   unsigned int dec_raw_x[3];
   m3D_d_magicbits(code, dec_raw_x);
 
   const auto dec_x =
-      (static_cast<float>(dec_raw_x[0]) / bit_scale) * range + min_coord;
+      (static_cast<float>(dec_raw_x[0]) / bit_scale) * range_xyz.x + min_xyz.x;
   const auto dec_y =
-      (static_cast<float>(dec_raw_x[1]) / bit_scale) * range + min_coord;
+      (static_cast<float>(dec_raw_x[1]) / bit_scale) * range_xyz.y + min_xyz.y;
   const auto dec_z =
-      (static_cast<float>(dec_raw_x[2]) / bit_scale) * range + min_coord;
+      (static_cast<float>(dec_raw_x[2]) / bit_scale) * range_xyz.z + min_xyz.z;
 
   (*ret)[0] = dec_x;
   (*ret)[1] = dec_y;
@@ -80,4 +130,94 @@ H_D_I void morton32_to_xyz(glm::vec4 *ret,
   (*ret)[3] = 1.0f;
 }
 
+H_D_I void morton32_to_xyz(glm::vec4 *ret,
+                           const unsigned int code,
+                           const float min_coord,
+                           const float range) {
+  morton32_to_xyz(ret, code, glm::vec3(min_coord), glm::vec3(range));
+}
+
+H_D_I uint32_t morton3D_GetThirdBits64(const uint64_t m) {
+  auto x = m & 0x1249249249249249;
+  x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3;
+  x = (x ^ (x >> 4)) & 0x100f00f00f00f00f;
+  x = (x ^ (x >> 8)) & 0x1f0000ff0000ff;
+  x = (x ^ (x >> 16)) & 0x1f00000000ffff;
+  x = (x ^ (x >> 32)) & 0x1fffff;
+  return static_cast<uint32_t>(x);
+}
+
+H_D_I void morton64_to_xyz(glm::vec4 *ret,
+                           const uint64_t code,
+                           const glm::vec3 &min_xyz,
+                           const glm::vec3 &range_xyz) {
+  constexpr auto bit_scale = static_cast<float>(1u << 21);
+
+  (*ret)[0] = (static_cast<float>(morton3D_GetThirdBits64(code)) / bit_scale) *
+                  range_xyz.x +
+              min_xyz.x;
+  (*ret)[1] =
+      (static_cast<float>(morton3D_GetThirdBits64(code >> 1)) / bit_scale) *
+          range_xyz.y +
+      min_xyz.y;
+  (*ret)[2] =
+      (static_cast<float>(morton3D_GetThirdBits64(code >> 2)) / bit_scale) *
+          range_xyz.z +
+      min_xyz.z;
+  (*ret)[3] = 1.0f;
+}
+
+H_D_I void morton64_to_xyz(glm::vec4 *ret,
+                           const uint64_t code,
+                           const float min_coord,
+                           const float range) {
+  morton64_to_xyz(ret, code, glm::vec3(min_coord), glm::vec3(range));
+}
+
+// ---------------------------------------------------------------------
+// Key type selection
+// ---------------------------------------------------------------------
+
+// What the stages need to know about a key type, so they can be written once
+// for 'morton_t' and 'morton64_t'. 'bits' is the number of used bits (3 per
+// octree level).
+template <typename Key>
+struct morton_traits;
+
+template <>
+struct morton_traits<morton_t> {
+  static constexpr int bits = morton_bits;
+  static constexpr int levels = morton_bits / 3;
+
+  [[nodiscard]] static H_D_I morton_t encode(const glm::vec4 &xyz,
+                                             const glm::vec3 &min_xyz,
+                                             const glm::vec3 &range_xyz) {
+    return xyz_to_morton32(xyz, min_xyz, range_xyz);
+  }
+  static H_D_I void decode(glm::vec4 *ret,
+                           const morton_t code,
+                           const glm::vec3 &min_xyz,
+                           const glm::vec3 &range_xyz) {
+    morton32_to_xyz(ret, code, min_xyz, range_xyz);
+  }
+};
+
+template <>
+struct morton_traits<morton64_t> {
+  static constexpr int bits = morton64_bits;
+  static constexpr int levels = morton64_bits / 3;
+
+  [[nodiscard]] static H_D_I morton64_t encode(const glm::vec4 &xyz,
+                                               const glm::vec3 &min_xyz,
+                                               const glm::vec3 &range_xyz) {
+    return xyz_to_morton64(xyz, min_xyz, range_xyz);
+  }
+  static H_D_I void decode(glm::vec4 *ret,
+                           const morton64_t code,
+                           const glm::vec3 &min_xyz,
+                           const glm::vec3 &range_xyz) {
+    morton64_to_xyz(ret, code, min_xyz, range_xyz);
+  }
+};
+
 }  // namespace shared
@@ -1,15 +1,27 @@
 #pragma once
 
-#include "morton_func.h"  // for 'morton_bits' and 'morton32_to_xyz'
+#if !defined(__CUDA_ARCH__)
+#include <atomic>
+#endif
+
+#include "brt_layout.h"
+#include "morton_func.h"  // for 'morton_traits'
 
 namespace shared {
+// Several brt nodes can add children to the same oct node, so the masks are
+// updated atomically, as with 'atomicOr'/'atomicAnd' in the shaders
 H_D_I void set_child(const int node_idx,
                      int (*u_children)[8],
                      int* u_child_node_mask,
                      const unsigned int which_child,
                      const int oct_idx) {
   u_children[node_idx][which_child] = oct_idx;
-  u_child_node_mask[node_idx] |= 1 << which_child;
+#if defined(__CUDA_ARCH__)
+  atomicOr(&u_child_node_mask[node_idx], 1 << which_child);
+#else
+  std::atomic_ref<int>(u_child_node_mask[node_idx])
+      .fetch_or(1 << which_child, std::memory_order_relaxed);
+#endif
 }
 
 H_D_I void set_leaf(const int node_idx,
@@ -18,10 +30,35 @@ H_D_I void set_leaf(const int node_idx,
                     const unsigned int which_child,
                     const int leaf_idx) {
   u_children[node_idx][which_child] = leaf_idx;
-  u_child_leaf_mask[node_idx] &= ~(1 << which_child);
+#if defined(__CUDA_ARCH__)
+  atomicAnd(&u_child_leaf_mask[node_idx], ~(1 << which_child));
+#else
+  std::atomic_ref<int>(u_child_leaf_mask[node_idx])
+      .fetch_and(~(1 << which_child), std::memory_order_relaxed);
+#endif
+}
+
+// The octnodes brt node 'i' adds sit bottom first from this index on.
+// 'edge_offsets' is the inclusive scan of 'edge_counts', so node i's string
+// ends at 'edge_offsets[i]', one past where the strings before it end. The
+// root adds no nodes and owns octnode 0.
+H_D_I int first_oct_node(const int i,
+                         const int* edge_offsets,
+                         const int* edge_counts) {
+  return i == 0 ? 0 : edge_offsets[i] - edge_counts[i] + 1;
 }
 
-// processing for index 'i'
+// the largest of the three per-axis ranges, the edge of the root cell
+H_D_I float max_range(const glm::vec3& range_xyz) {
+  const auto xy = range_xyz.x > range_xyz.y ? range_xyz.x : range_xyz.y;
+  return xy > range_xyz.z ? xy : range_xyz.z;
+}
+
+// processing for index 'i'. 'Key' is 'morton_t' or 'morton64_t', the latter
+// gives up to 21 levels instead of 10. 'min_xyz' and 'range_xyz' are the
+// pipe's quantization box. With 'BoundsMode::kPerAxis' the cells are boxes and
+// 'oct_cell_size' is their edge along the longest axis.
+template <BrtLayout Layout, typename Key>
 H_D_I void process_oct_node(const int i /*brt node index*/,
                             // --------------------------
                             int (*oct_children)[8],
@@ -31,29 +68,32 @@ H_D_I void process_oct_node(const int i /*brt node index*/,
                             // --------------------------
                             const int* edge_offsets,
                             const int* edge_counts,
-                            const morton_t* morton_codes,
-                            const uint8_t* rt_prefix_n,
-                            const int* rt_parents,
-                            const float min_coord,
-                            const float range) {
-  // For octrees, it starts at 'offset[x]', and the numbers is decided by the
-  // 'count[i]'. You can imagine something like:
-  // brt[0] contains oct nodes [0, 3] (4 total)
-  // brt[1] contains oct nodes [4, 4] (1 total)
-  // brt[2] contains oct nodes [5, 6] (2 total) ...
-  auto oct_idx = edge_offsets[i];
+                            const Key* morton_codes,
+                            const BrtView<Layout> brt,
+                            const glm::vec3 min_xyz,
+                            const glm::vec3 range_xyz) {
+  // For octrees, it starts at 'first_oct_node(i)', and the numbers is decided
+  // by the 'count[i]'. You can imagine something like:
+  // brt[0] contains oct node  [0, 0] (the root)
+  // brt[1] contains oct nodes [1, 4] (4 total)
+  // brt[2] contains oct nodes [5, 5] (1 total)
+  // brt[3] contains oct nodes [6, 7] (2 total) ...
+  constexpr auto key_bits = morton_traits<Key>::bits;
+
+  auto oct_idx = first_oct_node(i, edge_offsets, edge_counts);
   const auto n_new_nodes = edge_counts[i];
 
-  // just a constant
-  const auto root_level = rt_prefix_n[0] / 3;
+  // just constants
+  const auto root_level = brt.prefix_n(0) / 3;
+  const auto range = max_range(range_xyz);
 
   // for each new node,
   // (1) create their cornor/cell size
   // (2) attach them to their parent
   for (auto j = 0; j < n_new_nodes - 1; ++j) {
-    const auto level = rt_prefix_n[i] / 3 - j;  // every new node has a level
+    const auto level = brt.prefix_n(i) / 3 - j;  // every new node has a level
 
-    const auto node_prefix = morton_codes[i] >> (morton_bits - (3 * level));
+    const auto node_prefix = morton_codes[i] >> (key_bits - (3 * level));
     const auto which_child = node_prefix & 0b111;
     const auto parent = oct_idx + 1;
 
@@ -61,10 +101,10 @@ H_D_I void process_oct_node(const int i /*brt node index*/,
     set_child(parent, oct_children, oct_child_node_mask, which_child, oct_idx);
 
     // compute the corner of the current octnode
-    morton32_to_xyz(&oct_corner[oct_idx],
-                    node_prefix << (morton_bits - (3 * level)),
-                    min_coord,
-                    range);
+    morton_traits<Key>::decode(&oct_corner[oct_idx],
+                               node_prefix << (key_bits - (3 * level)),
+                               min_xyz,
+                               range_xyz);
 
     // each cell is half the size of the level above it
     oct_cell_size[oct_idx] =
@@ -75,11 +115,11 @@ H_D_I void process_oct_node(const int i /*brt node index*/,
   }
 
   if (n_new_nodes > 0) {
-    auto rt_parent = rt_parents[i];
+    auto rt_parent = brt.parent(i);
 
     auto counter = 0;
     while (edge_counts[rt_parent] == 0) {
-      rt_parent = rt_parents[rt_parent];
+      rt_parent = brt.parent(rt_parent);
 
       ++counter;
       if (counter > 30) {
@@ -88,26 +128,28 @@ H_D_I void process_oct_node(const int i /*brt node index*/,
       }
     }
 
-    const auto oct_parent = edge_offsets[rt_parent];
-    const auto top_level = rt_prefix_n[i] / 3 - n_new_nodes + 1;
+    const auto oct_parent =
+        first_oct_node(rt_parent, edge_offsets, edge_counts);
+    const auto top_level = brt.prefix_n(i) / 3 - n_new_nodes + 1;
     const auto top_node_prefix =
-        morton_codes[i] >> (morton_bits - (3 * top_level));
+        morton_codes[i] >> (key_bits - (3 * top_level));
 
     const auto which_child = top_node_prefix & 0b111;
 
     set_child(
         oct_parent, oct_children, oct_child_node_mask, which_child, oct_idx);
 
-    morton32_to_xyz(&oct_corner[oct_idx],
-                    top_node_prefix << (morton_bits - (3 * top_level)),
-                    min_coord,
-                    range);
+    morton_traits<Key>::decode(&oct_corner[oct_idx],
+                               top_node_prefix << (key_bits - (3 * top_level)),
+                               min_xyz,
+                               range_xyz);
 
     oct_cell_size[oct_idx] =
         range / static_cast<float>(1 << (top_level - root_level));
   }
 }
 
+template <BrtLayout Layout, typename Key>
 H_D_I void process_link_leaf(const int i /*brt node index*/,
                              // --------------------------
                              int (*oct_children)[8],
@@ -115,45 +157,46 @@ H_D_I void process_link_leaf(const int i /*brt node index*/,
                              // --------------------------
                              const int* edge_offsets,
                              const int* edge_counts,
-                             const morton_t* morton_codes,
-                             const bool* rt_has_leaf_left,
-                             const bool* rt_has_leaf_right,
-                             const uint8_t* rt_prefix_n,
-                             const int* rt_parents,
-                             const int* rt_left_child) {
-  if (rt_has_leaf_left[i]) {
-    const auto leaf_idx = rt_left_child[i];
-    const auto leaf_level = rt_prefix_n[i] / 3 + 1;
+                             const Key* morton_codes,
+                             const BrtView<Layout> brt) {
+  constexpr auto key_bits = morton_traits<Key>::bits;
+
+  if (brt.has_leaf_left(i)) {
+    const auto leaf_idx = brt.left_child(i);
+    const auto leaf_level = brt.prefix_n(i) / 3 + 1;
     const auto leaf_prefix =
-        morton_codes[leaf_idx] >> (morton_bits - (3 * leaf_level));
+        morton_codes[leaf_idx] >> (key_bits - (3 * leaf_level));
     const auto child_idx = leaf_prefix & 0b111;
 
-    // walk up the radix tree until finding a node which contributes an octnode
+    // walk up the radix tree until finding a node which contributes an octnode,
+    // or the root, which owns octnode 0 (and is its own parent)
     auto rt_node = i;
-    while (edge_counts[rt_node] == 0) {
-      rt_node = rt_parents[rt_node];
+    while (rt_node != 0 && edge_counts[rt_node] == 0) {
+      rt_node = brt.parent(rt_node);
     }
 
     // the lowest octnode in the string contributed by rt_node will be the
     // lowest index
-    const auto bottom_oct_idx = edge_offsets[rt_node];
+    const auto bottom_oct_idx =
+        first_oct_node(rt_node, edge_offsets, edge_counts);
     set_leaf(
         bottom_oct_idx, oct_children, oct_child_leaf_mask, child_idx, leaf_idx);
   }
-  if (rt_has_leaf_right[i]) {
-    const auto leaf_idx = rt_left_child[i] + 1;
-    const auto leaf_level = rt_prefix_n[i] / 3 + 1;
+  if (brt.has_leaf_right(i)) {
+    const auto leaf_idx = brt.left_child(i) + 1;
+    const auto leaf_level = brt.prefix_n(i) / 3 + 1;
     const auto leaf_prefix =
-        morton_codes[leaf_idx] >> (morton_bits - (3 * leaf_level));
+        morton_codes[leaf_idx] >> (key_bits - (3 * leaf_level));
     const auto child_idx = leaf_prefix & 0b111;
     auto rt_node = i;
-    while (edge_counts[rt_node] == 0) {
-      rt_node = rt_parents[rt_node];
+    while (rt_node != 0 && edge_counts[rt_node] == 0) {
+      rt_node = brt.parent(rt_node);
     }
 
     // the lowest octnode in the string contributed by rt_node will be the
     // lowest index
-    const auto bottom_oct_idx = edge_offsets[rt_node];
+    const auto bottom_oct_idx =
+        first_oct_node(rt_node, edge_offsets, edge_counts);
     set_leaf(
         bottom_oct_idx, oct_children, oct_child_leaf_mask, child_idx, leaf_idx);
   }
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "defines.h"
+#include "morton_func.h"
+
+namespace shared {
+
+// Widest digit a radix pass may use. 2^11 counters per thread still fit in the
+// L1 of the little cores.
+constexpr int kMaxRadixBits = 11;
+// Narrowest digit width a caller may cap a plan to, see 'make_radix_plan'
+constexpr int kMinRadixBits = 8;
+constexpr int kMaxKeyBits = sizeof(morton64_t) * 8;
+constexpr int kMaxRadixPasses =
+    (kMaxKeyBits + kMinRadixBits - 1) / kMinRadixBits;  // 8, 4 for 'morton_t'
+
+struct RadixPass {
+  int shift;
+  int bits;
+};
+
+// Which digits an LSD radix sort has to visit, lowest first. Digits in which
+// every key has the same value are left out, sorting by them is a no-op.
+struct RadixPlan {
+  int n_passes = 0;
+  RadixPass passes[kMaxRadixPasses] = {};
+
+  [[nodiscard]] H_D_I int max_bits() const {
+    int bits = 0;
+    for (int i = 0; i < n_passes; ++i) {
+      bits = passes[i].bits > bits ? passes[i].bits : bits;
+    }
+    return bits;
+  }
+};
+
+// Build a plan from the bitwise AND and OR over all keys. A bit that is equal
+// in both is constant across the input and needs no sorting. The span between
+// the lowest and highest varying bit is split into as few, equally wide digits
+// as 'max_bits' allows (30 bits -> 10/10/10), and every digit starts at the
+// next varying bit, so runs of constant bits are skipped entirely. Callers
+// whose per-digit state must stay small (e.g. a fixed GPU histogram) pass a
+// narrower 'max_bits', within [kMinRadixBits, kMaxRadixBits].
+template <typename Key>
+[[nodiscard]] H_D_I RadixPlan make_radix_plan(
+    const Key and_bits, const Key or_bits, const int max_bits = kMaxRadixBits) {
+  constexpr int kKeyBits = sizeof(Key) * 8;
+  RadixPlan plan;
+
+  const Key varying = and_bits ^ or_bits;
+  if (varying == 0) {
+    return plan;
+  }
+
+  int lo = 0;
+  while (!((varying >> lo) & 1u)) ++lo;
+  int hi = kKeyBits - 1;
+  while (!((varying >> hi) & 1u)) --hi;
+
+  const int span = hi - lo + 1;
+  const int n_digits = (span + max_bits - 1) / max_bits;
+  const int width = (span + n_digits - 1) / n_digits;
+
+  int cursor = lo;
+  while (cursor <= hi) {
+    const int bits = (cursor + width > kKeyBits) ? kKeyBits - cursor : width;
+    plan.passes[plan.n_passes++] = {cursor, bits};
+
+    cursor += bits;
+    while (cursor <= hi && !((varying >> cursor) & 1u)) ++cursor;
+  }
+
+  return plan;
+}
+
+}  // namespace shared
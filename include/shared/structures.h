@@ -1,27 +1,42 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 
+#include "brt_layout.h"
+#include "core/arena.hpp"
 #include "defines.h"
 #include "morton_func.h"
 
 // I am using only pointers because this gives me a unified front end for both
 // CPU/and GPU
 struct RadixTree {
-  const size_t capacity;
+  size_t capacity;
+  core::arena* arena;  // where the arrays live, 'new[]' if null
 
   // ------------------------
   // Essential Data
   // ------------------------
   int n_brt_nodes = UNINITIALIZED;
 
-  uint8_t* u_prefix_n;
-  bool* u_has_leaf_left;
-  bool* u_has_leaf_right;
-  int* u_left_child;
-  int* u_parents;
+  // Only the arrays of 'layout' are allocated, the others stay null. The
+  // parents are allocated in both.
+  shared::BrtLayout layout;
+
+  // kSoA
+  uint8_t* u_prefix_n = nullptr;
+  bool* u_has_leaf_left = nullptr;
+  bool* u_has_leaf_right = nullptr;
+  int* u_left_child = nullptr;
+
+  // kPacked
+  shared::PackedBrtNode* u_nodes = nullptr;
+
+  int* u_parents = nullptr;
 
   // ------------------------
   // Constructors
@@ -29,7 +44,9 @@ struct RadixTree {
 
   RadixTree() = delete;
 
-  explicit RadixTree(size_t n_to_allocate);
+  explicit RadixTree(size_t n_to_allocate,
+                     core::arena* arena = nullptr,
+                     shared::BrtLayout layout = shared::BrtLayout::kSoA);
 
   RadixTree(const RadixTree&) = delete;
   RadixTree& operator=(const RadixTree&) = delete;
@@ -38,12 +55,25 @@ struct RadixTree {
 
   ~RadixTree();
 
+  // Grows the arrays to hold at least 'n' nodes, geometrically. The contents
+  // are not kept, so only call it before a stage writes the nodes.
+  void reserve(size_t n);
+
+  // Switches to 'layout', allocating its arrays and releasing the others
+  // (on an arena they are only given back by the next 'clear()'). The nodes
+  // are not kept.
+  void use_layout(shared::BrtLayout layout);
+
+  // the size of all arrays of one node in 'layout'
+  [[nodiscard]] static size_t bytes_per_node(shared::BrtLayout layout);
+
   // ------------------------
   // Getter/Setters
   // ------------------------
 
+  // Falls back to 'reserve()' if the nodes do not fit
   void set_n_nodes(const size_t n_nodes) {
-    assert(n_nodes < capacity);
+    reserve(n_nodes);
     n_brt_nodes = static_cast<int>(n_nodes);
   }
 
@@ -52,10 +82,30 @@ struct RadixTree {
       throw std::runtime_error("BRT nodes unset!!!");
     return n_brt_nodes;
   }
+
+  // The nodes in 'Layout', which must be the allocated one
+  template <shared::BrtLayout Layout>
+  [[nodiscard]] shared::BrtView<Layout> view() const {
+    assert(Layout == layout);
+    if constexpr (Layout == shared::BrtLayout::kSoA) {
+      return {u_prefix_n,
+              u_has_leaf_left,
+              u_has_leaf_right,
+              u_left_child,
+              u_parents};
+    } else {
+      return {u_nodes, u_parents};
+    }
+  }
+
+ private:
+  void allocate_nodes();
+  void release_nodes();
 };
 
 struct Octree {
-  const size_t capacity;
+  size_t capacity;
+  core::arena* arena;  // where the arrays live, 'new[]' if null
 
   // ------------------------
   // Essential Data
@@ -76,7 +126,7 @@ struct Octree {
 
   Octree() = delete;
 
-  explicit Octree(size_t capacity);
+  explicit Octree(size_t capacity, core::arena* arena = nullptr);
 
   Octree(const Octree&) = delete;
   Octree& operator=(const Octree&) = delete;
@@ -85,11 +135,24 @@ struct Octree {
 
   ~Octree();
 
+  // Grows the arrays to hold at least 'n' nodes, geometrically. The contents
+  // are not kept, so only call it before a stage writes the nodes.
+  void reserve(size_t n);
+
+  // the size of all arrays of one node
+  [[nodiscard]] static size_t bytes_per_node();
+
+  // Arena bytes of the arrays 'reserve()' replaced. The arena cannot free
+  // them, the pipe's next 'reset()' carves all arrays again to drop them.
+  size_t abandoned_bytes = 0;
+
   // ------------------------
   // Getter/Setters
   // ------------------------
+
+  // Falls back to 'reserve()' if the nodes do not fit
   void set_n_nodes(const size_t n_nodes) {
-    assert(n_nodes < capacity);
+    reserve(n_nodes);
     n_oct_nodes = static_cast<int>(n_nodes);
   }
 
@@ -100,7 +163,59 @@ struct Octree {
   }
 };
 
-struct Pipe {
+namespace shared {
+
+// How 'BasicPipe' holds the input points for the morton stage.
+//   kVec4:    'u_points', 16 bytes per point, the 'w' is never read
+//   kSoA:     'u_xs', 'u_ys', 'u_zs', one array per axis, so the SIMD encoders
+//             load each axis with a plain vector load
+//   kPacked3: 'u_points3', 12 bytes per point, a quarter less memory traffic
+// 'u_points' stays allocated in every layout, the point order/gather stages
+// read it.
+enum class PointLayout { kVec4, kSoA, kPacked3 };
+
+// Which box the morton codes quantize.
+//   kFixed:   the cube [min_coord, min_coord + range]^3 given to the
+//             constructor. Points outside of it wrap around.
+//   kAabb:    the points' bounding box, measured every frame by the morton
+//             stage, grown to a cube along its longest axis. The default.
+//   kPerAxis: the bounding box itself, every axis scaled on its own, so each
+//             one gets all of its bits. The octree cells become boxes.
+enum class BoundsMode { kFixed, kAabb, kPerAxis };
+
+struct Aabb {
+  glm::vec3 lower;
+  glm::vec3 upper;
+};
+
+// The box the morton codes quantize, every axis maps [min, min + range].
+struct QuantizationBox {
+  glm::vec3 min;
+  glm::vec3 range;
+};
+
+// The quantization box of 'mode' for points with the bounding box 'bounds',
+// the cube [min_coord, min_coord + range]^3 for kFixed and empty boxes. The
+// box is padded a little, so the largest coordinate still maps to the last
+// cell. 'vk::Pipe' computes the same box on the GPU (bounds_box.comp).
+[[nodiscard]] QuantizationBox make_quantization_box(BoundsMode mode,
+                                                    const Aabb& bounds,
+                                                    float min_coord,
+                                                    float range);
+
+}  // namespace shared
+
+// 'Key' is the morton code type, 'morton_t' (10 levels) or 'morton64_t' (21
+// levels, for inputs whose points are too dense for 1024 cells per axis). Use
+// the 'Pipe' and 'Pipe64' aliases below.
+template <typename Key>
+struct BasicPipe {
+  using key_type = Key;
+
+  // backs every array below when the pipe was constructed with
+  // 'core::arena_options', null for one 'new[]' per array
+  std::unique_ptr<core::arena> arena;
+
   // ------------------------
   // Essential Data (CPU/GPU shared)
   // ------------------------
@@ -109,22 +224,47 @@ struct Pipe {
   int n_unique = UNINITIALIZED;
 
   glm::vec4* u_points;
-  morton_t* u_morton;
-  morton_t* u_morton_alt;  // also used as the unique morton
+  Key* u_morton;
+  Key* u_morton_alt;  // also used as the unique morton
   RadixTree brt;
   int* u_edge_counts;
   int* u_edge_offsets;
   Octree oct;
 
-  // read-only
+  // optional, see 'allocate_point_order()'. 'u_point_index[i]' is the input
+  // position of the i-th sorted morton code, 'u_points_sorted' the points
+  // gathered into morton order.
+  uint32_t* u_point_index = nullptr;
+  uint32_t* u_point_index_alt = nullptr;
+  glm::vec4* u_points_sorted = nullptr;
+
+  // optional, see 'use_point_layout()'. Only the arrays of the active layout
+  // are allocated.
+  shared::PointLayout point_layout = shared::PointLayout::kVec4;
+  float* u_xs = nullptr;
+  float* u_ys = nullptr;
+  float* u_zs = nullptr;
+  glm::vec3* u_points3 = nullptr;
+
+  // the quantization box of the morton codes, see 'set_bounds()'
+  shared::BoundsMode bounds_mode = shared::BoundsMode::kAabb;
+  glm::vec3 box_min;
+  glm::vec3 box_range;
+
+  // the points of the current frame, see 'reset()'. All per-point arrays
+  // hold 'capacity' elements.
   int n_points;
-  float min_coord;
+  size_t capacity;
+
+  // read-only
+  float min_coord;  // the kFixed cube
   float range;
   int seed;
 
   // ------------------------
   // Temporary Storage (for GPU only)
-  // only allocated when GPU is used
+  // only allocated when GPU is used, except 'u_flag_heads' which the CPU
+  // duplicate removal uses as well
   // ------------------------
 
   static constexpr auto RADIX = 256;
@@ -149,19 +289,24 @@ struct Pipe {
   // Constructors
   // ------------------------
 
-  Pipe() = delete;
+  BasicPipe() = delete;
 
-  explicit Pipe(int n_points,
-                float min_coord = 0.0f,
-                float range = 1024.0f,
-                int seed = 114514);
+  // 'memory' puts all arrays in one 'core::arena': 64-byte aligned, on huge
+  // pages and/or bound to a NUMA node. Fault its pages in from the workers
+  // with 'cpu::dispatch_FirstTouch' before filling the points.
+  explicit BasicPipe(
+      int n_points,
+      float min_coord = 0.0f,
+      float range = 1024.0f,
+      int seed = 114514,
+      const std::optional<core::arena_options>& memory = std::nullopt);
 
-  Pipe(const Pipe&) = delete;
-  Pipe& operator=(const Pipe&) = delete;
-  Pipe(Pipe&&) = delete;
-  Pipe& operator=(Pipe&&) = delete;
+  BasicPipe(const BasicPipe&) = delete;
+  BasicPipe& operator=(const BasicPipe&) = delete;
+  BasicPipe(BasicPipe&&) = delete;
+  BasicPipe& operator=(BasicPipe&&) = delete;
 
-  ~Pipe();
+  ~BasicPipe();
 
   // ------------------------
   // Accessors (preffered over direct access)
@@ -177,15 +322,77 @@ struct Pipe {
 
   [[nodiscard]] int n_oct_nodes() const { return oct.n_nodes(); }
 
+  [[nodiscard]] bool has_point_order() const {
+    return u_point_index != nullptr;
+  }
+
+  // The i-th input point from the active layout, 'w' is 1 unless kVec4.
+  [[nodiscard]] glm::vec4 point(const int i) const {
+    switch (point_layout) {
+      case shared::PointLayout::kSoA:
+        return {u_xs[i], u_ys[i], u_zs[i], 1.0f};
+      case shared::PointLayout::kPacked3:
+        return {u_points3[i], 1.0f};
+      default:
+        return u_points[i];
+    }
+  }
+
+  // Sets 'box_min'/'box_range' from the points' bounding box according to
+  // 'bounds_mode', see 'shared::make_quantization_box'.
+  void set_bounds(const shared::Aabb& bounds);
+
+  // Starts a new frame of 'n' points, reusing the arrays while 'n' fits the
+  // capacity and growing them geometrically otherwise. The node counts are
+  // cleared, the points are not kept when the arrays grow: fill them after
+  // the reset. On an arena, an octree that outgrew its arrays in the last
+  // frame also has everything carved again, with the octree at its new size.
+  void reset(int n);
+
+  // Allocate the index/gather buffers used by 'dispatch_RadixSortWithIndices'
+  // and 'dispatch_GatherPoints'. Not needed for the plain octree build.
+  void allocate_point_order();
+
+  // Switch the input of the morton stage to 'layout', allocating its arrays
+  // on first use. The caller fills them, 'u_points' is not converted.
+  void use_point_layout(shared::PointLayout layout);
+
+  // Switch the radix tree to 'layout', see 'RadixTree::use_layout()'. The
+  // stages from the radix tree on must then be dispatched with it.
+  void use_brt_layout(shared::BrtLayout layout) { brt.use_layout(layout); }
+
+  // the size of all per-point arrays (and radix tree nodes) of one point
+  [[nodiscard]] size_t bytes_per_point() const;
+
   void set_n_unique(const size_t n_unique) {
     assert(n_unique <= n_points);
     this->n_unique = static_cast<int>(n_unique);
   }
 
   // alias to make the code more understand able
-  [[nodiscard]] const morton_t* getSortedKeys() const { return u_morton; }
-  [[nodiscard]] morton_t* getUniqueKeys() { return u_morton_alt; }
-  [[nodiscard]] const morton_t* getUniqueKeys() const { return u_morton_alt; }
+  [[nodiscard]] const Key* getSortedKeys() const { return u_morton; }
+  [[nodiscard]] Key* getUniqueKeys() { return u_morton_alt; }
+  [[nodiscard]] const Key* getUniqueKeys() const { return u_morton_alt; }
 
   void clearSmem();
+
+ private:
+  // which optional arrays are allocated
+  struct OptionalArrays {
+    bool point_order = false;
+    bool soa = false;
+    bool packed3 = false;
+    shared::BrtLayout brt_layout = shared::BrtLayout::kSoA;
+  };
+
+  [[nodiscard]] OptionalArrays optional_arrays() const;
+  [[nodiscard]] static size_t bytes_per_point(const OptionalArrays& optional);
+
+  void allocate_arrays(size_t n, const OptionalArrays& optional);
+  // also nulls the pointers
+  void release_arrays();
 };
+
+// defined and instantiated in structures.cpp for these two
+using Pipe = BasicPipe<morton_t>;
+using Pipe64 = BasicPipe<morton64_t>;
@@ -2,37 +2,50 @@
 
 #include <spdlog/spdlog.h>
 
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "buffer.hpp"
+#include "kernel.hpp"
 
-class Algorithm final : public VulkanResource<VkShaderModule> {
+// How a shader uses the buffer at a binding. 'Sequence::record_dispatch'
+// derives the barriers between dispatches from it.
+enum class BufferAccess { kRead, kWrite, kReadWrite };
+
+// A use of a Kernel with a set of buffers: its own descriptor set and push
+// constants, over the pipeline shared by every Algorithm of the same shader.
+class Algorithm final : public VulkanResource<VkDescriptorSet> {
  public:
   Algorithm() = delete;
 
   explicit Algorithm(std::shared_ptr<VkDevice> device_ptr,
-                     std::string_view spirv_filename,
+                     std::shared_ptr<const Kernel> kernel,
                      const std::vector<std::shared_ptr<Buffer>>& buffers,
-                     uint32_t push_constants_size)
-      : VulkanResource<VkShaderModule>(std::move(device_ptr)),
-        spirv_filename_(spirv_filename),
+                     std::vector<BufferAccess> access = {})
+      : VulkanResource<VkDescriptorSet>(std::move(device_ptr)),
+        kernel_(std::move(kernel)),
         usm_buffers_(buffers),
-        push_constants_data_(push_constants_size),
-        push_constants_size_(push_constants_size) {
+        access_(std::move(access)),
+        push_constants_data_(kernel_->key().push_constants_size),
+        push_constants_size_(kernel_->key().push_constants_size) {
+    // undeclared buffers are read and written
+    if (access_.empty()) {
+      access_.assign(usm_buffers_.size(), BufferAccess::kReadWrite);
+    }
+    if (access_.size() != usm_buffers_.size() ||
+        usm_buffers_.size() != kernel_->key().n_buffers) {
+      throw std::invalid_argument("Algorithm: one access per buffer");
+    }
+
     spdlog::debug(
         "Algorithm::Algorithm() [{}]: Creating algorithm with {} buffers",
-        spirv_filename_,
+        kernel_->key().spirv_filename,
         buffers.size());
 
-    create_shader_module();
-
-    create_descriptor_set_layout();
     create_descriptor_pool();
     allocate_descriptor_sets();
     update_descriptor_sets();
-
-    create_pipeline();
   }
 
   ~Algorithm() override { destroy(); }
@@ -47,6 +60,16 @@ class Algorithm final : public VulkanResource<VkShaderModule> {
     std::memcpy(push_constants_data_.data(), &push_const_struct, sizeof(T));
   }
 
+  // the bound buffers and how the shader uses each of them
+  [[nodiscard]] const std::vector<std::shared_ptr<Buffer>>& buffers() const {
+    return usm_buffers_;
+  }
+  [[nodiscard]] BufferAccess access(const size_t binding) const {
+    return access_[binding];
+  }
+  [[nodiscard]] const Kernel& kernel() const { return *kernel_; }
+
+  // Rebinds the buffers, which keep the declared accesses of their bindings.
   void update_descriptor_sets_with_buffers(
       const std::vector<std::shared_ptr<Buffer>>& buffers);
   void update_descriptor_sets();
@@ -59,21 +82,14 @@ class Algorithm final : public VulkanResource<VkShaderModule> {
  private:
   void destroy() override;
 
-  void create_shader_module();
-  void create_pipeline();
-  void create_descriptor_set_layout();
   void create_descriptor_pool();
   void allocate_descriptor_sets();
 
-  VkPipeline pipeline_ = VK_NULL_HANDLE;
-  VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
-  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
-  VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+  std::shared_ptr<const Kernel> kernel_;
   VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
-  VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
 
-  std::string spirv_filename_;
   std::vector<std::shared_ptr<Buffer>> usm_buffers_;
+  std::vector<BufferAccess> access_;
   std::vector<std::byte> push_constants_data_;
   uint32_t push_constants_size_ = 0;
 
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <filesystem>
+#include <map>
 #include <memory>
 #include <vector>
 
 #include "algorithm.hpp"
 #include "base_engine.hpp"
 #include "buffer.hpp"
+#include "pipeline_cache.hpp"
 #include "sequence.hpp"
 #include "typed_buffer.hpp"
 class Engine final : public BaseEngine {
  public:
-  Engine(bool manage_resources = true) : manage_resources_(manage_resources) {}
+  // The algorithms share one pipeline cache, loaded from
+  // 'pipeline_cache_dir' and saved back there on 'destroy()'. An empty
+  // directory keeps it in memory.
+  Engine(bool manage_resources = true,
+         const std::filesystem::path &pipeline_cache_dir =
+             default_pipeline_cache_dir());
 
   ~Engine();
 
@@ -18,7 +26,7 @@ class Engine final : public BaseEngine {
     auto buf = std::make_shared<Buffer>(this->get_device_ptr(), size);
 
     if (manage_resources_) {
-      buffers_.push_back(buf);
+      track(buffers_, buf);
     }
     return buf;
   }
@@ -30,41 +38,81 @@ class Engine final : public BaseEngine {
     auto buf = std::make_shared<TypedBuffer<T>>(this->get_device_ptr(), count);
 
     if (manage_resources_) {
-      buffers_.push_back(buf);
+      track(buffers_, buf);
     }
 
     return buf;
   }
 
+  // 'access[i]' is how the shader uses 'buffers[i]', all are read and written
+  // if it is empty. The shader is compiled once per engine and set of
+  // specialization constants, later algorithms of it only get a descriptor
+  // set.
   [[nodiscard]] auto algorithm(
       const std::string &spirv_filename,
       const std::vector<std::shared_ptr<Buffer>> &buffers,
-      const uint32_t push_constants_size) -> std::shared_ptr<Algorithm> {
+      const uint32_t push_constants_size,
+      std::vector<BufferAccess> access = {},
+      SpecConstants spec_constants = {}) -> std::shared_ptr<Algorithm> {
     auto algo = std::make_shared<Algorithm>(
-        this->get_device_ptr(), spirv_filename, buffers, push_constants_size);
+        this->get_device_ptr(),
+        kernel({spirv_filename,
+                static_cast<uint32_t>(buffers.size()),
+                push_constants_size,
+                std::move(spec_constants)}),
+        buffers,
+        std::move(access));
 
     if (manage_resources_) {
-      algorithms_.push_back(algo);
+      track(algorithms_, algo);
     }
     return algo;
   }
 
+  // The shared compiled shader for 'key', created on first use.
+  [[nodiscard]] auto kernel(const KernelKey &key)
+      -> std::shared_ptr<const Kernel>;
+
+  [[nodiscard]] size_t n_kernels() const { return kernels_.size(); }
+
   [[nodiscard]] auto sequence() -> std::shared_ptr<Sequence> {
     auto seq = std::make_shared<Sequence>(this->get_device_ptr(),
                                           this->get_queue(),
                                           this->get_compute_queue_index());
 
     if (manage_resources_) {
-      sequences_.push_back(seq);
+      track(sequences_, seq);
     }
     return seq;
   }
 
+  [[nodiscard]] VkPipelineCache get_pipeline_cache() const {
+    return pipeline_cache_ ? pipeline_cache_->get_handle() : VK_NULL_HANDLE;
+  }
+  [[nodiscard]] const PipelineCache *pipeline_cache() const {
+    return pipeline_cache_.get();
+  }
+
+  // Writes what the driver compiled so far, e.g. after warming up.
+  void save_pipeline_cache() const;
+
   void destroy();
 
  private:
+  // Remembers 'resource' for 'destroy()' and forgets the ones already freed,
+  // so an engine that creates algorithms every frame does not keep growing.
+  template <typename T, typename Resource>
+  static void track(std::vector<std::weak_ptr<T>> &resources,
+                    const std::shared_ptr<Resource> &resource) {
+    std::erase_if(resources, [](const auto &weak) { return weak.expired(); });
+    resources.push_back(resource);
+  }
+
+  std::unique_ptr<PipelineCache> pipeline_cache_;
+
   std::vector<std::weak_ptr<Buffer>> buffers_;
   std::vector<std::weak_ptr<Algorithm>> algorithms_;
+  std::map<KernelKey, std::shared_ptr<Kernel>> kernels_;
   std::vector<std::weak_ptr<Sequence>> sequences_;
 
   bool manage_resources_ = true;
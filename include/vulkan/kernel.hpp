@@ -0,0 +1,71 @@
+#pragma once
+
+#include <compare>
+#include <map>
+#include <string>
+
+#include "base_engine.hpp"
+#include "vulkan_resource.hpp"
+
+// -----------------------------------------------------------------------------
+// The compiled part of an Algorithm: the shader module, its layouts and the
+// compute pipeline. It does not depend on the bound buffers, so the Engine
+// creates one per key and every Algorithm of that shader shares it; a new
+// Algorithm then only allocates and writes a descriptor set.
+// -----------------------------------------------------------------------------
+
+// Specialization constants by 'constant_id', all 32-bit ('uint', 'int',
+// 'float' bits or 'bool'). Missing ones keep the default of the shader.
+using SpecConstants = std::map<uint32_t, uint32_t>;
+
+// The 'constant_id's the shaders agree on.
+namespace spec {
+// 'local_size_x_id' of every shader
+constexpr uint32_t kWorkgroupSize = 0;
+// keys per thread of a radix sort tile
+constexpr uint32_t kItemsPerThread = 1;
+}  // namespace spec
+
+struct KernelKey {
+  std::string spirv_filename;
+  uint32_t n_buffers;
+  uint32_t push_constants_size;
+  SpecConstants spec_constants;
+
+  auto operator<=>(const KernelKey &) const = default;
+};
+
+class Kernel final : public VulkanResource<VkShaderModule> {
+ public:
+  Kernel() = delete;
+
+  explicit Kernel(std::shared_ptr<VkDevice> device_ptr,
+                  KernelKey key,
+                  VkPipelineCache pipeline_cache);
+
+  ~Kernel() override { destroy(); }
+
+  [[nodiscard]] const KernelKey &key() const { return key_; }
+  [[nodiscard]] VkPipeline pipeline() const { return pipeline_; }
+  [[nodiscard]] VkPipelineLayout pipeline_layout() const {
+    return pipeline_layout_;
+  }
+  [[nodiscard]] VkDescriptorSetLayout descriptor_set_layout() const {
+    return descriptor_set_layout_;
+  }
+
+ private:
+  void destroy() override;
+
+  void create_shader_module();
+  void create_descriptor_set_layout();
+  void create_pipeline(VkPipelineCache pipeline_cache);
+
+  KernelKey key_;
+
+  VkPipeline pipeline_ = VK_NULL_HANDLE;
+  VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+  VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+
+  friend class Engine;
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "engine.hpp"
+#include "shared/brt_layout.h"
+#include "shared/morton_func.h"
+#include "shared/sort_plan.h"
+#include "shared/structures.h"
+
+namespace vk {
+
+// The workgroup sizes of the pipe's shaders and the keys per thread of its
+// radix sort, given to them as specialization constants so they can be tuned
+// per GPU without recompiling. The defaults are the shaders' own. The scan's
+// workgroup size must be a power of two.
+struct PipeTuning {
+  uint32_t bounds_threads = 256;
+  uint32_t morton_threads = 768;
+  uint32_t sort_threads = 256;
+  uint32_t items_per_thread = 8;
+  uint32_t scan_threads = 256;
+  uint32_t unique_threads = 256;
+  uint32_t brt_threads = 256;
+  uint32_t clear_threads = 256;
+  uint32_t edge_threads = 512;
+  uint32_t octree_threads = 512;
+};
+
+// ----------------------------------------------------------------------------
+// The whole octree pipeline on the GPU: bounds -> Morton codes -> radix sort ->
+// unique -> radix tree -> edge count -> edge offsets -> octree. 'run()'
+// records the dispatches into one 'Sequence', which puts a barrier between
+// dependent ones from the buffer accesses each 'Algorithm' declares.
+//
+// A frame is one submit and one fence wait. The morton codes also reduce the
+// AND and OR of all keys, which radix_plan.comp turns into the radix sort's
+// passes on the device ('shared::make_radix_plan'), leaving out the digits
+// that are the same in every key. Every pass a key may need is recorded, the
+// ones the plan leaves out return at once. If the octree did not fit, its
+// arrays grow to the total of the edge offsets and a second submit builds it
+// again, which the grown capacity keeps from happening on the next frames.
+//
+// The counts that depend on the data (unique keys, radix tree and octree
+// nodes) stay on the device in a counters buffer, so the later kernels are
+// dispatched for 'n_input()' items and stop at the count they read. They are
+// read back on the host after the frame.
+//
+// The morton codes quantize the box picked by 'bounds_mode', as on the CPU
+// ('BasicPipe::bounds_mode'): the bounding box is reduced on the device and
+// stays there, 'min_coord'/'range' only give the kFixed cube.
+//
+// The results mirror 'BasicPipe' (radix tree in the 'kPacked' layout, octree
+// as separate arrays), and the buffers are host visible, so fill
+// 'u_points' before 'run()' and read the others after it. The engine must
+// outlive the pipe.
+// ----------------------------------------------------------------------------
+class Pipe {
+ public:
+  Pipe(Engine& engine,
+       int n_points,
+       float min_coord,
+       float range,
+       const PipeTuning& tuning = {});
+
+  Pipe(const Pipe&) = delete;
+  Pipe& operator=(const Pipe&) = delete;
+
+  // One frame, blocks until the GPU is done.
+  void run();
+
+  [[nodiscard]] int n_input() const { return n_points_; }
+  [[nodiscard]] int n_unique() const {
+    return static_cast<int>(u_counters_->at(0).n_unique);
+  }
+  [[nodiscard]] int n_brt_nodes() const {
+    return static_cast<int>(u_counters_->at(0).n_brt_nodes);
+  }
+  [[nodiscard]] int n_oct_nodes() const {
+    return static_cast<int>(u_counters_->at(0).n_oct_nodes);
+  }
+  [[nodiscard]] int oct_capacity() const { return oct_capacity_; }
+  // the radix sort passes of the last frame, as planned on the device
+  [[nodiscard]] shared::RadixPlan radix_plan() const;
+  [[nodiscard]] const PipeTuning& tuning() const { return tuning_; }
+
+  [[nodiscard]] shared::BrtView<shared::BrtLayout::kPacked> brt() const {
+    return {u_brt_nodes->data(), u_parents->data()};
+  }
+
+  // the quantization box of the last frame
+  [[nodiscard]] glm::vec3 box_min() const { return glm::vec3(u_box->at(0)); }
+  [[nodiscard]] glm::vec3 box_range() const {
+    return glm::vec3(u_box->at(1));
+  }
+
+  // read by the next 'run()'
+  shared::BoundsMode bounds_mode = shared::BoundsMode::kAabb;
+
+  // [Inputs]
+  std::shared_ptr<TypedBuffer<glm::vec4>> u_points;
+
+  // [Outputs] 'box_min' and 'box_range', 'w' unused
+  std::shared_ptr<TypedBuffer<glm::vec4>> u_box;
+
+  // [Outputs] sorted codes with duplicates, then the unique ones
+  std::shared_ptr<TypedBuffer<morton_t>> u_morton;
+  std::shared_ptr<TypedBuffer<morton_t>> u_morton_alt;
+
+  std::shared_ptr<TypedBuffer<shared::PackedBrtNode>> u_brt_nodes;
+  std::shared_ptr<TypedBuffer<int>> u_parents;
+
+  std::shared_ptr<TypedBuffer<int>> u_edge_counts;
+  std::shared_ptr<TypedBuffer<int>> u_edge_offsets;
+
+  std::shared_ptr<TypedBuffer<std::array<int, 8>>> u_children;
+  std::shared_ptr<TypedBuffer<glm::vec4>> u_corner;
+  std::shared_ptr<TypedBuffer<float>> u_cell_size;
+  std::shared_ptr<TypedBuffer<int>> u_child_node_mask;
+  std::shared_ptr<TypedBuffer<int>> u_child_leaf_mask;
+
+ private:
+  // the layout of the shaders' 'Counters' block
+  struct Counters {
+    uint32_t n_unique;
+    uint32_t n_brt_nodes;
+    uint32_t n_oct_nodes;
+  };
+
+  // the layout of morton.comp's 'KeyBits' block
+  struct KeyBits {
+    uint32_t and_bits;
+    uint32_t or_bits;
+  };
+
+  // the layout of radix_plan.comp's 'Plan' block, (shift, bits) per pass
+  struct DevicePlan {
+    uint32_t n_passes;
+    uint32_t pad;
+    std::array<std::array<uint32_t, 2>, 4> passes;
+  };
+
+  // A prefix sum of 'in' into 'out', in three dispatches.
+  struct Scan {
+    std::shared_ptr<Algorithm> local;   // naive_prefix_sum.spv
+    std::shared_ptr<Algorithm> blocks;  // scan_block_sums.spv
+    std::shared_ptr<Algorithm> add;     // add_block_offsets.spv
+  };
+
+  [[nodiscard]] Scan make_scan(Engine& engine,
+                               const std::shared_ptr<Buffer>& in,
+                               const std::shared_ptr<Buffer>& out) const;
+  void make_octree(int capacity);
+  void record_scan(const Scan& scan, uint32_t n) const;
+  void record_radix_sort() const;
+  void record_frame() const;
+  void record_clear_octree() const;
+  void record_build_octree() const;
+  void submit() const;
+
+  Engine& engine_;
+  int n_points_;
+  float min_coord_;
+  float range_;
+  PipeTuning tuning_;
+  int n_tiles_;  // of the radix sort
+  int oct_capacity_ = 0;
+
+  std::shared_ptr<TypedBuffer<glm::vec4>> u_bounds_;  // per workgroup
+  std::shared_ptr<TypedBuffer<uint32_t>> u_histogram_;
+  std::shared_ptr<TypedBuffer<uint32_t>> u_histogram_scan_;
+  std::shared_ptr<TypedBuffer<uint32_t>> u_block_sums_;
+  std::shared_ptr<TypedBuffer<KeyBits>> u_key_bits_;
+  std::shared_ptr<TypedBuffer<DevicePlan>> u_radix_plan_;
+  std::shared_ptr<TypedBuffer<Counters>> u_counters_;
+
+  std::shared_ptr<Algorithm> bounds_;
+  std::shared_ptr<Algorithm> bounds_box_;
+  std::shared_ptr<Algorithm> morton_;
+  std::shared_ptr<Algorithm> radix_plan_;
+  // one per sort direction, [0] reads 'u_morton', [1] 'u_morton_alt'
+  std::array<std::shared_ptr<Algorithm>, 2> histogram_;
+  std::array<std::shared_ptr<Algorithm>, 2> scatter_;
+  Scan histogram_scan_;
+  // back to 'u_morton' after an odd number of passes
+  std::shared_ptr<Algorithm> copy_keys_;
+  std::shared_ptr<Algorithm> unique_flags_;
+  // also the scan of the unique flags, which live in the edge arrays
+  Scan edge_scan_;
+  std::shared_ptr<Algorithm> unique_scatter_;
+  std::shared_ptr<Algorithm> build_radix_tree_;
+  std::shared_ptr<Algorithm> edge_count_;
+  std::shared_ptr<Algorithm> clear_octree_;
+  std::shared_ptr<Algorithm> build_octree_;
+  std::shared_ptr<Algorithm> link_leaves_;
+
+  std::shared_ptr<Sequence> seq_;
+};
+
+}  // namespace vk
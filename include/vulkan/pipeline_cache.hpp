@@ -0,0 +1,68 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "base_engine.hpp"
+#include "vulkan_resource.hpp"
+
+// -----------------------------------------------------------------------------
+// One VkPipelineCache shared by every Algorithm of an Engine, persisted in a
+// file so the driver can skip compiling SPIR-V it already compiled in an
+// earlier run.
+//
+// The file is named after the device (vendor, device, driver version and
+// pipeline cache UUID), so a driver update starts a new one. Its Vulkan header
+// is checked against the device before use; a missing, truncated or foreign
+// file just gives an empty cache.
+// -----------------------------------------------------------------------------
+
+// Where engines keep their pipeline cache unless told otherwise. On Android,
+// next to the shaders in "/data/local/tmp".
+[[nodiscard]] inline std::filesystem::path default_pipeline_cache_dir() {
+#ifdef __ANDROID__
+  return "/data/local/tmp";
+#else
+  return std::filesystem::temp_directory_path();
+#endif
+}
+
+class PipelineCache final : public VulkanResource<VkPipelineCache> {
+ public:
+  // An empty 'directory' keeps the cache in memory only.
+  explicit PipelineCache(std::shared_ptr<VkDevice> device_ptr,
+                         VkPhysicalDevice physical_device,
+                         const std::filesystem::path &directory);
+
+  ~PipelineCache() override { destroy(); }
+
+  // Writes the cache to its file, through a temporary so a crash mid-write
+  // never leaves a corrupt one. Does nothing for in-memory caches.
+  void save() const;
+
+  [[nodiscard]] const std::filesystem::path &path() const { return path_; }
+
+  // bytes accepted from the file when the cache was created
+  [[nodiscard]] size_t loaded_size() const { return loaded_size_; }
+
+  // the file name for a device, e.g. "pipeline-cache-13b5-92020010-<uuid>.bin"
+  [[nodiscard]] static std::string file_name(
+      const VkPhysicalDeviceProperties &properties);
+
+  // Whether 'data' starts with a valid cache header for the device.
+  [[nodiscard]] static bool is_compatible(
+      const std::vector<std::byte> &data,
+      const VkPhysicalDeviceProperties &properties);
+
+ private:
+  void destroy() override;
+
+  [[nodiscard]] std::vector<std::byte> load() const;
+
+  VkPhysicalDeviceProperties properties_;
+  std::filesystem::path path_;
+  size_t loaded_size_ = 0;
+
+  friend class Engine;
+};
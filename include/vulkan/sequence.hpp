@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "algorithm.hpp"
 #include "base_engine.hpp"
 #include "vulkan_resource.hpp"
@@ -27,8 +29,11 @@ class Sequence final : public VulkanResource<VkCommandBuffer> {
   // ---------------------------------------------------------------------------
 
  public:
-  void cmd_begin() const;
-  void cmd_end() const;
+  // Starts recording, and forgets the buffers of the previous recording.
+  void cmd_begin();
+  // Ends recording, after a barrier that makes the last writes visible to the
+  // host.
+  void cmd_end();
 
   // /**
   //  * @brief Record the commands of an Algorithm. It will bind pipeline, push
@@ -47,14 +52,42 @@ class Sequence final : public VulkanResource<VkCommandBuffer> {
   // }
 
   void record_commands_with_blocks(const Algorithm *algo,
-                                   const uint32_t n_blocks) const {
+                                   const uint32_t n_blocks) {
     cmd_begin();
-    algo->record_bind_core(this->get_handle());
-    algo->record_bind_push(this->get_handle());
-    algo->record_dispatch_with_blocks(this->get_handle(), n_blocks);
+    record_dispatch(algo, n_blocks);
     cmd_end();
   }
 
+  /**
+   * @brief Append one dispatch of an Algorithm, with the push constants it has
+   * now, between 'cmd_begin()' and 'cmd_end()'. Any number of dispatches can
+   * be recorded this way and submitted at once.
+   *
+   * A barrier is recorded first if the dispatch depends on the ones since the
+   * last barrier, according to the accesses the Algorithms declare: it reads
+   * or writes a buffer they wrote, or writes one they read.
+   */
+  void record_dispatch(const Algorithm *algo, uint32_t n_blocks);
+
+  // The same, setting the push constants first.
+  template <typename T>
+  void record_dispatch(Algorithm *algo,
+                       const T &push_constants,
+                       const uint32_t n_blocks) {
+    algo->set_push_constants(push_constants);
+    record_dispatch(algo, n_blocks);
+  }
+
+  /**
+   * @brief Make the shader writes recorded so far visible to the dispatches
+   * recorded after it, and to the host once the fence has signaled.
+   * 'record_dispatch()' calls it when needed.
+   */
+  void record_compute_barrier();
+
+  // barriers since 'cmd_begin()'
+  [[nodiscard]] int n_recorded_barriers() const { return n_barriers_; }
+
   /**
    * @brief Once all commands are recorded, you can launch the kernel. It will
    * submit all the commands to the GPU. It is asynchronous, so you can do other
@@ -85,5 +118,10 @@ class Sequence final : public VulkanResource<VkCommandBuffer> {
   VkCommandPool command_pool_ = VK_NULL_HANDLE;
   VkFence fence_ = VK_NULL_HANDLE;
 
+  // the buffers read and written since the last barrier
+  std::vector<VkBuffer> read_;
+  std::vector<VkBuffer> written_;
+  int n_barriers_ = 0;
+
   friend class Engine;
 };
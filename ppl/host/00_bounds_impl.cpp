@@ -0,0 +1,235 @@
+#include "host/00_bounds_impl.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "block.hpp"
+#include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "third-party/BS_thread_pool.hpp"
+
+namespace {
+
+constexpr auto inf = std::numeric_limits<float>::infinity();
+
+// Four float lanes, with the few operations the reduction needs. Min/max
+// reductions do not auto-vectorize without -ffast-math, so spell them out.
+#if defined(__x86_64__) || defined(_M_X64)
+using f32x4 = __m128;
+inline f32x4 load4(const float* p) { return _mm_loadu_ps(p); }
+inline f32x4 splat4(const float v) { return _mm_set1_ps(v); }
+inline f32x4 min4(const f32x4 a, const f32x4 b) { return _mm_min_ps(a, b); }
+inline f32x4 max4(const f32x4 a, const f32x4 b) { return _mm_max_ps(a, b); }
+inline void store4(float* p, const f32x4 v) { _mm_storeu_ps(p, v); }
+#elif defined(__ARM_NEON)
+using f32x4 = float32x4_t;
+inline f32x4 load4(const float* p) { return vld1q_f32(p); }
+inline f32x4 splat4(const float v) { return vdupq_n_f32(v); }
+inline f32x4 min4(const f32x4 a, const f32x4 b) { return vminq_f32(a, b); }
+inline f32x4 max4(const f32x4 a, const f32x4 b) { return vmaxq_f32(a, b); }
+inline void store4(float* p, const f32x4 v) { vst1q_f32(p, v); }
+#else
+struct f32x4 {
+  float v[4];
+};
+inline f32x4 load4(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline f32x4 splat4(const float v) { return {{v, v, v, v}}; }
+inline f32x4 min4(const f32x4 a, const f32x4 b) {
+  return {{std::min(a.v[0], b.v[0]),
+           std::min(a.v[1], b.v[1]),
+           std::min(a.v[2], b.v[2]),
+           std::min(a.v[3], b.v[3])}};
+}
+inline f32x4 max4(const f32x4 a, const f32x4 b) {
+  return {{std::max(a.v[0], b.v[0]),
+           std::max(a.v[1], b.v[1]),
+           std::max(a.v[2], b.v[2]),
+           std::max(a.v[3], b.v[3])}};
+}
+inline void store4(float* p, const f32x4 v) { std::copy_n(v.v, 4, p); }
+#endif
+
+// One accumulator per axis and bound. An empty one stays 'lower > upper'.
+struct bounds_acc {
+  float lo_x = inf, lo_y = inf, lo_z = inf;
+  float hi_x = -inf, hi_y = -inf, hi_z = -inf;
+
+  void add_lo(const float x, const float y, const float z) {
+    lo_x = std::min(lo_x, x);
+    lo_y = std::min(lo_y, y);
+    lo_z = std::min(lo_z, z);
+  }
+
+  void add_hi(const float x, const float y, const float z) {
+    hi_x = std::max(hi_x, x);
+    hi_y = std::max(hi_y, y);
+    hi_z = std::max(hi_z, z);
+  }
+
+  void add(const float x, const float y, const float z) {
+    add_lo(x, y, z);
+    add_hi(x, y, z);
+  }
+
+  void merge(const bounds_acc& o) {
+    add_lo(o.lo_x, o.lo_y, o.lo_z);
+    add_hi(o.hi_x, o.hi_y, o.hi_z);
+  }
+};
+
+// The four lanes of 'v', for the final horizontal folds
+struct lanes {
+  float v[4];
+
+  explicit lanes(const f32x4 x) { store4(v, x); }
+
+  [[nodiscard]] float min() const { return std::min({v[0], v[1], v[2], v[3]}); }
+  [[nodiscard]] float max() const { return std::max({v[0], v[1], v[2], v[3]}); }
+};
+
+// A vec4 is exactly one f32x4 (lane 'w' is ignored). Two accumulator pairs
+// hide the latency of min/max.
+bounds_acc reduce_vec4(const glm::vec4* points, const int n) {
+  f32x4 lo[2] = {splat4(inf), splat4(inf)};
+  f32x4 hi[2] = {splat4(-inf), splat4(-inf)};
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    for (int k = 0; k < 2; ++k) {
+      const auto v = load4(&points[i + k].x);
+      lo[k] = min4(lo[k], v);
+      hi[k] = max4(hi[k], v);
+    }
+  }
+  if (i < n) {
+    const auto v = load4(&points[i].x);
+    lo[0] = min4(lo[0], v);
+    hi[0] = max4(hi[0], v);
+  }
+
+  const lanes l(min4(lo[0], lo[1]));
+  const lanes h(max4(hi[0], hi[1]));
+  bounds_acc acc;
+  acc.add_lo(l.v[0], l.v[1], l.v[2]);
+  acc.add_hi(h.v[0], h.v[1], h.v[2]);
+  return acc;
+}
+
+// One f32x4 per axis, four points at a time
+bounds_acc reduce_soa(const float* xs,
+                      const float* ys,
+                      const float* zs,
+                      const int n) {
+  const float* axes[3] = {xs, ys, zs};
+  f32x4 lo[3] = {splat4(inf), splat4(inf), splat4(inf)};
+  f32x4 hi[3] = {splat4(-inf), splat4(-inf), splat4(-inf)};
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (int a = 0; a < 3; ++a) {
+      const auto v = load4(axes[a] + i);
+      lo[a] = min4(lo[a], v);
+      hi[a] = max4(hi[a], v);
+    }
+  }
+
+  bounds_acc acc;
+  acc.add_lo(lanes(lo[0]).min(), lanes(lo[1]).min(), lanes(lo[2]).min());
+  acc.add_hi(lanes(hi[0]).max(), lanes(hi[1]).max(), lanes(hi[2]).max());
+  for (; i < n; ++i) {
+    acc.add(xs[i], ys[i], zs[i]);
+  }
+  return acc;
+}
+
+// The packed stream repeats every 12 floats (4 points), so three f32x4
+// accumulators hold fixed axes per lane:
+//   [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+bounds_acc reduce_packed3(const glm::vec3* points, const int n) {
+  const float* f = &points[0].x;
+  f32x4 lo[3] = {splat4(inf), splat4(inf), splat4(inf)};
+  f32x4 hi[3] = {splat4(-inf), splat4(-inf), splat4(-inf)};
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (int k = 0; k < 3; ++k) {
+      const auto v = load4(f + 3 * i + 4 * k);
+      lo[k] = min4(lo[k], v);
+      hi[k] = max4(hi[k], v);
+    }
+  }
+
+  bounds_acc acc;
+  // 'add' is 'add_lo' or 'add_hi'
+  const auto fold = [&acc](const auto add, const f32x4* v) {
+    const lanes a(v[0]);
+    const lanes b(v[1]);
+    const lanes c(v[2]);
+    (acc.*add)(a.v[0], a.v[1], a.v[2]);
+    (acc.*add)(a.v[3], b.v[0], b.v[1]);
+    (acc.*add)(b.v[2], b.v[3], c.v[0]);
+    (acc.*add)(c.v[1], c.v[2], c.v[3]);
+  };
+  fold(&bounds_acc::add_lo, lo);
+  fold(&bounds_acc::add_hi, hi);
+  for (; i < n; ++i) {
+    acc.add(points[i].x, points[i].y, points[i].z);
+  }
+  return acc;
+}
+
+template <typename Key>
+bounds_acc reduce_range(const BasicPipe<Key>& p,
+                        const int start,
+                        const int end) {
+  const auto n = end - start;
+  switch (p.point_layout) {
+    case shared::PointLayout::kSoA:
+      return reduce_soa(p.u_xs + start, p.u_ys + start, p.u_zs + start, n);
+    case shared::PointLayout::kPacked3:
+      return reduce_packed3(p.u_points3 + start, n);
+    case shared::PointLayout::kVec4:
+      break;
+  }
+  return reduce_vec4(p.u_points + start, n);
+}
+
+}  // namespace
+
+template <typename Pool, typename Key>
+shared::Aabb cpu::dispatch_parallel_bounds(Pool& pool,
+                                           const size_t n_threads,
+                                           const BasicPipe<Key>& p) {
+  const auto blks = partition_blocks(pool, 0, p.n_input(), n_threads);
+
+  std::vector<bounds_acc> block_bounds(blks.get_num_blocks());
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    block_bounds[blk] = reduce_range(p, start, end);
+  });
+
+  bounds_acc acc;
+  for (const auto& b : block_bounds) {
+    acc.merge(b);
+  }
+  return {glm::vec3(acc.lo_x, acc.lo_y, acc.lo_z),
+          glm::vec3(acc.hi_x, acc.hi_y, acc.hi_z)};
+}
+
+#define INSTANTIATE_KEY_BOUNDS(POOL, KEY)                                     \
+  template shared::Aabb cpu::dispatch_parallel_bounds(                        \
+      POOL& pool, const size_t n_threads, const BasicPipe<KEY>& p);
+
+#define INSTANTIATE_BOUNDS(POOL)                                              \
+  INSTANTIATE_KEY_BOUNDS(POOL, morton_t)                                      \
+  INSTANTIATE_KEY_BOUNDS(POOL, morton64_t)
+
+INSTANTIATE_BOUNDS(core::thread_pool)
+INSTANTIATE_BOUNDS(core::work_stealing_pool)
+INSTANTIATE_BOUNDS(BS::thread_pool)
+
+#undef INSTANTIATE_BOUNDS
+#undef INSTANTIATE_KEY_BOUNDS
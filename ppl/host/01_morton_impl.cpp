@@ -0,0 +1,671 @@
+#include "host/01_morton_impl.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PPL_MORTON_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define PPL_MORTON_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The x86 kernels are compiled for their ISA one function at a time, so the
+// library itself still builds for the baseline and runs anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define PPL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PPL_TARGET(isa)
+#endif
+
+namespace {
+
+constexpr auto bit_scale = 1024.0f;  // same as 'shared::xyz_to_morton32'
+constexpr unsigned int axis_mask = 0x3ff;
+
+// The input layouts as the kernels see them. 'point(i)' is what the scalar
+// paths (and the tails of the vector ones) encode.
+struct vec4_src {
+  const glm::vec4* u_points;
+
+  [[nodiscard]] glm::vec4 point(const int i) const { return u_points[i]; }
+};
+
+struct soa_src {
+  const float* u_xs;
+  const float* u_ys;
+  const float* u_zs;
+
+  [[nodiscard]] glm::vec4 point(const int i) const {
+    return {u_xs[i], u_ys[i], u_zs[i], 1.0f};
+  }
+};
+
+struct packed3_src {
+  const glm::vec3* u_points;
+
+  [[nodiscard]] glm::vec4 point(const int i) const {
+    return {u_points[i], 1.0f};
+  }
+
+  // the floats of point 'i', 'x y z x y z ...'
+  [[nodiscard]] const float* floats(const int i) const {
+    return &u_points[i].x;
+  }
+};
+
+template <typename Src>
+using encode_fn =
+    void (*)(const Src&, int, const glm::vec3&, const glm::vec3&, morton_t*);
+
+template <typename Src>
+void encode_tail(const Src& src,
+                 const int begin,
+                 const int n,
+                 const glm::vec3& min_xyz,
+                 const glm::vec3& range_xyz,
+                 morton_t* u_morton) {
+  for (int i = begin; i < n; ++i) {
+    u_morton[i] = shared::xyz_to_morton32(src.point(i), min_xyz, range_xyz);
+  }
+}
+
+template <typename Src>
+void encode_scalar(const Src& src,
+                   const int n,
+                   const glm::vec3& min_xyz,
+                   const glm::vec3& range_xyz,
+                   morton_t* u_morton) {
+  encode_tail(src, 0, n, min_xyz, range_xyz, u_morton);
+}
+
+// The per-axis box broadcast for the vector kernels. A macro rather than a
+// function, so the intrinsics stay in the function compiled for their ISA.
+#define PPL_PER_AXIS(SET1, v) \
+  { SET1(v.x), SET1(v.y), SET1(v.z) }
+
+#if defined(PPL_MORTON_X86)
+
+// ----------------------------------------------------------------------------
+// BMI2
+// ----------------------------------------------------------------------------
+
+template <typename Src>
+PPL_TARGET("bmi2")
+void encode_bmi2(const Src& src,
+                 const int n,
+                 const glm::vec3& min_xyz,
+                 const glm::vec3& range_xyz,
+                 morton_t* u_morton) {
+  // 'pdep' only deposits as many bits as the mask has, 10 per axis
+  const auto cell = [&](const float v, const int axis) {
+    return static_cast<uint32_t>((v - min_xyz[axis]) / range_xyz[axis] *
+                                 bit_scale);
+  };
+  for (int i = 0; i < n; ++i) {
+    const auto point = src.point(i);
+    u_morton[i] = _pdep_u32(cell(point.x, 0), 0x09249249) |
+                  _pdep_u32(cell(point.y, 1), 0x12492492) |
+                  _pdep_u32(cell(point.z, 2), 0x24924924);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// SSE2, 4 points
+// ----------------------------------------------------------------------------
+
+PPL_TARGET("sse2")
+inline __m128i quantize_sse(const __m128 v,
+                            const __m128 min_coord,
+                            const __m128 range) {
+  const auto scaled = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(v, min_coord), range),
+                                 _mm_set1_ps(bit_scale));
+  return _mm_and_si128(_mm_cvttps_epi32(scaled), _mm_set1_epi32(axis_mask));
+}
+
+PPL_TARGET("sse2")
+inline __m128i split_by_3_sse(__m128i x) {
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi32(x, 16)),
+                    _mm_set1_epi32(0x30000ff));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi32(x, 8)),
+                    _mm_set1_epi32(0x0300f00f));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi32(x, 4)),
+                    _mm_set1_epi32(0x30c30c3));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi32(x, 2)),
+                    _mm_set1_epi32(0x9249249));
+  return x;
+}
+
+PPL_TARGET("sse2")
+inline void load_sse(
+    const vec4_src& src, const int i, __m128& x, __m128& y, __m128& z) {
+  x = _mm_loadu_ps(&src.u_points[i].x);
+  y = _mm_loadu_ps(&src.u_points[i + 1].x);
+  z = _mm_loadu_ps(&src.u_points[i + 2].x);
+  auto w = _mm_loadu_ps(&src.u_points[i + 3].x);
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+PPL_TARGET("sse2")
+inline void load_sse(
+    const soa_src& src, const int i, __m128& x, __m128& y, __m128& z) {
+  x = _mm_loadu_ps(src.u_xs + i);
+  y = _mm_loadu_ps(src.u_ys + i);
+  z = _mm_loadu_ps(src.u_zs + i);
+}
+
+// 'a b c' = 'x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3', used per 128-bit lane by
+// the wider kernels as well
+#define PPL_DEINTERLEAVE3(SHUFFLE, a, b, c, x, y, z)                           \
+  do {                                                                         \
+    const auto b2c1 = SHUFFLE(b, c, _MM_SHUFFLE(1, 0, 3, 2));                  \
+    x = SHUFFLE(a, b2c1, _MM_SHUFFLE(3, 0, 3, 0));                             \
+    y = SHUFFLE(SHUFFLE(a, b, _MM_SHUFFLE(0, 0, 1, 1)),                        \
+                SHUFFLE(b, c, _MM_SHUFFLE(2, 2, 3, 3)),                        \
+                _MM_SHUFFLE(2, 0, 2, 0));                                      \
+    z = SHUFFLE(SHUFFLE(a, b, _MM_SHUFFLE(1, 1, 2, 2)),                        \
+                SHUFFLE(c, c, _MM_SHUFFLE(3, 3, 0, 0)),                        \
+                _MM_SHUFFLE(2, 0, 2, 0));                                      \
+  } while (0)
+
+PPL_TARGET("sse2")
+inline void load_sse(
+    const packed3_src& src, const int i, __m128& x, __m128& y, __m128& z) {
+  const auto f = src.floats(i);
+  const auto a = _mm_loadu_ps(f);
+  const auto b = _mm_loadu_ps(f + 4);
+  const auto c = _mm_loadu_ps(f + 8);
+  PPL_DEINTERLEAVE3(_mm_shuffle_ps, a, b, c, x, y, z);
+}
+
+template <typename Src>
+PPL_TARGET("sse2")
+void encode_sse(const Src& src,
+                const int n,
+                const glm::vec3& min_xyz,
+                const glm::vec3& range_xyz,
+                morton_t* u_morton) {
+  const __m128 v_min[3] = PPL_PER_AXIS(_mm_set1_ps, min_xyz);
+  const __m128 v_range[3] = PPL_PER_AXIS(_mm_set1_ps, range_xyz);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 x, y, z;
+    load_sse(src, i, x, y, z);
+
+    const auto cx = split_by_3_sse(quantize_sse(x, v_min[0], v_range[0]));
+    const auto cy = split_by_3_sse(quantize_sse(y, v_min[1], v_range[1]));
+    const auto cz = split_by_3_sse(quantize_sse(z, v_min[2], v_range[2]));
+    const auto code = _mm_or_si128(
+        cx, _mm_or_si128(_mm_slli_epi32(cy, 1), _mm_slli_epi32(cz, 2)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u_morton + i), code);
+  }
+  encode_tail(src, i, n, min_xyz, range_xyz, u_morton);
+}
+
+// ----------------------------------------------------------------------------
+// AVX2, 8 points
+// ----------------------------------------------------------------------------
+
+PPL_TARGET("avx2")
+inline __m256i quantize_avx2(const __m256 v,
+                             const __m256 min_coord,
+                             const __m256 range) {
+  const auto scaled = _mm256_mul_ps(
+      _mm256_div_ps(_mm256_sub_ps(v, min_coord), range),
+      _mm256_set1_ps(bit_scale));
+  return _mm256_and_si256(_mm256_cvttps_epi32(scaled),
+                          _mm256_set1_epi32(axis_mask));
+}
+
+PPL_TARGET("avx2")
+inline __m256i split_by_3_avx2(__m256i x) {
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 16)),
+                       _mm256_set1_epi32(0x30000ff));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 8)),
+                       _mm256_set1_epi32(0x0300f00f));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 4)),
+                       _mm256_set1_epi32(0x30c30c3));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 2)),
+                       _mm256_set1_epi32(0x9249249));
+  return x;
+}
+
+// 4 floats from 'lo' and 'hi' in the low and high lane
+PPL_TARGET("avx2")
+inline __m256 load_lanes_avx2(const float* lo, const float* hi) {
+  return _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+PPL_TARGET("avx2")
+inline void load_avx2(
+    const vec4_src& src, const int i, __m256& x, __m256& y, __m256& z) {
+  // in-lane 4x4 transpose, lane 0 holds points i..i+3, lane 1 i+4..i+7
+  const auto p = src.u_points + i;
+  const auto r0 = load_lanes_avx2(&p[0].x, &p[4].x);
+  const auto r1 = load_lanes_avx2(&p[1].x, &p[5].x);
+  const auto r2 = load_lanes_avx2(&p[2].x, &p[6].x);
+  const auto r3 = load_lanes_avx2(&p[3].x, &p[7].x);
+  const auto xy01 = _mm256_unpacklo_ps(r0, r1);
+  const auto xy23 = _mm256_unpacklo_ps(r2, r3);
+  const auto zw01 = _mm256_unpackhi_ps(r0, r1);
+  const auto zw23 = _mm256_unpackhi_ps(r2, r3);
+  x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+  y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+  z = _mm256_shuffle_ps(zw01, zw23, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+PPL_TARGET("avx2")
+inline void load_avx2(
+    const soa_src& src, const int i, __m256& x, __m256& y, __m256& z) {
+  x = _mm256_loadu_ps(src.u_xs + i);
+  y = _mm256_loadu_ps(src.u_ys + i);
+  z = _mm256_loadu_ps(src.u_zs + i);
+}
+
+PPL_TARGET("avx2")
+inline void load_avx2(
+    const packed3_src& src, const int i, __m256& x, __m256& y, __m256& z) {
+  const auto f = src.floats(i);
+  const auto a = load_lanes_avx2(f, f + 12);
+  const auto b = load_lanes_avx2(f + 4, f + 16);
+  const auto c = load_lanes_avx2(f + 8, f + 20);
+  PPL_DEINTERLEAVE3(_mm256_shuffle_ps, a, b, c, x, y, z);
+}
+
+template <typename Src>
+PPL_TARGET("avx2")
+void encode_avx2(const Src& src,
+                 const int n,
+                 const glm::vec3& min_xyz,
+                 const glm::vec3& range_xyz,
+                 morton_t* u_morton) {
+  const __m256 v_min[3] = PPL_PER_AXIS(_mm256_set1_ps, min_xyz);
+  const __m256 v_range[3] = PPL_PER_AXIS(_mm256_set1_ps, range_xyz);
+
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x, y, z;
+    load_avx2(src, i, x, y, z);
+
+    const auto cx = split_by_3_avx2(quantize_avx2(x, v_min[0], v_range[0]));
+    const auto cy = split_by_3_avx2(quantize_avx2(y, v_min[1], v_range[1]));
+    const auto cz = split_by_3_avx2(quantize_avx2(z, v_min[2], v_range[2]));
+    const auto code = _mm256_or_si256(
+        cx,
+        _mm256_or_si256(_mm256_slli_epi32(cy, 1), _mm256_slli_epi32(cz, 2)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(u_morton + i), code);
+  }
+  encode_tail(src, i, n, min_xyz, range_xyz, u_morton);
+}
+
+// ----------------------------------------------------------------------------
+// AVX-512F, 16 points
+// ----------------------------------------------------------------------------
+
+// GCC 12 warns about the '_mm512_undefined_*' placeholders in its own
+// intrinsics once they are inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+PPL_TARGET("avx512f")
+inline __m512i quantize_avx512(const __m512 v,
+                               const __m512 min_coord,
+                               const __m512 range) {
+  const auto scaled = _mm512_mul_ps(
+      _mm512_div_ps(_mm512_sub_ps(v, min_coord), range),
+      _mm512_set1_ps(bit_scale));
+  return _mm512_and_si512(_mm512_cvttps_epi32(scaled),
+                          _mm512_set1_epi32(axis_mask));
+}
+
+PPL_TARGET("avx512f")
+inline __m512i split_by_3_avx512(__m512i x) {
+  x = _mm512_and_si512(_mm512_or_si512(x, _mm512_slli_epi32(x, 16)),
+                       _mm512_set1_epi32(0x30000ff));
+  x = _mm512_and_si512(_mm512_or_si512(x, _mm512_slli_epi32(x, 8)),
+                       _mm512_set1_epi32(0x0300f00f));
+  x = _mm512_and_si512(_mm512_or_si512(x, _mm512_slli_epi32(x, 4)),
+                       _mm512_set1_epi32(0x30c30c3));
+  x = _mm512_and_si512(_mm512_or_si512(x, _mm512_slli_epi32(x, 2)),
+                       _mm512_set1_epi32(0x9249249));
+  return x;
+}
+
+PPL_TARGET("avx512f")
+inline void load_avx512(
+    const vec4_src& src, const int i, __m512& x, __m512& y, __m512& z) {
+  // Element 'k' of two registers of 4 points each is component 'k % 4' of
+  // point 'k / 4', so '4 * p + c' picks component 'c' of point 'p' (0..7).
+  const auto idx_xy = _mm512_setr_epi32(
+      0, 4, 8, 12, 16, 20, 24, 28, 1, 5, 9, 13, 17, 21, 25, 29);
+  const auto idx_zw = _mm512_setr_epi32(
+      2, 6, 10, 14, 18, 22, 26, 30, 3, 7, 11, 15, 19, 23, 27, 31);
+
+  const auto p0 = _mm512_loadu_ps(&src.u_points[i].x);
+  const auto p1 = _mm512_loadu_ps(&src.u_points[i + 4].x);
+  const auto p2 = _mm512_loadu_ps(&src.u_points[i + 8].x);
+  const auto p3 = _mm512_loadu_ps(&src.u_points[i + 12].x);
+  const auto xy_lo = _mm512_permutex2var_ps(p0, idx_xy, p1);
+  const auto xy_hi = _mm512_permutex2var_ps(p2, idx_xy, p3);
+  const auto zw_lo = _mm512_permutex2var_ps(p0, idx_zw, p1);
+  const auto zw_hi = _mm512_permutex2var_ps(p2, idx_zw, p3);
+  x = _mm512_shuffle_f32x4(xy_lo, xy_hi, _MM_SHUFFLE(1, 0, 1, 0));
+  y = _mm512_shuffle_f32x4(xy_lo, xy_hi, _MM_SHUFFLE(3, 2, 3, 2));
+  z = _mm512_shuffle_f32x4(zw_lo, zw_hi, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+PPL_TARGET("avx512f")
+inline void load_avx512(
+    const soa_src& src, const int i, __m512& x, __m512& y, __m512& z) {
+  x = _mm512_loadu_ps(src.u_xs + i);
+  y = _mm512_loadu_ps(src.u_ys + i);
+  z = _mm512_loadu_ps(src.u_zs + i);
+}
+
+// 4 floats from 'f', 'f + 12', 'f + 24' and 'f + 36' in lanes 0..3
+PPL_TARGET("avx512f")
+inline __m512 load_lanes_avx512(const float* f) {
+  auto v = _mm512_castps128_ps512(_mm_loadu_ps(f));
+  v = _mm512_insertf32x4(v, _mm_loadu_ps(f + 12), 1);
+  v = _mm512_insertf32x4(v, _mm_loadu_ps(f + 24), 2);
+  return _mm512_insertf32x4(v, _mm_loadu_ps(f + 36), 3);
+}
+
+PPL_TARGET("avx512f")
+inline void load_avx512(
+    const packed3_src& src, const int i, __m512& x, __m512& y, __m512& z) {
+  const auto f = src.floats(i);
+  const auto a = load_lanes_avx512(f);
+  const auto b = load_lanes_avx512(f + 4);
+  const auto c = load_lanes_avx512(f + 8);
+  PPL_DEINTERLEAVE3(_mm512_shuffle_ps, a, b, c, x, y, z);
+}
+
+template <typename Src>
+PPL_TARGET("avx512f")
+void encode_avx512(const Src& src,
+                   const int n,
+                   const glm::vec3& min_xyz,
+                   const glm::vec3& range_xyz,
+                   morton_t* u_morton) {
+  const __m512 v_min[3] = PPL_PER_AXIS(_mm512_set1_ps, min_xyz);
+  const __m512 v_range[3] = PPL_PER_AXIS(_mm512_set1_ps, range_xyz);
+
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 x, y, z;
+    load_avx512(src, i, x, y, z);
+
+    const auto cx =
+        split_by_3_avx512(quantize_avx512(x, v_min[0], v_range[0]));
+    const auto cy =
+        split_by_3_avx512(quantize_avx512(y, v_min[1], v_range[1]));
+    const auto cz =
+        split_by_3_avx512(quantize_avx512(z, v_min[2], v_range[2]));
+    const auto code = _mm512_or_si512(
+        cx,
+        _mm512_or_si512(_mm512_slli_epi32(cy, 1), _mm512_slli_epi32(cz, 2)));
+    _mm512_storeu_si512(u_morton + i, code);
+  }
+  encode_tail(src, i, n, min_xyz, range_xyz, u_morton);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#undef PPL_DEINTERLEAVE3
+
+#endif  // PPL_MORTON_X86
+
+#if defined(PPL_MORTON_NEON)
+
+// ----------------------------------------------------------------------------
+// NEON, 4 points
+// ----------------------------------------------------------------------------
+
+inline uint32x4_t quantize_neon(const float32x4_t v,
+                                const float32x4_t min_coord,
+                                const float32x4_t range) {
+  const auto scaled = vmulq_f32(vdivq_f32(vsubq_f32(v, min_coord), range),
+                                vdupq_n_f32(bit_scale));
+  return vandq_u32(vcvtq_u32_f32(scaled), vdupq_n_u32(axis_mask));
+}
+
+inline uint32x4_t split_by_3_neon(uint32x4_t x) {
+  x = vandq_u32(vorrq_u32(x, vshlq_n_u32(x, 16)), vdupq_n_u32(0x30000ff));
+  x = vandq_u32(vorrq_u32(x, vshlq_n_u32(x, 8)), vdupq_n_u32(0x0300f00f));
+  x = vandq_u32(vorrq_u32(x, vshlq_n_u32(x, 4)), vdupq_n_u32(0x30c30c3));
+  x = vandq_u32(vorrq_u32(x, vshlq_n_u32(x, 2)), vdupq_n_u32(0x9249249));
+  return x;
+}
+
+// de-interleaving loads, 'val[0]' are the x of the 4 points, ...
+inline float32x4x3_t load_neon(const vec4_src& src, const int i) {
+  const auto xyzw = vld4q_f32(&src.u_points[i].x);
+  return {{xyzw.val[0], xyzw.val[1], xyzw.val[2]}};
+}
+
+inline float32x4x3_t load_neon(const soa_src& src, const int i) {
+  return {{vld1q_f32(src.u_xs + i),
+           vld1q_f32(src.u_ys + i),
+           vld1q_f32(src.u_zs + i)}};
+}
+
+inline float32x4x3_t load_neon(const packed3_src& src, const int i) {
+  return vld3q_f32(src.floats(i));
+}
+
+template <typename Src>
+void encode_neon(const Src& src,
+                 const int n,
+                 const glm::vec3& min_xyz,
+                 const glm::vec3& range_xyz,
+                 morton_t* u_morton) {
+  const float32x4_t v_min[3] = PPL_PER_AXIS(vdupq_n_f32, min_xyz);
+  const float32x4_t v_range[3] = PPL_PER_AXIS(vdupq_n_f32, range_xyz);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const auto xyz = load_neon(src, i);
+    const auto cx =
+        split_by_3_neon(quantize_neon(xyz.val[0], v_min[0], v_range[0]));
+    const auto cy =
+        split_by_3_neon(quantize_neon(xyz.val[1], v_min[1], v_range[1]));
+    const auto cz =
+        split_by_3_neon(quantize_neon(xyz.val[2], v_min[2], v_range[2]));
+    const auto code =
+        vorrq_u32(cx, vorrq_u32(vshlq_n_u32(cy, 1), vshlq_n_u32(cz, 2)));
+    vst1q_u32(u_morton + i, code);
+  }
+  encode_tail(src, i, n, min_xyz, range_xyz, u_morton);
+}
+
+#endif  // PPL_MORTON_NEON
+
+#undef PPL_PER_AXIS
+
+// ----------------------------------------------------------------------------
+// Runtime dispatch
+// ----------------------------------------------------------------------------
+
+struct cpu_features {
+  bool bmi2 = false;
+  bool sse = false;
+  bool avx2 = false;
+  bool avx512 = false;
+  bool neon = false;
+
+  cpu_features() {
+#if defined(PPL_MORTON_X86)
+    sse = true;  // part of x86-64
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    bmi2 = __builtin_cpu_supports("bmi2");
+    avx2 = __builtin_cpu_supports("avx2");
+    avx512 = __builtin_cpu_supports("avx512f");
+#endif
+#elif defined(PPL_MORTON_NEON)
+    neon = true;  // mandatory on AArch64
+#endif
+  }
+};
+
+const cpu_features& features() {
+  static const cpu_features f;
+  return f;
+}
+
+template <typename Src>
+encode_fn<Src> kernel_fn(const cpu::MortonKernel kernel) {
+  switch (kernel) {
+#if defined(PPL_MORTON_X86)
+    case cpu::MortonKernel::kBmi2:
+      return encode_bmi2<Src>;
+    case cpu::MortonKernel::kSse:
+      return encode_sse<Src>;
+    case cpu::MortonKernel::kAvx2:
+      return encode_avx2<Src>;
+    case cpu::MortonKernel::kAvx512:
+      return encode_avx512<Src>;
+#endif
+#if defined(PPL_MORTON_NEON)
+    case cpu::MortonKernel::kNeon:
+      return encode_neon<Src>;
+#endif
+    default:
+      return encode_scalar<Src>;
+  }
+}
+
+template <typename Src>
+void encode(const Src& src,
+            const int n,
+            const glm::vec3& min_xyz,
+            const glm::vec3& range_xyz,
+            morton_t* u_morton,
+            cpu::MortonKernel kernel) {
+  if (kernel == cpu::MortonKernel::kAuto) {
+    kernel = cpu::best_morton_kernel();
+  } else if (!cpu::morton_kernel_supported(kernel)) {
+    throw std::invalid_argument(std::string("Morton kernel unsupported: ") +
+                                cpu::morton_kernel_name(kernel));
+  }
+  kernel_fn<Src>(kernel)(src, n, min_xyz, range_xyz, u_morton);
+}
+
+}  // namespace
+
+bool cpu::morton_kernel_supported(const MortonKernel kernel) {
+  switch (kernel) {
+    case MortonKernel::kAuto:
+    case MortonKernel::kScalar:
+      return true;
+    case MortonKernel::kBmi2:
+      return features().bmi2;
+    case MortonKernel::kSse:
+      return features().sse;
+    case MortonKernel::kAvx2:
+      return features().avx2;
+    case MortonKernel::kAvx512:
+      return features().avx512;
+    case MortonKernel::kNeon:
+      return features().neon;
+  }
+  return false;
+}
+
+cpu::MortonKernel cpu::best_morton_kernel() {
+  static const auto best = [] {
+    for (const auto kernel : {MortonKernel::kAvx512,
+                              MortonKernel::kAvx2,
+                              MortonKernel::kSse,
+                              MortonKernel::kNeon}) {
+      if (morton_kernel_supported(kernel)) return kernel;
+    }
+    return MortonKernel::kScalar;
+  }();
+  return best;
+}
+
+const char* cpu::morton_kernel_name(const MortonKernel kernel) {
+  switch (kernel) {
+    case MortonKernel::kAuto:
+      return "auto";
+    case MortonKernel::kScalar:
+      return "scalar";
+    case MortonKernel::kBmi2:
+      return "bmi2";
+    case MortonKernel::kSse:
+      return "sse";
+    case MortonKernel::kAvx2:
+      return "avx2";
+    case MortonKernel::kAvx512:
+      return "avx512";
+    case MortonKernel::kNeon:
+      return "neon";
+  }
+  return "unknown";
+}
+
+void cpu::encode_morton32(const glm::vec4* u_points,
+                          const int n,
+                          const glm::vec3& min_xyz,
+                          const glm::vec3& range_xyz,
+                          morton_t* u_morton,
+                          const MortonKernel kernel) {
+  encode(vec4_src{u_points}, n, min_xyz, range_xyz, u_morton, kernel);
+}
+
+void cpu::encode_morton32_soa(const float* u_xs,
+                              const float* u_ys,
+                              const float* u_zs,
+                              const int n,
+                              const glm::vec3& min_xyz,
+                              const glm::vec3& range_xyz,
+                              morton_t* u_morton,
+                              const MortonKernel kernel) {
+  encode(soa_src{u_xs, u_ys, u_zs}, n, min_xyz, range_xyz, u_morton, kernel);
+}
+
+void cpu::encode_morton32_packed3(const glm::vec3* u_points,
+                                  const int n,
+                                  const glm::vec3& min_xyz,
+                                  const glm::vec3& range_xyz,
+                                  morton_t* u_morton,
+                                  const MortonKernel kernel) {
+  encode(packed3_src{u_points}, n, min_xyz, range_xyz, u_morton, kernel);
+}
+
+void cpu::encode_morton32(const Pipe& p,
+                          const int begin,
+                          const int end,
+                          const MortonKernel kernel) {
+  const auto n = end - begin;
+  const auto out = p.u_morton + begin;
+  switch (p.point_layout) {
+    case shared::PointLayout::kVec4:
+      encode_morton32(
+          p.u_points + begin, n, p.box_min, p.box_range, out, kernel);
+      break;
+    case shared::PointLayout::kSoA:
+      encode_morton32_soa(p.u_xs + begin,
+                          p.u_ys + begin,
+                          p.u_zs + begin,
+                          n,
+                          p.box_min,
+                          p.box_range,
+                          out,
+                          kernel);
+      break;
+    case shared::PointLayout::kPacked3:
+      encode_morton32_packed3(
+          p.u_points3 + begin, n, p.box_min, p.box_range, out, kernel);
+      break;
+  }
+}
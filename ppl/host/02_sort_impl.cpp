@@ -1,8 +1,23 @@
 #include "host/02_sort_impl.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <numeric>
+#include <vector>
 
 #include "block.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "shared/sort_plan.h"
+#include "third-party/BS_thread_pool.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 constexpr int BASE_BITS = 8;
 constexpr int BASE = (1 << BASE_BITS);  // 256
@@ -77,7 +92,8 @@ void k_binning_pass(const size_t tid,
   // DEBUG_PRINT("[tid ", tid, "] ended. (Binning, shift=", shift, ")");
 }
 
-core::multi_future<void> cpu::dispatch_binning_pass(core::thread_pool& pool,
+template <typename Pool>
+core::multi_future<void> cpu::dispatch_binning_pass(Pool& pool,
                                                     const size_t n_threads,
                                                     std::barrier<>& barrier,
                                                     const int n,
@@ -115,4 +131,609 @@ core::multi_future<void> cpu::dispatch_binning_pass(core::thread_pool& pool,
   }
 
   return future;
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// Reentrant parallel LSD radix sort
+// ----------------------------------------------------------------------------
+
+namespace {
+
+constexpr size_t CACHE_LINE = 64;
+
+// Digit width of the write-combining scatter. Its staging lines take
+// 'radix * CACHE_LINE' bytes per thread (16 KB at 8 bits), which has to stay in
+// L1 for the scheme to pay off, so its plans use narrower digits.
+constexpr int WC_RADIX_BITS = shared::kMinRadixBits;
+
+// Copy one 64-byte line from 'src' to 'dst' bypassing the cache. Both must be
+// 64-byte aligned.
+inline void stream_line(void* dst, const void* src) {
+#if defined(__AVX__)
+  const auto* s = static_cast<const __m256i*>(src);
+  auto* d = static_cast<__m256i*>(dst);
+  _mm256_stream_si256(d, _mm256_load_si256(s));
+  _mm256_stream_si256(d + 1, _mm256_load_si256(s + 1));
+#elif defined(__SSE2__)
+  const auto* s = static_cast<const __m128i*>(src);
+  auto* d = static_cast<__m128i*>(dst);
+  for (int i = 0; i < 4; ++i) {
+    _mm_stream_si128(d + i, _mm_load_si128(s + i));
+  }
+#elif defined(__aarch64__)
+  const auto* s = static_cast<const uint32_t*>(src);
+  const uint32x4_t a = vld1q_u32(s);
+  const uint32x4_t b = vld1q_u32(s + 4);
+  const uint32x4_t c = vld1q_u32(s + 8);
+  const uint32x4_t e = vld1q_u32(s + 12);
+  asm volatile(
+      "stnp %q[a], %q[b], [%[d]]\n\t"
+      "stnp %q[c], %q[e], [%[d], #32]"
+      :
+      : [a] "w"(a), [b] "w"(b), [c] "w"(c), [e] "w"(e), [d] "r"(dst)
+      : "memory");
+#else
+  std::memcpy(dst, src, CACHE_LINE);
+#endif
+}
+
+// Non-temporal stores are weakly ordered on x86, make them visible before the
+// other threads are released from the barrier.
+inline void stream_fence() {
+#if defined(__SSE2__)
+  _mm_sfence();
+#endif
+}
+
+// Writes every element straight to its destination.
+template <typename T>
+struct direct_scatter {
+  explicit direct_scatter(int) {}
+
+  void begin(T* dst, const int*, int) { out = dst; }
+
+  void store(const int pos, int, const T value) { out[pos] = value; }
+
+  void finish(const int*) {}
+
+  T* out = nullptr;
+};
+
+// Stages elements in one cache-line-sized buffer per digit and writes each
+// line out with a single non-temporal store once it is complete, instead of
+// touching every output stream element by element. The first and last line of
+// every bucket may be partial, those are copied normally. The lines are sized
+// for the widest digit of the plan, 'radix' counters.
+template <typename T>
+struct write_combining_scatter {
+  static constexpr int LINE_ITEMS = CACHE_LINE / sizeof(T);
+
+  struct alignas(CACHE_LINE) line_t {
+    T items[LINE_ITEMS];
+  };
+
+  explicit write_combining_scatter(const int radix)
+      : lines(radix), first_slot(radix) {}
+
+  void begin(T* dst, const int* bucket, const int radix) {
+    out = dst;
+    n_digits = radix;
+    for (int d = 0; d < n_digits; ++d) {
+      first_slot[d] = slot_of(bucket[d]);
+    }
+  }
+
+  void store(const int pos, const int d, const T value) {
+    const auto slot = slot_of(pos);
+    auto& staged = lines[d].items;
+    staged[slot] = value;
+    if (slot == LINE_ITEMS - 1) {
+      T* line = out + pos - slot;
+      if (first_slot[d] == 0) {
+        stream_line(line, staged);
+      } else {
+        std::copy(staged + first_slot[d],
+                  staged + LINE_ITEMS,
+                  line + first_slot[d]);
+        first_slot[d] = 0;
+      }
+    }
+  }
+
+  // 'bucket' holds the one-past-the-end position of every digit
+  void finish(const int* bucket) {
+    for (int d = 0; d < n_digits; ++d) {
+      const auto next_slot = slot_of(bucket[d]);
+      if (next_slot > first_slot[d]) {
+        std::copy(lines[d].items + first_slot[d],
+                  lines[d].items + next_slot,
+                  out + bucket[d] - (next_slot - first_slot[d]));
+      }
+    }
+    stream_fence();
+  }
+
+  [[nodiscard]] int slot_of(const int pos) const {
+    return static_cast<int>(reinterpret_cast<uintptr_t>(out + pos) %
+                            CACHE_LINE / sizeof(T));
+  }
+
+  std::vector<line_t> lines;
+  std::vector<int> first_slot;
+  int n_digits = 0;
+  T* out = nullptr;
+};
+
+// Per-call scratch of 'dispatch_parallel_radix_sort', so concurrent sorts on
+// different pipes never share state.
+template <typename Key>
+struct lsd_workspace {
+  explicit lsd_workspace(const size_t n_threads,
+                         const shared::RadixPlan& plan,
+                         const cpu::SortHints<Key>* hints)
+      : n_threads(n_threads),
+        plan(plan),
+        hints(hints),
+        radix(1 << plan.max_bits()),
+        counts(n_threads * n_threads * radix),
+        offsets(n_threads * radix),
+        range_sums(n_threads) {}
+
+  // [writer][reader][digit], number of keys with 'digit' (of the upcoming
+  // pass) that thread 'writer' scattered into the block thread 'reader' will
+  // read next. Each writer only touches its own slice.
+  [[nodiscard]] int* count_row(const size_t writer, const size_t reader) {
+    return counts.data() + (writer * n_threads + reader) * radix;
+  }
+
+  // [reader][digit], first output index of each (thread, digit) bucket
+  [[nodiscard]] int* offset_row(const size_t reader) {
+    return offsets.data() + reader * radix;
+  }
+
+  const size_t n_threads;
+  const shared::RadixPlan plan;
+  const cpu::SortHints<Key>* hints;  // optional
+  const int radix;  // counters per row, enough for the widest pass
+  std::vector<int> counts;
+  std::vector<int> offsets;
+  std::vector<int> range_sums;
+  int n_unique = 0;  // only set by 'lsd_output::kUniqueKeys'
+};
+
+// What 'k_lsd_sort' produces besides the sorted keys
+enum class lsd_output {
+  kKeys,
+  kIndices,     // the sorting permutation in 'u_vals'
+  kUniqueKeys,  // the deduplicated keys in 'u_sort_alt'
+};
+
+template <typename Key>
+struct digit_of {
+  explicit digit_of(const shared::RadixPass& pass)
+      : shift(pass.shift), mask((Key{1} << pass.bits) - 1) {}
+
+  [[nodiscard]] int operator()(const Key code) const {
+    return static_cast<int>((code >> shift) & mask);
+  }
+
+  int shift;
+  Key mask;
+};
+
+// 'u_vals'/'u_vals_alt' are only touched for 'lsd_output::kIndices'. The
+// first pass does not read 'u_vals', it scatters the source position of every
+// key.
+template <template <typename> class Scatter, lsd_output Output, typename Key>
+void k_lsd_sort(const size_t tid,
+                lsd_workspace<Key>& ws,
+                std::barrier<>& barrier,
+                const my_blocks<int>& blks,
+                Key* u_sort,
+                Key* u_sort_alt,
+                uint32_t* u_vals,
+                uint32_t* u_vals_alt) {
+  constexpr bool kWithValues = (Output == lsd_output::kIndices);
+  constexpr bool kUnique = (Output == lsd_output::kUniqueKeys);
+
+  const auto n_threads = ws.n_threads;
+  const auto& plan = ws.plan;
+  const auto begin = blks.start(tid);
+  const auto end = blks.end(tid);
+
+  const auto block_of = [&](const int pos) {
+    size_t r = 0;
+    while (r + 1 < n_threads && pos >= blks.end(r)) ++r;
+    return r;
+  };
+
+  // (1) The only standalone read pass: per-thread histogram of the first
+  // digit. Histograms of later digits are accumulated during the scatter of
+  // the previous pass, so keys are never read just to be counted again.
+  std::fill_n(ws.count_row(tid, 0), n_threads * ws.radix, 0);
+  if (ws.hints && plan.passes[0].shift == 0) {
+    // the producer already counted the lowest bits, fold them to this width
+    int* own = ws.count_row(tid, tid);
+    const int* low = ws.hints->histogram(tid);
+    const auto mask = (1 << plan.passes[0].bits) - 1;
+    for (int j = 0; j < cpu::SortHints<Key>::kBins; ++j) {
+      own[j & mask] += low[j];
+    }
+  } else {
+    int* own = ws.count_row(tid, tid);
+    const digit_of<Key> digit(plan.passes[0]);
+    std::for_each(u_sort + begin, u_sort + end, [&](const Key code) {
+      ++own[digit(code)];
+    });
+  }
+
+  barrier.arrive_and_wait();
+
+  const Key* src = u_sort;
+  Key* dst = u_sort_alt;
+  const uint32_t* src_vals = nullptr;
+  uint32_t* dst_vals = u_vals_alt;
+
+  std::vector<int> local_bucket(ws.radix);
+  std::vector<size_t> reader(ws.radix);
+  std::vector<int> boundary(ws.radix);
+
+  // track which thread reads each bucket position next
+  const auto init_readers = [&](const int radix) {
+    for (int d = 0; d < radix; ++d) {
+      reader[d] = block_of(local_bucket[d]);
+      boundary[d] = blks.end(reader[d]);
+    }
+  };
+  const auto reader_of = [&](const int d, const int pos) {
+    while (pos >= boundary[d]) {
+      boundary[d] = blks.end(++reader[d]);
+    }
+    return reader[d];
+  };
+
+  const auto keys_out = std::make_unique<Scatter<Key>>(ws.radix);
+  std::unique_ptr<Scatter<uint32_t>> vals_out;
+  if constexpr (kWithValues) {
+    vals_out = std::make_unique<Scatter<uint32_t>>(ws.radix);
+  }
+
+  for (int pass = 0; pass < plan.n_passes; ++pass) {
+    const digit_of<Key> digit(plan.passes[pass]);
+    const auto radix = 1 << plan.passes[pass].bits;
+    const bool last_pass = (pass == plan.n_passes - 1);
+
+    // each thread owns a contiguous range of digits during the scan
+    const auto digit_begin = static_cast<int>(tid * radix / n_threads);
+    const auto digit_end = static_cast<int>((tid + 1) * radix / n_threads);
+
+    // (2a) reduce [writer][reader][digit] -> [reader][digit] for the digits
+    // this thread owns, and total them
+    int range_sum = 0;
+    for (int d = digit_begin; d < digit_end; ++d) {
+      for (size_t r = 0; r < n_threads; ++r) {
+        int sum = 0;
+        for (size_t w = 0; w < n_threads; ++w) {
+          sum += ws.count_row(w, r)[d];
+        }
+        ws.offset_row(r)[d] = sum;
+        range_sum += sum;
+      }
+    }
+    ws.range_sums[tid] = range_sum;
+
+    barrier.arrive_and_wait();
+
+    // (2b) exclusive scan in (digit, thread) order. Every thread scans its own
+    // digit range starting from the totals of the ranges before it.
+    int running = 0;
+    for (size_t t = 0; t < tid; ++t) {
+      running += ws.range_sums[t];
+    }
+    for (int d = digit_begin; d < digit_end; ++d) {
+      for (size_t r = 0; r < n_threads; ++r) {
+        const auto count = ws.offset_row(r)[d];
+        ws.offset_row(r)[d] = running;
+        running += count;
+      }
+    }
+
+    barrier.arrive_and_wait();
+
+    // (3) contention-free scatter, each (thread, digit) bucket is private
+    std::copy_n(ws.offset_row(tid), radix, local_bucket.data());
+    keys_out->begin(dst, local_bucket.data(), radix);
+    if constexpr (kWithValues) {
+      vals_out->begin(dst_vals, local_bucket.data(), radix);
+    }
+
+    const auto store = [&](const int i, const int pos, const int d) {
+      keys_out->store(pos, d, src[i]);
+      if constexpr (kWithValues) {
+        vals_out->store(
+            pos, d, src_vals ? src_vals[i] : static_cast<uint32_t>(i));
+      }
+    };
+
+    if (last_pass && kUnique) {
+      // Count run heads per reader block in column 0. Within a bucket the keys
+      // arrive in order, so a key starts a run unless it equals the previous
+      // key of the same bucket. Bucket heads are fixed up below.
+      std::fill_n(ws.count_row(tid, 0), n_threads * ws.radix, 0);
+      init_readers(radix);
+
+      const int* bucket_begin = ws.offset_row(tid);
+      std::vector<Key> prev(radix);
+      for (int i = begin; i < end; ++i) {
+        const auto code = src[i];
+        const auto d = digit(code);
+        const auto pos = local_bucket[d]++;
+        store(i, pos, d);
+
+        if (pos == bucket_begin[d] || prev[d] != code) {
+          ++ws.count_row(tid, reader_of(d, pos))[0];
+        }
+        prev[d] = code;
+      }
+    } else if (last_pass) {
+      for (int i = begin; i < end; ++i) {
+        const auto d = digit(src[i]);
+        store(i, local_bucket[d]++, d);
+      }
+    } else {
+      // count the next digit, attributed to whichever thread reads the
+      // destination index in the next pass
+      std::fill_n(ws.count_row(tid, 0), n_threads * ws.radix, 0);
+      init_readers(radix);
+
+      const digit_of<Key> next_digit(plan.passes[pass + 1]);
+      for (int i = begin; i < end; ++i) {
+        const auto code = src[i];
+        const auto d = digit(code);
+        const auto pos = local_bucket[d]++;
+        store(i, pos, d);
+
+        ++ws.count_row(tid, reader_of(d, pos))[next_digit(code)];
+      }
+    }
+    keys_out->finish(local_bucket.data());
+    if constexpr (kWithValues) {
+      vals_out->finish(local_bucket.data());
+    }
+
+    barrier.arrive_and_wait();
+
+    src = dst;
+    dst = (dst == u_sort_alt) ? u_sort : u_sort_alt;
+    if constexpr (kWithValues) {
+      src_vals = dst_vals;
+      dst_vals = (dst_vals == u_vals_alt) ? u_vals : u_vals_alt;
+    }
+  }
+
+  if constexpr (kUnique) {
+    // (4) a bucket head is still a duplicate if the bucket before it (of
+    // another thread) ends with the same key
+    const auto radix = 1 << plan.passes[plan.n_passes - 1].bits;
+    const int* bucket_begin = ws.offset_row(tid);
+    for (int d = 0; d < radix; ++d) {
+      const auto pos = bucket_begin[d];
+      if (pos > 0 && pos < local_bucket[d] && src[pos - 1] == src[pos]) {
+        --ws.count_row(tid, block_of(pos))[0];
+      }
+    }
+
+    // an odd number of passes leaves the keys in 'u_sort_alt', which is where
+    // the unique keys go, so copy them back first
+    if (plan.n_passes % 2 == 1) {
+      std::copy(u_sort_alt + begin, u_sort_alt + end, u_sort + begin);
+    }
+
+    barrier.arrive_and_wait();
+
+    // (5) compacted write at the offset given by the heads of earlier blocks
+    int offset = 0;
+    int own = 0;
+    for (size_t r = 0; r <= tid; ++r) {
+      int count = 0;
+      for (size_t w = 0; w < n_threads; ++w) {
+        count += ws.count_row(w, r)[0];
+      }
+      (r == tid ? own : offset) += count;
+    }
+    if (tid == n_threads - 1) {
+      ws.n_unique = offset + own;
+    }
+
+    auto out = u_sort_alt + offset;
+    for (int i = begin; i < end; ++i) {
+      if (i == 0 || u_sort[i] != u_sort[i - 1]) *out++ = u_sort[i];
+    }
+  } else if (plan.n_passes % 2 == 1) {
+    // an odd number of passes leaves the keys in 'u_sort_alt', every thread
+    // copies its own block back
+    std::copy(u_sort_alt + begin, u_sort_alt + end, u_sort + begin);
+    if constexpr (kWithValues) {
+      std::copy(u_vals_alt + begin, u_vals_alt + end, u_vals + begin);
+    }
+  }
+}
+
+// Returns the number of unique keys for 'lsd_output::kUniqueKeys', 'n'
+// otherwise
+template <lsd_output Output, typename Pool, typename Key>
+int parallel_radix_sort(Pool& pool,
+                        const size_t n_threads,
+                        const int n,
+                        Key* u_sort,
+                        Key* u_sort_alt,
+                        uint32_t* u_vals,
+                        uint32_t* u_vals_alt,
+                        const cpu::ScatterMode mode,
+                        const cpu::SortHints<Key>* hints) {
+  const auto blks = partition_blocks(pool, 0, n, n_threads, true);
+  const auto n_blocks = blks.get_num_blocks();
+  if (n_blocks == 0) return 0;
+
+  if (hints && hints->bounds != blks.get_bounds()) hints = nullptr;
+
+  // Plan the passes from the bits that actually vary across the keys
+  std::vector<Key> and_bits(n_blocks);
+  std::vector<Key> or_bits(n_blocks);
+  if (hints) {
+    and_bits = hints->and_bits;
+    or_bits = hints->or_bits;
+  } else {
+    run_blocks(
+        pool, blks, [&](const size_t blk, const int start, const int end) {
+          Key all = ~Key{0};
+          Key any = 0;
+          std::for_each(u_sort + start, u_sort + end, [&](const Key code) {
+                all &= code;
+                any |= code;
+              });
+          and_bits[blk] = all;
+          or_bits[blk] = any;
+        });
+  }
+
+  const auto plan = shared::make_radix_plan(
+      std::reduce(and_bits.begin(), and_bits.end(), ~Key{0}, std::bit_and{}),
+      std::reduce(or_bits.begin(), or_bits.end(), Key{0}, std::bit_or{}),
+      mode == cpu::ScatterMode::kWriteCombining ? WC_RADIX_BITS
+                                                : shared::kMaxRadixBits);
+
+  // every key is the same, already sorted
+  if (plan.n_passes == 0) {
+    if constexpr (Output == lsd_output::kIndices) {
+      std::iota(u_vals, u_vals + n, 0u);
+    } else if constexpr (Output == lsd_output::kUniqueKeys) {
+      u_sort_alt[0] = u_sort[0];
+      return 1;
+    }
+    return n;
+  }
+
+  lsd_workspace<Key> ws(n_blocks, plan, hints);
+  std::barrier barrier(static_cast<std::ptrdiff_t>(n_blocks));
+
+  core::multi_future<void> future;
+  future.futures.reserve(n_blocks);
+
+  // every task is one block of the passes, the one its worker is sized for
+  block_claims claims(n_blocks);
+  for (size_t i = 0; i < n_blocks; ++i) {
+    future.futures.push_back(pool.submit_task([&] {
+      const auto blk = claims.claim(pool);
+      if (mode == cpu::ScatterMode::kWriteCombining) {
+        k_lsd_sort<write_combining_scatter, Output>(
+            blk, ws, barrier, blks, u_sort, u_sort_alt, u_vals, u_vals_alt);
+      } else {
+        k_lsd_sort<direct_scatter, Output>(
+            blk, ws, barrier, blks, u_sort, u_sort_alt, u_vals, u_vals_alt);
+      }
+    }));
+  }
+
+  future.wait();
+
+  return (Output == lsd_output::kUniqueKeys) ? ws.n_unique : n;
+}
+
+}  // namespace
+
+template <typename Pool, typename Key>
+void cpu::dispatch_parallel_radix_sort(Pool& pool,
+                                       const size_t n_threads,
+                                       const int n,
+                                       Key* u_sort,
+                                       Key* u_sort_alt,
+                                       const ScatterMode mode) {
+  parallel_radix_sort<lsd_output::kKeys>(pool,
+                                         n_threads,
+                                         n,
+                                         u_sort,
+                                         u_sort_alt,
+                                         nullptr,
+                                         nullptr,
+                                         mode,
+                                         static_cast<SortHints<Key>*>(nullptr));
+}
+
+template <typename Pool, typename Key>
+void cpu::dispatch_parallel_radix_sort_kv(Pool& pool,
+                                          const size_t n_threads,
+                                          const int n,
+                                          Key* u_sort,
+                                          Key* u_sort_alt,
+                                          uint32_t* u_index,
+                                          uint32_t* u_index_alt,
+                                          const ScatterMode mode) {
+  parallel_radix_sort<lsd_output::kIndices>(
+      pool,
+      n_threads,
+      n,
+      u_sort,
+      u_sort_alt,
+      u_index,
+      u_index_alt,
+      mode,
+      static_cast<SortHints<Key>*>(nullptr));
+}
+
+template <typename Pool, typename Key>
+int cpu::dispatch_parallel_radix_sort_unique(Pool& pool,
+                                             const size_t n_threads,
+                                             const int n,
+                                             Key* u_sort,
+                                             Key* u_sort_alt,
+                                             const ScatterMode mode,
+                                             const SortHints<Key>* hints) {
+  return parallel_radix_sort<lsd_output::kUniqueKeys>(
+      pool, n_threads, n, u_sort, u_sort_alt, nullptr, nullptr, mode, hints);
+}
+
+#define INSTANTIATE_KEY_SORT(POOL, KEY)                                       \
+  template void cpu::dispatch_parallel_radix_sort(                            \
+      POOL& pool,                                                             \
+      const size_t n_threads,                                                 \
+      const int n,                                                            \
+      KEY* u_sort,                                                            \
+      KEY* u_sort_alt,                                                        \
+      const ScatterMode mode);                                                \
+  template void cpu::dispatch_parallel_radix_sort_kv(                         \
+      POOL& pool,                                                             \
+      const size_t n_threads,                                                 \
+      const int n,                                                            \
+      KEY* u_sort,                                                            \
+      KEY* u_sort_alt,                                                        \
+      uint32_t* u_index,                                                      \
+      uint32_t* u_index_alt,                                                  \
+      const ScatterMode mode);                                                \
+  template int cpu::dispatch_parallel_radix_sort_unique(                      \
+      POOL& pool,                                                             \
+      const size_t n_threads,                                                 \
+      const int n,                                                            \
+      KEY* u_sort,                                                            \
+      KEY* u_sort_alt,                                                        \
+      const ScatterMode mode,                                                 \
+      const SortHints<KEY>* hints);
+
+#define INSTANTIATE_SORT(POOL)                                                \
+  template core::multi_future<void> cpu::dispatch_binning_pass(               \
+      POOL& pool,                                                             \
+      const size_t n_threads,                                                 \
+      std::barrier<>& barrier,                                                \
+      const int n,                                                            \
+      const morton_t* u_sort,                                                 \
+      morton_t* u_sort_alt,                                                   \
+      const int shift);                                                       \
+  INSTANTIATE_KEY_SORT(POOL, morton_t)                                        \
+  INSTANTIATE_KEY_SORT(POOL, morton64_t)
+
+INSTANTIATE_SORT(core::thread_pool)
+INSTANTIATE_SORT(core::work_stealing_pool)
+INSTANTIATE_SORT(BS::thread_pool)
+
+#undef INSTANTIATE_SORT
+#undef INSTANTIATE_KEY_SORT
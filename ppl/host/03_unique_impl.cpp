@@ -0,0 +1,68 @@
+#include "host/03_unique_impl.hpp"
+
+#include <numeric>
+#include <vector>
+
+#include "block.hpp"
+#include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "third-party/BS_thread_pool.hpp"
+
+template <typename Pool, typename Key>
+int cpu::dispatch_parallel_unique(Pool& pool,
+                                  const size_t n_threads,
+                                  const int n,
+                                  const Key* u_sorted,
+                                  Key* u_unique,
+                                  int* u_flag_heads) {
+  const auto blks = partition_blocks(pool, 0, n, n_threads);
+  const auto n_blocks = blks.get_num_blocks();
+  if (n_blocks == 0) return 0;
+
+  // (1) flag the first key of every run and count the flags per block
+  std::vector<int> block_counts(n_blocks);
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    int count = 0;
+    for (int i = start; i < end; ++i) {
+      const int head = (i == 0 || u_sorted[i] != u_sorted[i - 1]);
+      u_flag_heads[i] = head;
+      count += head;
+    }
+    block_counts[blk] = count;
+  });
+
+  // (2) scan of the block counts, only 'n_blocks' elements
+  std::vector<int> block_offsets(n_blocks);
+  std::exclusive_scan(
+      block_counts.begin(), block_counts.end(), block_offsets.begin(), 0);
+
+  // (3) compacted write
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    auto out = u_unique + block_offsets[blk];
+    for (int i = start; i < end; ++i) {
+      if (u_flag_heads[i]) *out++ = u_sorted[i];
+    }
+  });
+
+  return block_offsets.back() + block_counts.back();
+}
+
+#define INSTANTIATE_KEY_UNIQUE(POOL, KEY)         \
+  template int cpu::dispatch_parallel_unique(     \
+      POOL& pool,                                 \
+      const size_t n_threads,                     \
+      const int n,                                \
+      const KEY* u_sorted,                        \
+      KEY* u_unique,                              \
+      int* u_flag_heads);
+
+#define INSTANTIATE_UNIQUE(POOL)                  \
+  INSTANTIATE_KEY_UNIQUE(POOL, morton_t)          \
+  INSTANTIATE_KEY_UNIQUE(POOL, morton64_t)
+
+INSTANTIATE_UNIQUE(core::thread_pool)
+INSTANTIATE_UNIQUE(core::work_stealing_pool)
+INSTANTIATE_UNIQUE(BS::thread_pool)
+
+#undef INSTANTIATE_UNIQUE
+#undef INSTANTIATE_KEY_UNIQUE
@@ -0,0 +1,183 @@
+#include "host/06_scan_impl.hpp"
+
+#include <numeric>
+#include <vector>
+
+#include "block.hpp"
+#include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "third-party/BS_thread_pool.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// ----------------------------------------------------------------------------
+// Inner loops
+// ----------------------------------------------------------------------------
+
+[[nodiscard]] int reduce_range(const int* in, const int n) {
+  int i = 0;
+  int sum = 0;
+
+#if defined(__AVX2__)
+  auto acc = _mm256_setzero_si256();
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_add_epi32(
+        acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+  }
+  auto acc4 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, 0x4E));
+  acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, 0xB1));
+  sum = _mm_cvtsi128_si32(acc4);
+#elif defined(__SSE2__)
+  auto acc = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm_add_epi32(
+        acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+  sum = _mm_cvtsi128_si32(acc);
+#elif defined(__aarch64__)
+  auto acc = vdupq_n_s32(0);
+  for (; i + 4 <= n; i += 4) {
+    acc = vaddq_s32(acc, vld1q_s32(in + i));
+  }
+  sum = vaddvq_s32(acc);
+#endif
+
+  for (; i < n; ++i) {
+    sum += in[i];
+  }
+  return sum;
+}
+
+// Inclusive scan of 'in[0, n)' into 'out' starting from 'carry', returns the
+// last value. The vector paths scan within a register with shifted adds and
+// carry the running total across registers.
+[[nodiscard]] int scan_range(const int* in, int* out, const int n, int carry) {
+  int i = 0;
+
+#if defined(__AVX2__)
+  auto running = _mm256_set1_epi32(carry);
+  for (; i + 8 <= n; i += 8) {
+    auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    // scan each 128-bit lane, then add the low lane's total to the high lane
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    const auto low_total = _mm256_shuffle_epi32(x, 0xFF);
+    x = _mm256_add_epi32(
+        x, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+    x = _mm256_add_epi32(x, running);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+    running = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+  }
+  carry = _mm256_cvtsi256_si32(running);
+#elif defined(__SSE2__)
+  auto running = _mm_set1_epi32(carry);
+  for (; i + 4 <= n; i += 4) {
+    auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi32(x, running);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+    running = _mm_shuffle_epi32(x, 0xFF);
+  }
+  carry = _mm_cvtsi128_si32(running);
+#elif defined(__aarch64__)
+  const auto zero = vdupq_n_s32(0);
+  auto running = vdupq_n_s32(carry);
+  for (; i + 4 <= n; i += 4) {
+    auto x = vld1q_s32(in + i);
+    x = vaddq_s32(x, vextq_s32(zero, x, 3));
+    x = vaddq_s32(x, vextq_s32(zero, x, 2));
+    x = vaddq_s32(x, running);
+    vst1q_s32(out + i, x);
+    running = vdupq_laneq_s32(x, 3);
+  }
+  carry = vgetq_lane_s32(running, 0);
+#endif
+
+  for (; i < n; ++i) {
+    carry += in[i];
+    out[i] = carry;
+  }
+  return carry;
+}
+
+}  // namespace
+
+// ----------------------------------------------------------------------------
+// Dispatchers
+// ----------------------------------------------------------------------------
+
+template <typename Pool>
+int cpu::dispatch_scan_with_block_sums(Pool& pool,
+                                       const size_t n_threads,
+                                       const int n,
+                                       const int* u_in,
+                                       int* u_out,
+                                       const int* block_sums) {
+  const auto blks = partition_blocks(pool, 0, n, n_threads);
+  const auto n_blocks = blks.get_num_blocks();
+  if (n_blocks == 0) return 0;
+
+  // (2) scan of the partials, only 'n_blocks' elements
+  std::vector<int> block_offsets(n_blocks);
+  std::exclusive_scan(
+      block_sums, block_sums + n_blocks, block_offsets.begin(), 0);
+
+  // (3) downsweep, every block scans its range from its offset
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    (void)scan_range(
+        u_in + start, u_out + start, end - start, block_offsets[blk]);
+  });
+
+  return block_offsets.back() + block_sums[n_blocks - 1];
+}
+
+template <typename Pool>
+int cpu::dispatch_parallel_inclusive_scan(Pool& pool,
+                                          const size_t n_threads,
+                                          const int n,
+                                          const int* u_in,
+                                          int* u_out) {
+  const auto blks = partition_blocks(pool, 0, n, n_threads);
+  if (blks.get_num_blocks() == 0) return 0;
+
+  // (1) reduce
+  std::vector<int> block_sums(blks.get_num_blocks());
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    block_sums[blk] = reduce_range(u_in + start, end - start);
+  });
+
+  return dispatch_scan_with_block_sums(
+      pool, n_threads, n, u_in, u_out, block_sums.data());
+}
+
+#define INSTANTIATE_SCAN(POOL)                            \
+  template int cpu::dispatch_parallel_inclusive_scan(     \
+      POOL& pool,                                         \
+      const size_t n_threads,                             \
+      const int n,                                        \
+      const int* u_in,                                    \
+      int* u_out);                                        \
+  template int cpu::dispatch_scan_with_block_sums(        \
+      POOL& pool,                                         \
+      const size_t n_threads,                             \
+      const int n,                                        \
+      const int* u_in,                                    \
+      int* u_out,                                         \
+      const int* block_sums);
+
+INSTANTIATE_SCAN(core::thread_pool)
+INSTANTIATE_SCAN(core::work_stealing_pool)
+INSTANTIATE_SCAN(BS::thread_pool)
+
+#undef INSTANTIATE_SCAN
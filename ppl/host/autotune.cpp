@@ -0,0 +1,140 @@
+#include "host/autotune.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace cpu {
+
+// One line per device:
+//   <device id> <n clusters> <threads of each cluster> <cluster>:<threads>...
+// with one '<cluster>:<threads>' per 'FusedPhase'.
+
+PipelineTuner::PipelineTuner(std::string device_id,
+                             std::vector<int> cluster_threads,
+                             std::string path,
+                             const int frames_per_candidate)
+    : device_id_(std::move(device_id)),
+      cluster_threads_(std::move(cluster_threads)),
+      path_(std::move(path)),
+      frames_per_candidate_(std::max(frames_per_candidate, 1)) {
+  if (cluster_threads_.empty()) {
+    throw std::invalid_argument("PipelineTuner needs at least one cluster");
+  }
+
+  for (int c = 0; c < static_cast<int>(cluster_threads_.size()); ++c) {
+    const int n = cluster_threads_[c];
+    for (int t = 1; t < n; t *= 2) {
+      candidates_.push_back({c, t});
+    }
+    if (n > 0) candidates_.push_back({c, n});
+  }
+  if (candidates_.empty()) {
+    throw std::invalid_argument("PipelineTuner needs a cluster with threads");
+  }
+
+  best_ms_.resize(candidates_.size());
+  for (auto& ms : best_ms_) {
+    ms.fill(std::numeric_limits<double>::infinity());
+  }
+
+  tuned_ = load();
+  if (!tuned_) plan_.fill(candidates_.front());
+}
+
+void PipelineTuner::record(const PipelineTimings& t) {
+  if (tuned_) return;
+
+  const auto candidate = frame_ / frames_per_candidate_;
+  for (int phase = 0; phase < kNumFusedPhases; ++phase) {
+    auto& best = best_ms_[candidate][phase];
+    best = std::min(best, phase_ms(t, static_cast<FusedPhase>(phase)));
+  }
+
+  ++frame_;
+  const auto next = frame_ / frames_per_candidate_;
+  if (next < static_cast<int>(candidates_.size())) {
+    plan_.fill(candidates_[next]);
+    return;
+  }
+
+  // every phase on its fastest candidate
+  for (int phase = 0; phase < kNumFusedPhases; ++phase) {
+    size_t fastest = 0;
+    for (size_t c = 1; c < candidates_.size(); ++c) {
+      if (best_ms_[c][phase] < best_ms_[fastest][phase]) fastest = c;
+    }
+    plan_[phase] = candidates_[fastest];
+  }
+  tuned_ = true;
+  save();
+}
+
+bool PipelineTuner::load() {
+  std::ifstream file(path_);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream in(line);
+    std::string device;
+    size_t n_clusters = 0;
+    if (!(in >> device >> n_clusters) || device != device_id_ ||
+        n_clusters != cluster_threads_.size()) {
+      continue;
+    }
+
+    bool same_clusters = true;
+    for (const int threads : cluster_threads_) {
+      int saved = 0;
+      in >> saved;
+      same_clusters = same_clusters && saved == threads;
+    }
+    if (!in || !same_clusters) continue;
+
+    PipelinePlan plan;
+    for (auto& [cluster, threads] : plan) {
+      char colon = 0;
+      in >> cluster >> colon >> threads;
+      if (!in || colon != ':' || cluster < 0 ||
+          cluster >= static_cast<int>(cluster_threads_.size()) ||
+          threads < 1 || threads > cluster_threads_[cluster]) {
+        return false;
+      }
+    }
+    plan_ = plan;
+    return true;
+  }
+  return false;
+}
+
+void PipelineTuner::save() const {
+  // keep the other devices
+  std::vector<std::string> lines;
+  {
+    std::ifstream file(path_);
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream in(line);
+      std::string device;
+      if (in >> device && device != device_id_) lines.push_back(line);
+    }
+  }
+
+  std::ostringstream entry;
+  entry << device_id_ << ' ' << cluster_threads_.size();
+  for (const int threads : cluster_threads_) {
+    entry << ' ' << threads;
+  }
+  for (const auto& [cluster, threads] : plan_) {
+    entry << ' ' << cluster << ':' << threads;
+  }
+  lines.push_back(entry.str());
+
+  std::ofstream file(path_, std::ios::trunc);
+  for (const auto& line : lines) {
+    file << line << '\n';
+  }
+}
+
+}  // namespace cpu
@@ -3,7 +3,15 @@
 // this is from the BS::thread_pool library.
 // A helper class to divide a range into blocks.
 
+#include <atomic>
 #include <cstddef>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "core/thread_pool.hpp"
+#include "core/trace.hpp"
 
 template <typename T>
 class [[nodiscard]] my_blocks {
@@ -36,6 +44,17 @@ class [[nodiscard]] my_blocks {
     }
   }
 
+  /**
+   * @brief Construct a `blocks` object from explicit block bounds.
+   *
+   * @param bounds_ Block i is [bounds_[i], bounds_[i + 1]).
+   */
+  explicit my_blocks(std::vector<T> bounds_)
+      : first_index(bounds_.front()),
+        index_after_last(bounds_.back()),
+        num_blocks(bounds_.size() - 1),
+        bounds(std::move(bounds_)) {}
+
   /**
    * @brief Get the first index of a block.
    *
@@ -43,6 +62,7 @@ class [[nodiscard]] my_blocks {
    * @return The first index.
    */
   [[nodiscard]] T start(const size_t block) const {
+    if (!bounds.empty()) return bounds[block];
     return first_index + static_cast<T>(block * block_size) +
            static_cast<T>(block < remainder ? block : remainder);
   }
@@ -65,6 +85,19 @@ class [[nodiscard]] my_blocks {
    */
   [[nodiscard]] size_t get_num_blocks() const { return num_blocks; }
 
+  /**
+   * @brief Get the bounds of all blocks, block i is [bounds[i], bounds[i + 1]).
+   *
+   * @return The bounds.
+   */
+  [[nodiscard]] std::vector<T> get_bounds() const {
+    std::vector<T> result(num_blocks + 1, first_index);
+    for (size_t blk = 0; blk < num_blocks; ++blk) {
+      result[blk + 1] = end(blk);
+    }
+    return result;
+  }
+
  private:
   /**
    * @brief The size of each block (except possibly the last block).
@@ -91,4 +124,114 @@ class [[nodiscard]] my_blocks {
    * of blocks.
    */
   size_t remainder = 0;
+
+  /**
+   * @brief The explicit block bounds, empty for equal blocks.
+   */
+  std::vector<T> bounds;
 };  // class blocks
+
+/**
+ * @brief The blocks of [first_index, index_after_last) for 'num_blocks'
+ * workers, cut the way 'pool' partitions 'submit_blocks' (see
+ * 'core::thread_pool::partition'): one block per worker sized by its weight
+ * under kWeighted, 'dynamic_chunks_per_task' times more, smaller blocks that
+ * the workers take as they free up under kDynamic. Other pools cut equal
+ * blocks. The same arguments give the same blocks, so stages that keep
+ * per-block partial results across passes can cut their range again.
+ *
+ * @param cooperative The blocks of the stage wait for each other (a barrier),
+ * so there must not be more of them than workers: kDynamic keeps equal blocks.
+ */
+template <typename Pool, typename T>
+[[nodiscard]] my_blocks<T> partition_blocks(const Pool& pool,
+                                            const T first_index,
+                                            const T index_after_last,
+                                            const size_t num_blocks,
+                                            const bool cooperative = false) {
+  if constexpr (std::is_same_v<Pool, core::thread_pool>) {
+    using partition = core::thread_pool::partition;
+    const auto size = static_cast<size_t>(index_after_last - first_index);
+    const auto& weights = pool.get_worker_weights();
+    if (pool.get_partition() == partition::kWeighted &&
+        size >= weights.size()) {
+      return my_blocks<T>(core::thread_pool::weighted_bounds(
+          first_index, index_after_last, weights));
+    }
+    if (pool.get_partition() == partition::kDynamic && !cooperative) {
+      return my_blocks<T>(
+          first_index,
+          index_after_last,
+          num_blocks * core::thread_pool::dynamic_chunks_per_task);
+    }
+  }
+  return my_blocks<T>(first_index, index_after_last, num_blocks);
+}
+
+/**
+ * @brief Hands each task of a batch one block. On a weighted
+ * 'core::thread_pool' a task takes the block of the worker it runs on, whose
+ * size matches that worker's weight, or the first one left; otherwise the
+ * blocks go in order.
+ */
+class block_claims {
+ public:
+  explicit block_claims(const size_t n_blocks)
+      : n_blocks_(n_blocks), taken_(new std::atomic<bool>[n_blocks] {}) {}
+
+  template <typename Pool>
+  [[nodiscard]] size_t claim(const Pool& pool) {
+    if constexpr (std::is_same_v<Pool, core::thread_pool>) {
+      if (pool.get_partition() == core::thread_pool::partition::kWeighted) {
+        auto blk = pool.this_worker();
+        if (blk >= n_blocks_ || taken_[blk].exchange(true)) {
+          blk = 0;
+          while (taken_[blk].exchange(true)) ++blk;
+        }
+        return blk;
+      }
+    }
+    return next_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  size_t n_blocks_;
+  std::unique_ptr<std::atomic<bool>[]> taken_;
+  std::atomic<size_t> next_{0};
+};
+
+/**
+ * @brief Run 'f(block, start, end)' for every block of 'blks' as one task on
+ * 'pool' and wait for all of them. Unlike 'submit_blocks', the task knows its
+ * block number, which is what per-block partial results are indexed by. Cut
+ * 'blks' with 'partition_blocks' to follow the pool's partition.
+ *
+ * @param pool Any pool with a 'submit_task' returning std::future<void>.
+ * @param blks The partition of the range.
+ * @param f The function to run on each block.
+ */
+template <typename Pool, typename T, typename F>
+void run_blocks(Pool& pool, const my_blocks<T>& blks, F&& f) {
+  std::vector<std::future<void>> futures;
+  futures.reserve(blks.get_num_blocks());
+
+  // labeled here, with the stage of the submitting thread
+  std::vector<core::trace::block_label> labels;
+  labels.reserve(blks.get_num_blocks());
+  for (size_t blk = 0; blk < blks.get_num_blocks(); ++blk) {
+    labels.emplace_back(blk);
+  }
+
+  block_claims claims(blks.get_num_blocks());
+  for (size_t i = 0; i < blks.get_num_blocks(); ++i) {
+    futures.push_back(pool.submit_task([&f, &blks, &claims, &labels, &pool] {
+      const auto blk = claims.claim(pool);
+      const core::trace::scope scope(labels[blk]);
+      f(blk, blks.start(blk), blks.end(blk));
+    }));
+  }
+
+  for (auto& future : futures) {
+    future.wait();
+  }
+}
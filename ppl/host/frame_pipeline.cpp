@@ -0,0 +1,163 @@
+#include "host/frame_pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "core/bounded_queue.hpp"
+#include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "host/host_dispatcher.hpp"
+#include "third-party/BS_thread_pool.hpp"
+
+namespace cpu {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// a frame between the two halves, in pipe 'pipes[pipe]'
+struct InFlight {
+  int pipe;
+  int frame;
+  clock::time_point start;
+};
+
+// The first exception of either half, which closes both queues
+class FirstError {
+ public:
+  template <typename F>
+  void run(F&& f,
+           core::bounded_queue<int>& free_pipes,
+           core::bounded_queue<InFlight>& sorted) {
+    try {
+      f();
+    } catch (...) {
+      {
+        std::lock_guard lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+      }
+      free_pipes.close();
+      sorted.close();
+    }
+  }
+
+  void rethrow() const {
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::exception_ptr error_;
+};
+
+}  // namespace
+
+template <typename Pool>
+FrameStats run_frame_pipeline(
+    const StageCluster<Pool> front,
+    const StageCluster<Pool> back,
+    const std::span<const std::shared_ptr<Pipe>> pipes,
+    const int n_frames,
+    const FillFrame& fill,
+    const ConsumeFrame& consume) {
+  const auto k = static_cast<int>(pipes.size());
+  FrameStats stats;
+  if (k == 0 || n_frames <= 0) return stats;
+
+  core::bounded_queue<int> free_pipes(k);
+  core::bounded_queue<InFlight> sorted(k);
+  for (int i = 0; i < k; ++i) {
+    free_pipes.push(i);
+  }
+
+  FirstError error;
+  std::vector<clock::time_point> done(n_frames);
+  stats.latency_ms.resize(n_frames);
+  const auto begin = clock::now();
+
+  std::thread front_thread([&] {
+    error.run(
+        [&] {
+          for (int frame = 0; frame < n_frames; ++frame) {
+            const auto pipe = free_pipes.pop();
+            if (!pipe) return;
+            const auto start = clock::now();
+            const auto& p = pipes[*pipe];
+            fill(*p, frame);
+            dispatch_MortonCode(front.pool, front.num_threads, p);
+            dispatch_RadixSortAndRemoveDuplicates(
+                front.pool, front.num_threads, p);
+            if (!sorted.push({*pipe, frame, start})) return;
+          }
+        },
+        free_pipes,
+        sorted);
+  });
+
+  error.run(
+      [&] {
+        for (int frame = 0; frame < n_frames; ++frame) {
+          const auto item = sorted.pop();
+          if (!item) return;
+          const auto& p = pipes[item->pipe];
+          dispatch_BuildRadixTree(back.pool, back.num_threads, p);
+          dispatch_EdgeCountAndOffset(back.pool, back.num_threads, p);
+          dispatch_BuildOctree(back.pool, back.num_threads, p);
+          if (consume) consume(*p, item->frame);
+
+          const auto now = clock::now();
+          const std::chrono::duration<double, std::milli> latency =
+              now - item->start;
+          done[item->frame] = now;
+          stats.latency_ms[item->frame] = latency.count();
+          free_pipes.push(item->pipe);
+        }
+      },
+      free_pipes,
+      sorted);
+
+  front_thread.join();
+  error.rethrow();
+
+  stats.n_frames = n_frames;
+  stats.mean_latency_ms =
+      std::accumulate(stats.latency_ms.begin(), stats.latency_ms.end(), 0.0) /
+      n_frames;
+  stats.max_latency_ms =
+      *std::max_element(stats.latency_ms.begin(), stats.latency_ms.end());
+
+  // steady state: skip the frames that only fill the pipeline, if there are
+  // more than those
+  const auto steady_frames = n_frames > k ? n_frames - k : n_frames;
+  const std::chrono::duration<double> steady =
+      done[n_frames - 1] - (n_frames > k ? done[k - 1] : begin);
+  if (steady.count() > 0.0) {
+    stats.frames_per_sec = steady_frames / steady.count();
+  }
+  return stats;
+}
+
+// ----------------------------------------------------------------------------
+// Explicit instantiations
+// ----------------------------------------------------------------------------
+
+#define INSTANTIATE_FRAME_PIPELINE(POOL)                                       \
+  template FrameStats run_frame_pipeline(                                      \
+      StageCluster<POOL>,                                                      \
+      StageCluster<POOL>,                                                      \
+      std::span<const std::shared_ptr<Pipe>>,                                  \
+      int,                                                                     \
+      const FillFrame&,                                                        \
+      const ConsumeFrame&);
+
+INSTANTIATE_FRAME_PIPELINE(core::thread_pool)
+INSTANTIATE_FRAME_PIPELINE(core::work_stealing_pool)
+INSTANTIATE_FRAME_PIPELINE(BS::thread_pool)
+
+#undef INSTANTIATE_FRAME_PIPELINE
+
+}  // namespace cpu
@@ -0,0 +1,154 @@
+#include "host/fused_pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "block.hpp"
+#include "core/trace.hpp"
+#include "core/work_stealing_pool.hpp"
+#include "host/01_morton_impl.hpp"
+#include "host/02_sort_impl.hpp"
+#include "host/host_dispatcher.hpp"
+#include "third-party/BS_thread_pool.hpp"
+
+namespace cpu {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+[[nodiscard]] double ms_since(clock::time_point& last) {
+  const auto now = clock::now();
+  const std::chrono::duration<double, std::milli> elapsed = now - last;
+  last = now;
+  return elapsed.count();
+}
+
+}  // namespace
+
+template <typename Pool>
+void run_fused_pipeline(Pool& pool,
+                        const int num_threads,
+                        const std::shared_ptr<Pipe>& p,
+                        PipelineTimings* timings) {
+  Pool* const clusters[] = {&pool};
+  PipelinePlan plan;
+  plan.fill({0, num_threads});
+  run_fused_pipeline(std::span<Pool* const>(clusters), plan, p, timings);
+}
+
+template <typename Pool>
+void run_fused_pipeline(const std::span<Pool* const> clusters,
+                        const PipelinePlan& plan,
+                        const std::shared_ptr<Pipe>& p,
+                        PipelineTimings* timings) {
+  const auto on = [&](const FusedPhase phase) -> Pool& {
+    return *clusters[plan[static_cast<int>(phase)].cluster];
+  };
+  const auto threads = [&](const FusedPhase phase) {
+    return plan[static_cast<int>(phase)].num_threads;
+  };
+
+  // The whole frame. The fused phases label their blocks with this scope,
+  // the staged calls (bounds, radix tree, edges, octree) with their own.
+  PPL_TRACE_SCOPE("FusedPipeline");
+
+  PipelineTimings t;
+  const auto start = clock::now();
+  auto last = start;
+
+  // (1) Morton codes, after the bounds they are quantized to. The block that
+  // just wrote its codes also folds them into the sort hints while they are
+  // still in L1, which saves the sort its planning scan and its first
+  // histogram pass. The SIMD encoder writes one tile at a time, so the fold
+  // still reads the codes from L1.
+  constexpr int kTile = 2048;
+  auto& pool = on(FusedPhase::kMorton);
+  const auto num_threads = threads(FusedPhase::kMorton);
+  dispatch_ComputeBounds(pool, num_threads, p);
+  // cut as the sort cuts its blocks, or it could not take the hints
+  const auto blks = partition_blocks(pool, 0, p->n_input(), num_threads, true);
+  SortHints<morton_t> hints(blks.get_bounds());
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    for (int tile = start; tile < end; tile += kTile) {
+      const auto tile_end = std::min(tile + kTile, end);
+      encode_morton32(*p, tile, tile_end);
+      for (int i = tile; i < tile_end; ++i) {
+        hints.add(blk, p->u_morton[i]);
+      }
+    }
+  });
+  t.morton_ms = ms_since(last);
+
+  // (2) Sort + unique. The unique keys end up in 'u_morton_alt'.
+  const auto n_unique =
+      dispatch_parallel_radix_sort_unique(on(FusedPhase::kSortUnique),
+                                          threads(FusedPhase::kSortUnique),
+                                          p->n_input(),
+                                          p->u_morton,
+                                          p->u_morton_alt,
+                                          ScatterMode::kDirect,
+                                          &hints);
+  p->set_n_unique(n_unique);
+  t.sort_unique_ms = ms_since(last);
+
+  const auto finish = [&] {
+    t.total_ms =
+        std::chrono::duration<double, std::milli>(last - start).count();
+    if (timings) *timings = t;
+  };
+
+  // an empty or single-key frame has no radix tree, hence no octree
+  if (n_unique <= 1) {
+    p->brt.set_n_nodes(0);
+    p->oct.set_n_nodes(0);
+    finish();
+    return;
+  }
+  p->brt.set_n_nodes(n_unique - 1);
+
+  // (3)-(5) in the layout the pipe's radix tree is allocated in
+  const auto tree_to_octree = [&]<shared::BrtLayout Layout>() {
+    // (3) Radix tree
+    dispatch_BuildRadixTree<Layout>(
+        on(FusedPhase::kRadixTree), threads(FusedPhase::kRadixTree), p);
+    t.radix_tree_ms = ms_since(last);
+
+    // (4) Edge count fused with the partial reduce of the offset scan
+    dispatch_EdgeCountAndOffset<Layout>(
+        on(FusedPhase::kEdge), threads(FusedPhase::kEdge), p);
+    t.edge_ms = ms_since(last);
+
+    // (5) Octree
+    dispatch_BuildOctree<Layout>(
+        on(FusedPhase::kOctree), threads(FusedPhase::kOctree), p);
+    t.octree_ms = ms_since(last);
+  };
+  if (p->brt.layout == shared::BrtLayout::kPacked) {
+    tree_to_octree.template operator()<shared::BrtLayout::kPacked>();
+  } else {
+    tree_to_octree.template operator()<shared::BrtLayout::kSoA>();
+  }
+
+  finish();
+}
+
+// ----------------------------------------------------------------------------
+// Explicit instantiations
+// ----------------------------------------------------------------------------
+
+#define INSTANTIATE_FUSED_PIPELINE(POOL)                                       \
+  template void run_fused_pipeline(                                            \
+      POOL&, int, const std::shared_ptr<Pipe>&, PipelineTimings*);             \
+  template void run_fused_pipeline(std::span<POOL* const>,                     \
+                                   const PipelinePlan&,                        \
+                                   const std::shared_ptr<Pipe>&,               \
+                                   PipelineTimings*);
+
+INSTANTIATE_FUSED_PIPELINE(core::thread_pool)
+INSTANTIATE_FUSED_PIPELINE(core::work_stealing_pool)
+INSTANTIATE_FUSED_PIPELINE(BS::thread_pool)
+
+#undef INSTANTIATE_FUSED_PIPELINE
+
+}  // namespace cpu
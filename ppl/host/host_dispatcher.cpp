@@ -1,112 +1,322 @@
 #include "host/host_dispatcher.hpp"
 
+#include <algorithm>
 #include <barrier>
 #include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
+#include "block.hpp"
+#include "core/trace.hpp"
+#include "host/00_bounds_impl.hpp"
+#include "host/01_morton_impl.hpp"
 #include "host/02_sort_impl.hpp"
+#include "host/03_unique_impl.hpp"
+#include "host/06_scan_impl.hpp"
 #include "host/brt_func.hpp"
 #include "shared/edge_func.h"
 #include "shared/oct_func.h"
 
 namespace cpu {
 
-void dispatch_MortonCode(core::thread_pool& pool,
-                         int num_threads,
-                         const std::shared_ptr<const Pipe>& p) {
+namespace {
+
+// The stages, written once for both key widths. The 'dispatch_*' overloads
+// below forward to them: a 'std::shared_ptr<Pipe>' argument converts to the
+// 'const' pipe the overloads take, but would not deduce 'Key' here.
+
+// Zeroes every per-point array in the blocks the stages use, so with the
+// usual first-touch policy each page lands on the node of its worker
+template <typename Pool, typename Key>
+void first_touch(Pool& pool,
+                 int num_threads,
+                 const std::shared_ptr<BasicPipe<Key>>& p) {
+  const auto blks =
+      partition_blocks(pool, 0, static_cast<int>(p->capacity), num_threads);
+  run_blocks(pool, blks, [&](size_t, const int start, const int end) {
+    const auto touch = [start, end](auto* array) {
+      using T = std::remove_pointer_t<decltype(array)>;
+      if (array != nullptr) std::fill(array + start, array + end, T{});
+    };
+    touch(p->u_points);
+    touch(p->u_morton);
+    touch(p->u_morton_alt);
+    touch(p->u_edge_counts);
+    touch(p->u_edge_offsets);
+    touch(p->im_storage.u_flag_heads);
+    touch(p->u_point_index);
+    touch(p->u_point_index_alt);
+    touch(p->u_points_sorted);
+    touch(p->u_xs);
+    touch(p->u_ys);
+    touch(p->u_zs);
+    touch(p->u_points3);
+    touch(p->brt.u_prefix_n);
+    touch(p->brt.u_has_leaf_left);
+    touch(p->brt.u_has_leaf_right);
+    touch(p->brt.u_left_child);
+    touch(p->brt.u_parents);
+    touch(p->brt.u_nodes);
+  });
+}
+
+template <typename Pool, typename Key>
+void compute_bounds(Pool& pool,
+                    int num_threads,
+                    const std::shared_ptr<BasicPipe<Key>>& p) {
+  if (p->bounds_mode == shared::BoundsMode::kFixed) {
+    p->box_min = glm::vec3(p->min_coord);
+    p->box_range = glm::vec3(p->range);
+    return;
+  }
+  p->set_bounds(dispatch_parallel_bounds(pool, num_threads, *p));
+}
+
+// 'kernel' only applies to 32-bit keys, the 64-bit ones are encoded scalar
+template <typename Pool, typename Key>
+void morton_code(Pool& pool,
+                 int num_threads,
+                 const std::shared_ptr<BasicPipe<Key>>& p,
+                 const MortonKernel kernel) {
+  compute_bounds(pool, num_threads, p);
   pool.submit_blocks(
           0,
           p->n_input(),
           [&](const int start, const int end) {
-            for (int i = start; i < end; ++i) {
-              p->u_morton[i] = shared::xyz_to_morton32(
-                  p->u_points[i], p->min_coord, p->range);
+            if constexpr (std::is_same_v<Key, morton_t>) {
+              encode_morton32(*p, start, end, kernel);
+            } else {
+              for (int i = start; i < end; ++i) {
+                p->u_morton[i] = shared::morton_traits<Key>::encode(
+                    p->point(i), p->box_min, p->box_range);
+              }
             }
           },
           num_threads)
       .wait();
 }
 
-void dispatch_RadixSort(core::thread_pool& pool,
-                        int num_threads,
-                        const std::shared_ptr<const Pipe>& p) {
-  std::barrier bar(num_threads);
+template <typename Pool, typename Key>
+void radix_sort(Pool& pool,
+                int num_threads,
+                const std::shared_ptr<const BasicPipe<Key>>& p,
+                const RadixSortVariant variant) {
+  if (variant != RadixSortVariant::kBinning) {
+    const auto mode = (variant == RadixSortVariant::kParallelLSDWriteCombining)
+                          ? ScatterMode::kWriteCombining
+                          : ScatterMode::kDirect;
+    dispatch_parallel_radix_sort(
+        pool, num_threads, p->n_input(), p->u_morton, p->u_morton_alt, mode);
+    return;
+  }
 
-  dispatch_binning_pass(
-      pool, num_threads, bar, p->n_input(), p->u_morton, p->u_morton_alt, 0)
-      .wait();
-  dispatch_binning_pass(
-      pool, num_threads, bar, p->n_input(), p->u_morton_alt, p->u_morton, 8)
-      .wait();
-  dispatch_binning_pass(
-      pool, num_threads, bar, p->n_input(), p->u_morton, p->u_morton_alt, 16)
-      .wait();
-  dispatch_binning_pass(
-      pool, num_threads, bar, p->n_input(), p->u_morton_alt, p->u_morton, 24)
+  // the binning pass only knows 32-bit keys
+  if constexpr (!std::is_same_v<Key, morton_t>) {
+    throw std::invalid_argument("kBinning needs 32-bit morton codes");
+  } else {
+    std::barrier bar(num_threads);
+
+    dispatch_binning_pass(
+        pool, num_threads, bar, p->n_input(), p->u_morton, p->u_morton_alt, 0)
+        .wait();
+    dispatch_binning_pass(
+        pool, num_threads, bar, p->n_input(), p->u_morton_alt, p->u_morton, 8)
+        .wait();
+    dispatch_binning_pass(
+        pool, num_threads, bar, p->n_input(), p->u_morton, p->u_morton_alt, 16)
+        .wait();
+    dispatch_binning_pass(
+        pool, num_threads, bar, p->n_input(), p->u_morton_alt, p->u_morton, 24)
+        .wait();
+  }
+}
+
+template <typename Pool, typename Key>
+void radix_sort_with_indices(Pool& pool,
+                             int num_threads,
+                             const std::shared_ptr<const BasicPipe<Key>>& p) {
+  if (!p->has_point_order())
+    throw std::runtime_error("Point order unallocated!!!");
+
+  dispatch_parallel_radix_sort_kv(pool,
+                                  num_threads,
+                                  p->n_input(),
+                                  p->u_morton,
+                                  p->u_morton_alt,
+                                  p->u_point_index,
+                                  p->u_point_index_alt);
+}
+
+template <typename Pool, typename Key>
+void gather_points(Pool& pool,
+                   int num_threads,
+                   const std::shared_ptr<const BasicPipe<Key>>& p) {
+  if (!p->has_point_order())
+    throw std::runtime_error("Point order unallocated!!!");
+
+  pool.submit_blocks(
+          0,
+          p->n_input(),
+          [p](const int start, const int end) {
+            for (int i = start; i < end; ++i) {
+              p->u_points_sorted[i] = p->u_points[p->u_point_index[i]];
+            }
+          },
+          num_threads)
       .wait();
 }
 
-void dispatch_RemoveDuplicates([[maybe_unused]] core::thread_pool& pool,
-                               [[maybe_unused]] int num_threads,
-                               const std::shared_ptr<Pipe>& p) {
-  const auto last = std::unique_copy(
-      p->u_morton, p->u_morton + p->n_input(), p->u_morton_alt);
-  const auto n_unique = std::distance(p->u_morton_alt, last);
-  p->set_n_unique(n_unique);
-  p->brt.set_n_nodes(n_unique - 1);
+// 'n_unique' keys make 'n_unique - 1' radix tree nodes. An empty or
+// single-key frame has no tree, and so no edges and no octree nodes either:
+// the later stages then run over empty ranges.
+template <typename Key>
+void set_unique_count(BasicPipe<Key>& p, const int n_unique) {
+  p.set_n_unique(n_unique);
+  p.brt.set_n_nodes(n_unique > 1 ? n_unique - 1 : 0);
 }
 
-void dispatch_BuildRadixTree(core::thread_pool& pool,
-                             int num_threads,
-                             const std::shared_ptr<const Pipe>& p) {
+template <typename Pool, typename Key>
+void remove_duplicates(Pool& pool,
+                       int num_threads,
+                       const std::shared_ptr<BasicPipe<Key>>& p) {
+  const auto n_unique = dispatch_parallel_unique(pool,
+                                                 num_threads,
+                                                 p->n_input(),
+                                                 p->u_morton,
+                                                 p->u_morton_alt,
+                                                 p->im_storage.u_flag_heads);
+  set_unique_count(*p, n_unique);
+}
+
+template <typename Pool, typename Key>
+void radix_sort_and_remove_duplicates(
+    Pool& pool, int num_threads, const std::shared_ptr<BasicPipe<Key>>& p) {
+  const auto n_unique = dispatch_parallel_radix_sort_unique(
+      pool, num_threads, p->n_input(), p->u_morton, p->u_morton_alt);
+  set_unique_count(*p, n_unique);
+}
+
+// The stages from the radix tree on only find nodes in the layout the tree
+// was allocated for
+template <shared::BrtLayout Layout>
+void check_layout(const RadixTree& brt) {
+  if (brt.layout != Layout)
+    throw std::runtime_error("Radix tree allocated in another layout!!!");
+}
+
+template <shared::BrtLayout Layout, typename Pool, typename Key>
+void build_radix_tree(Pool& pool,
+                      int num_threads,
+                      const std::shared_ptr<const BasicPipe<Key>>& p) {
+  check_layout<Layout>(p->brt);
   return pool
       .submit_blocks(
           0,
           p->brt.n_nodes(),
           [p](const int start, const int end) {
             for (auto i = start; i < end; ++i) {
-              cpu::process_radix_tree_i(
-                  i, p->brt.n_nodes(), p->u_morton, &p->brt);
+              cpu::process_radix_tree_i<Layout>(
+                  i, p->brt.n_nodes(), p->u_morton_alt, &p->brt);
             }
           },
           num_threads)
       .wait();
 }
 
-void dispatch_EdgeCount(core::thread_pool& pool,
-                        int num_threads,
-                        const std::shared_ptr<const Pipe>& p) {
+template <shared::BrtLayout Layout, typename Pool, typename Key>
+void edge_count(Pool& pool,
+                int num_threads,
+                const std::shared_ptr<const BasicPipe<Key>>& p) {
+  check_layout<Layout>(p->brt);
   pool.submit_blocks(
           0,
           p->brt.n_nodes(),
           [p](const int start, const int end) {
+            const auto brt = p->brt.template view<Layout>();
             for (auto i = start; i < end; ++i) {
-              shared::process_edge_count_i(
-                  i, p->brt.u_prefix_n, p->brt.u_parents, p->u_edge_counts);
+              shared::process_edge_count_i(i, brt, p->u_edge_counts);
             }
           },
           num_threads)
       .wait();
 }
 
-void dispatch_EdgeOffset(core::thread_pool& pool,
-                         [[maybe_unused]] int num_threads,
-                         const std::shared_ptr<const Pipe>& p) {
-  pool.submit_task([p]() {
-        std::partial_sum(p->u_edge_counts,
-                         p->u_edge_counts + p->n_brt_nodes(),
-                         p->u_edge_offsets);
-        return p->u_edge_offsets[p->brt.n_nodes() - 1];
-      })
-      .wait();
+template <typename Pool, typename Key>
+void edge_offset(Pool& pool,
+                 int num_threads,
+                 const std::shared_ptr<const BasicPipe<Key>>& p) {
+  dispatch_parallel_inclusive_scan(pool,
+                                   num_threads,
+                                   p->n_brt_nodes(),
+                                   p->u_edge_counts,
+                                   p->u_edge_offsets);
+}
+
+template <shared::BrtLayout Layout, typename Pool, typename Key>
+void edge_count_and_offset(Pool& pool,
+                           int num_threads,
+                           const std::shared_ptr<const BasicPipe<Key>>& p) {
+  check_layout<Layout>(p->brt);
+  const auto blks = partition_blocks(pool, 0, p->brt.n_nodes(), num_threads);
+
+  // edge counts and their per-block sums in one sweep
+  std::vector<int> block_sums(blks.get_num_blocks());
+  const auto brt = p->brt.template view<Layout>();
+  run_blocks(pool, blks, [&](const size_t blk, const int start, const int end) {
+    int sum = 0;
+    for (auto i = start; i < end; ++i) {
+      shared::process_edge_count_i(i, brt, p->u_edge_counts);
+      sum += p->u_edge_counts[i];
+    }
+    block_sums[blk] = sum;
+  });
+
+  dispatch_scan_with_block_sums(pool,
+                                num_threads,
+                                p->brt.n_nodes(),
+                                p->u_edge_counts,
+                                p->u_edge_offsets,
+                                block_sums.data());
+}
+
+// The octree has the root plus one node per edge: the strings of nodes the
+// brt nodes add end at their inclusive edge offsets ('first_oct_node').
+template <typename Key>
+void size_octree(BasicPipe<Key>& p) {
+  const auto n_brt_nodes = p.brt.n_nodes();
+  const auto n_oct_nodes =
+      n_brt_nodes > 0 ? p.u_edge_offsets[n_brt_nodes - 1] + 1 : 0;
+  p.oct.reserve(n_oct_nodes);
+  p.oct.set_n_nodes(n_oct_nodes);
 }
 
-void dispatch_BuildOctree(core::thread_pool& pool,
-                          int num_threads,
-                          const std::shared_ptr<const Pipe>& p) {
+template <shared::BrtLayout Layout, typename Pool, typename Key>
+void build_octree(Pool& pool,
+                  int num_threads,
+                  const std::shared_ptr<BasicPipe<Key>>& p) {
+  check_layout<Layout>(p->brt);
+  size_octree(*p);
+  // the masks are OR-ed and AND-ed into, so they start from zero like on the
+  // GPU (clear_octree.comp)
+  pool.submit_blocks(
+          0,
+          p->oct.n_nodes(),
+          [p](const int start, const int end) {
+            std::fill(p->oct.u_child_node_mask + start,
+                      p->oct.u_child_node_mask + end,
+                      0);
+            std::fill(p->oct.u_child_leaf_mask + start,
+                      p->oct.u_child_leaf_mask + end,
+                      0);
+          },
+          num_threads)
+      .wait();
   pool.submit_blocks(
           1,
           p->brt.n_nodes(),
           [p](const int start, const int end) {
+            const auto brt = p->brt.template view<Layout>();
             for (auto i = start; i < end; ++i) {
               shared::process_oct_node(i,
                                        p->oct.u_children,
@@ -115,11 +325,10 @@ void dispatch_BuildOctree(core::thread_pool& pool,
                                        p->oct.u_child_node_mask,
                                        p->u_edge_offsets,
                                        p->u_edge_counts,
-                                       p->u_morton,
-                                       p->brt.u_prefix_n,
-                                       p->brt.u_parents,
-                                       p->min_coord,
-                                       p->range);
+                                       p->u_morton_alt,
+                                       brt,
+                                       p->box_min,
+                                       p->box_range);
             }
           },
           num_threads)
@@ -128,41 +337,282 @@ void dispatch_BuildOctree(core::thread_pool& pool,
           0,
           p->brt.n_nodes(),
           [p](const int start, const int end) {
+            const auto brt = p->brt.template view<Layout>();
             for (auto i = start; i < end; ++i) {
               shared::process_link_leaf(i,
                                         p->oct.u_children,
                                         p->oct.u_child_leaf_mask,
                                         p->u_edge_offsets,
                                         p->u_edge_counts,
-                                        p->u_morton,
-                                        p->brt.u_has_leaf_left,
-                                        p->brt.u_has_leaf_right,
-                                        p->brt.u_prefix_n,
-                                        p->brt.u_parents,
-                                        p->brt.u_left_child);
+                                        p->u_morton_alt,
+                                        brt);
             }
           },
           num_threads)
       .wait();
 }
 
-// --------------------------------------------------------------------------
+}  // namespace
+
+template <typename Pool>
+void dispatch_FirstTouch(Pool& pool,
+                         const int num_threads,
+                         const std::shared_ptr<Pipe>& p) {
+  PPL_TRACE_SCOPE("FirstTouch");
+  first_touch(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_FirstTouch(Pool& pool,
+                         const int num_threads,
+                         const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("FirstTouch");
+  first_touch(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_ComputeBounds(Pool& pool,
+                            const int num_threads,
+                            const std::shared_ptr<Pipe>& p) {
+  PPL_TRACE_SCOPE("ComputeBounds");
+  compute_bounds(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_ComputeBounds(Pool& pool,
+                            const int num_threads,
+                            const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("ComputeBounds");
+  compute_bounds(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_MortonCode(Pool& pool,
+                         const int num_threads,
+                         const std::shared_ptr<Pipe>& p,
+                         const MortonKernel kernel) {
+  PPL_TRACE_SCOPE("MortonCode");
+  morton_code(pool, num_threads, p, kernel);
+}
+
+template <typename Pool>
+void dispatch_MortonCode(Pool& pool,
+                         const int num_threads,
+                         const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("MortonCode");
+  morton_code(pool, num_threads, p, MortonKernel::kScalar);
+}
+
+template <typename Pool>
+void dispatch_RadixSort(Pool& pool,
+                        const int num_threads,
+                        const std::shared_ptr<const Pipe>& p,
+                        const RadixSortVariant variant) {
+  PPL_TRACE_SCOPE("RadixSort");
+  radix_sort(pool, num_threads, p, variant);
+}
+
+template <typename Pool>
+void dispatch_RadixSort(Pool& pool,
+                        const int num_threads,
+                        const std::shared_ptr<const Pipe64>& p,
+                        const RadixSortVariant variant) {
+  PPL_TRACE_SCOPE("RadixSort");
+  radix_sort(pool, num_threads, p, variant);
+}
+
+template <typename Pool>
+void dispatch_RadixSortWithIndices(Pool& pool,
+                                   const int num_threads,
+                                   const std::shared_ptr<const Pipe>& p) {
+  PPL_TRACE_SCOPE("RadixSortWithIndices");
+  radix_sort_with_indices(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_RadixSortWithIndices(Pool& pool,
+                                   const int num_threads,
+                                   const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("RadixSortWithIndices");
+  radix_sort_with_indices(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_GatherPoints(Pool& pool,
+                           const int num_threads,
+                           const std::shared_ptr<const Pipe>& p) {
+  PPL_TRACE_SCOPE("GatherPoints");
+  gather_points(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_GatherPoints(Pool& pool,
+                           const int num_threads,
+                           const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("GatherPoints");
+  gather_points(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_RemoveDuplicates(Pool& pool,
+                               const int num_threads,
+                               const std::shared_ptr<Pipe>& p) {
+  PPL_TRACE_SCOPE("RemoveDuplicates");
+  remove_duplicates(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_RemoveDuplicates(Pool& pool,
+                               const int num_threads,
+                               const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("RemoveDuplicates");
+  remove_duplicates(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_RadixSortAndRemoveDuplicates(Pool& pool,
+                                           const int num_threads,
+                                           const std::shared_ptr<Pipe>& p) {
+  PPL_TRACE_SCOPE("RadixSortAndRemoveDuplicates");
+  radix_sort_and_remove_duplicates(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_RadixSortAndRemoveDuplicates(Pool& pool,
+                                           const int num_threads,
+                                           const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("RadixSortAndRemoveDuplicates");
+  radix_sort_and_remove_duplicates(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_BuildRadixTree(Pool& pool,
+                             const int num_threads,
+                             const std::shared_ptr<const Pipe>& p) {
+  PPL_TRACE_SCOPE("BuildRadixTree");
+  build_radix_tree<Layout>(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_BuildRadixTree(Pool& pool,
+                             const int num_threads,
+                             const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("BuildRadixTree");
+  build_radix_tree<Layout>(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_EdgeCount(Pool& pool,
+                        const int num_threads,
+                        const std::shared_ptr<const Pipe>& p) {
+  PPL_TRACE_SCOPE("EdgeCount");
+  edge_count<Layout>(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_EdgeCount(Pool& pool,
+                        const int num_threads,
+                        const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("EdgeCount");
+  edge_count<Layout>(pool, num_threads, p);
+}
 
-// ------------------------------------------------------------------------
-void dispatch_MortonCode(BS::thread_pool& pool,
-                         int num_threads,
+template <typename Pool>
+void dispatch_EdgeOffset(Pool& pool,
+                         const int num_threads,
                          const std::shared_ptr<const Pipe>& p) {
-  pool.submit_blocks(
-          0,
-          p->n_input(),
-          [&](const int start, const int end) {
-            for (int i = start; i < end; ++i) {
-              p->u_morton[i] = shared::xyz_to_morton32(
-                  p->u_points[i], p->min_coord, p->range);
-            }
-          },
-          num_threads)
-      .wait();
+  PPL_TRACE_SCOPE("EdgeOffset");
+  edge_offset(pool, num_threads, p);
+}
+
+template <typename Pool>
+void dispatch_EdgeOffset(Pool& pool,
+                         const int num_threads,
+                         const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("EdgeOffset");
+  edge_offset(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_EdgeCountAndOffset(Pool& pool,
+                                 const int num_threads,
+                                 const std::shared_ptr<const Pipe>& p) {
+  PPL_TRACE_SCOPE("EdgeCountAndOffset");
+  edge_count_and_offset<Layout>(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_EdgeCountAndOffset(Pool& pool,
+                                 const int num_threads,
+                                 const std::shared_ptr<const Pipe64>& p) {
+  PPL_TRACE_SCOPE("EdgeCountAndOffset");
+  edge_count_and_offset<Layout>(pool, num_threads, p);
+}
+
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_BuildOctree(Pool& pool,
+                          const int num_threads,
+                          const std::shared_ptr<Pipe>& p) {
+  PPL_TRACE_SCOPE("BuildOctree");
+  build_octree<Layout>(pool, num_threads, p);
 }
 
+template <shared::BrtLayout Layout, typename Pool>
+void dispatch_BuildOctree(Pool& pool,
+                          const int num_threads,
+                          const std::shared_ptr<Pipe64>& p) {
+  PPL_TRACE_SCOPE("BuildOctree");
+  build_octree<Layout>(pool, num_threads, p);
+}
+
+// ----------------------------------------------------------------------------
+// Explicit instantiations
+// ----------------------------------------------------------------------------
+
+#define INSTANTIATE_LAYOUT_DISPATCHERS(POOL, PIPE, LAYOUT)                     \
+  template void dispatch_BuildRadixTree<LAYOUT>(                               \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  template void dispatch_EdgeCount<LAYOUT>(                                    \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  template void dispatch_EdgeCountAndOffset<LAYOUT>(                           \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  template void dispatch_BuildOctree<LAYOUT>(                                  \
+      POOL&, int, const std::shared_ptr<PIPE>&);
+
+#define INSTANTIATE_PIPE_DISPATCHERS(POOL, PIPE)                               \
+  template void dispatch_FirstTouch(                                           \
+      POOL&, int, const std::shared_ptr<PIPE>&);                               \
+  template void dispatch_ComputeBounds(                                        \
+      POOL&, int, const std::shared_ptr<PIPE>&);                               \
+  template void dispatch_RadixSort(                                            \
+      POOL&, int, const std::shared_ptr<const PIPE>&, RadixSortVariant);       \
+  template void dispatch_RadixSortWithIndices(                                 \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  template void dispatch_GatherPoints(                                         \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  template void dispatch_RemoveDuplicates(                                     \
+      POOL&, int, const std::shared_ptr<PIPE>&);                               \
+  template void dispatch_RadixSortAndRemoveDuplicates(                         \
+      POOL&, int, const std::shared_ptr<PIPE>&);                               \
+  template void dispatch_EdgeOffset(                                           \
+      POOL&, int, const std::shared_ptr<const PIPE>&);                         \
+  INSTANTIATE_LAYOUT_DISPATCHERS(POOL, PIPE, shared::BrtLayout::kSoA)          \
+  INSTANTIATE_LAYOUT_DISPATCHERS(POOL, PIPE, shared::BrtLayout::kPacked)
+
+#define INSTANTIATE_DISPATCHERS(POOL)                                          \
+  template void dispatch_MortonCode(                                           \
+      POOL&, int, const std::shared_ptr<Pipe>&, MortonKernel);                 \
+  template void dispatch_MortonCode(                                           \
+      POOL&, int, const std::shared_ptr<Pipe64>&);                             \
+  INSTANTIATE_PIPE_DISPATCHERS(POOL, Pipe)                                     \
+  INSTANTIATE_PIPE_DISPATCHERS(POOL, Pipe64)
+
+INSTANTIATE_DISPATCHERS(core::thread_pool)
+INSTANTIATE_DISPATCHERS(core::work_stealing_pool)
+INSTANTIATE_DISPATCHERS(BS::thread_pool)
+
+#undef INSTANTIATE_DISPATCHERS
+#undef INSTANTIATE_PIPE_DISPATCHERS
+#undef INSTANTIATE_LAYOUT_DISPATCHERS
+
 }  // namespace cpu
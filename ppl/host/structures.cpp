@@ -1,68 +1,315 @@
 #include "shared/structures.h"
 
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// 1.5x, so a stream of slowly growing frames reallocates only a few times
+size_t grown_capacity(const size_t capacity, const size_t required) {
+  return std::max(required, capacity + capacity / 2);
+}
+
+// Every array comes from 'arena' if there is one, from 'new[]' otherwise.
+// Arena memory is only given back by 'core::arena::clear()'.
+template <typename T>
+T* allocate(core::arena* arena, const size_t n) {
+  if (n == 0) return nullptr;
+  return arena != nullptr ? arena->allocate<T>(n) : new T[n];
+}
+
+template <typename T>
+void release(core::arena* arena, T*& ptr) {
+  if (arena == nullptr) delete[] ptr;
+  ptr = nullptr;
+}
+
+// Replaces 'ptr' by an uninitialized array of 'n', for arrays that are
+// rewritten every frame
+template <typename T>
+void reallocate(core::arena* arena, T*& ptr, const size_t n) {
+  release(arena, ptr);
+  ptr = allocate<T>(arena, n);
+}
+
+// 1 + 2^-20: '(max - min) / range' stays below 1 after rounding, so the
+// largest coordinate does not wrap around to cell 0
+constexpr auto bounds_padding = 1.0f + 1.0f / (1 << 20);
+
+}  // namespace
+
+shared::QuantizationBox shared::make_quantization_box(const BoundsMode mode,
+                                                      const Aabb& bounds,
+                                                      const float min_coord,
+                                                      const float range) {
+  const auto extent = [&](const int axis) {
+    const auto e = bounds.upper[axis] - bounds.lower[axis];
+    // a flat axis still needs a non-zero range
+    return e > 0.0f ? e * bounds_padding : 1.0f;
+  };
+  const bool empty = !(bounds.lower.x <= bounds.upper.x &&
+                       bounds.lower.y <= bounds.upper.y &&
+                       bounds.lower.z <= bounds.upper.z);
+
+  if (mode == BoundsMode::kFixed || empty) {
+    return {glm::vec3(min_coord), glm::vec3(range)};
+  }
+  if (mode == BoundsMode::kAabb) {
+    return {bounds.lower,
+            glm::vec3(std::max({extent(0), extent(1), extent(2)}))};
+  }
+  return {bounds.lower, glm::vec3(extent(0), extent(1), extent(2))};
+}
+
 // Let's allocate 'capacity' instead of 'n_brt_nodes' for now
 // Because usually n_brt_nodes is 99.x% of capacity
 
-RadixTree::RadixTree(const size_t capacity) : capacity(capacity) {
-  u_prefix_n = new uint8_t[capacity];
-  u_has_leaf_left = new bool[capacity];
-  u_has_leaf_right = new bool[capacity];
-  u_left_child = new int[capacity];
-  u_parents = new int[capacity];
+RadixTree::RadixTree(const size_t capacity,
+                     core::arena* arena,
+                     const shared::BrtLayout layout)
+    : capacity(capacity), arena(arena), layout(layout) {
+  allocate_nodes();
+}
+
+RadixTree::~RadixTree() { release_nodes(); }
+
+void RadixTree::allocate_nodes() {
+  if (layout == shared::BrtLayout::kSoA) {
+    u_prefix_n = allocate<uint8_t>(arena, capacity);
+    u_has_leaf_left = allocate<bool>(arena, capacity);
+    u_has_leaf_right = allocate<bool>(arena, capacity);
+    u_left_child = allocate<int>(arena, capacity);
+  } else {
+    u_nodes = allocate<shared::PackedBrtNode>(arena, capacity);
+  }
+  u_parents = allocate<int>(arena, capacity);
+}
+
+void RadixTree::release_nodes() {
+  release(arena, u_prefix_n);
+  release(arena, u_has_leaf_left);
+  release(arena, u_has_leaf_right);
+  release(arena, u_left_child);
+  release(arena, u_nodes);
+  release(arena, u_parents);
+}
+
+void RadixTree::reserve(const size_t n) {
+  if (n <= capacity) return;
+  capacity = grown_capacity(capacity, n);
+  release_nodes();
+  allocate_nodes();
 }
 
-RadixTree::~RadixTree() {
-  delete[] u_prefix_n;
-  delete[] u_has_leaf_left;
-  delete[] u_has_leaf_right;
-  delete[] u_left_child;
-  delete[] u_parents;
+void RadixTree::use_layout(const shared::BrtLayout layout) {
+  if (layout == this->layout) return;
+  release_nodes();
+  this->layout = layout;
+  allocate_nodes();
 }
 
-Octree::Octree(const size_t capacity) : capacity(capacity) {
-  u_children = new int[capacity][8];
-  u_corner = new glm::vec4[capacity];
-  u_cell_size = new float[capacity];
-  u_child_node_mask = new int[capacity];
-  u_child_leaf_mask = new int[capacity];
+size_t RadixTree::bytes_per_node(const shared::BrtLayout layout) {
+  const auto nodes = layout == shared::BrtLayout::kSoA
+                         ? sizeof(uint8_t) + 2 * sizeof(bool) + sizeof(int)
+                         : sizeof(shared::PackedBrtNode);
+  return nodes + sizeof(int);
+}
+
+Octree::Octree(const size_t capacity, core::arena* arena)
+    : capacity(capacity), arena(arena) {
+  u_children = allocate<int[8]>(arena, capacity);
+  u_corner = allocate<glm::vec4>(arena, capacity);
+  u_cell_size = allocate<float>(arena, capacity);
+  u_child_node_mask = allocate<int>(arena, capacity);
+  u_child_leaf_mask = allocate<int>(arena, capacity);
 }
 
 Octree::~Octree() {
-  delete[] u_children;
-  delete[] u_corner;
-  delete[] u_cell_size;
-  delete[] u_child_node_mask;
-  delete[] u_child_leaf_mask;
+  release(arena, u_children);
+  release(arena, u_corner);
+  release(arena, u_cell_size);
+  release(arena, u_child_node_mask);
+  release(arena, u_child_leaf_mask);
 }
 
-constexpr auto educated_guess = 0.55;
+void Octree::reserve(const size_t n) {
+  if (n <= capacity) return;
+  if (arena != nullptr) abandoned_bytes += capacity * bytes_per_node();
+  capacity = grown_capacity(capacity, n);
+  reallocate(arena, u_children, capacity);
+  reallocate(arena, u_corner, capacity);
+  reallocate(arena, u_cell_size, capacity);
+  reallocate(arena, u_child_node_mask, capacity);
+  reallocate(arena, u_child_leaf_mask, capacity);
+}
 
-Pipe::Pipe(const int n,
-           const float min_coord,
-           const float range,
-           const int seed)
-    : brt(n),
-      oct(n * educated_guess),
+size_t Octree::bytes_per_node() {
+  return sizeof(int[8]) + sizeof(glm::vec4) + sizeof(float) + 2 * sizeof(int);
+}
+
+template <typename Key>
+BasicPipe<Key>::BasicPipe(const int n,
+                          const float min_coord,
+                          const float range,
+                          const int seed,
+                          const std::optional<core::arena_options>& memory)
+    : arena(memory ? std::make_unique<core::arena>(*memory) : nullptr),
+      brt(0, arena.get()),
+      // sized by the octree stage, from the total of the edge offsets
+      oct(0, arena.get()),
+      box_min(min_coord),
+      box_range(range),
       n_points(n),
+      capacity(0),
       min_coord(min_coord),
       range(range),
       seed(seed) {
-  u_points = new glm::vec4[n];
-  u_morton = new morton_t[n];
-  u_morton_alt = new morton_t[n];
-  u_edge_counts = new int[n];
-  u_edge_offsets = new int[n];
-  // For CPU, no need to allocate the temporary storage
+  allocate_arrays(n, {});
+}
+
+template <typename Key>
+BasicPipe<Key>::~BasicPipe() {
+  release_arrays();
+}
+
+template <typename Key>
+auto BasicPipe<Key>::optional_arrays() const -> OptionalArrays {
+  return {.point_order = has_point_order(),
+          .soa = u_xs != nullptr,
+          .packed3 = u_points3 != nullptr,
+          .brt_layout = brt.layout};
+}
+
+template <typename Key>
+size_t BasicPipe<Key>::bytes_per_point(const OptionalArrays& optional) {
+  auto bytes = sizeof(glm::vec4) + 2 * sizeof(Key) + 3 * sizeof(int) +
+               RadixTree::bytes_per_node(optional.brt_layout);
+  if (optional.point_order) {
+    bytes += 2 * sizeof(uint32_t) + sizeof(glm::vec4);
+  }
+  if (optional.soa) bytes += 3 * sizeof(float);
+  if (optional.packed3) bytes += sizeof(glm::vec3);
+  return bytes;
+}
+
+template <typename Key>
+size_t BasicPipe<Key>::bytes_per_point() const {
+  return bytes_per_point(optional_arrays());
+}
+
+template <typename Key>
+void BasicPipe<Key>::allocate_arrays(const size_t n,
+                                     const OptionalArrays& optional) {
+  auto* a = arena.get();
+  if (a != nullptr) {
+    // all arrays in one chunk, the octree at the size it last grew to, plus
+    // the alignment padding of every array
+    a->reserve(n * bytes_per_point(optional) +
+               oct.capacity * Octree::bytes_per_node() +
+               32 * core::arena::alignment);
+  }
+
+  capacity = n;
+  u_points = allocate<glm::vec4>(a, n);
+  u_morton = allocate<Key>(a, n);
+  u_morton_alt = allocate<Key>(a, n);
+  u_edge_counts = allocate<int>(a, n);
+  u_edge_offsets = allocate<int>(a, n);
+  // For CPU, only the flags of the parallel duplicate removal are needed from
+  // the temporary storage
+  im_storage.u_flag_heads = allocate<int>(a, n);
+  // never outgrown, there are fewer radix tree nodes than points
+  brt.reserve(n);
+  if (a != nullptr) {
+    oct.reserve(std::exchange(oct.capacity, 0));
+  }
+  // the optional arrays only if they are in use
+  if (optional.point_order) {
+    u_point_index = allocate<uint32_t>(a, n);
+    u_point_index_alt = allocate<uint32_t>(a, n);
+    u_points_sorted = allocate<glm::vec4>(a, n);
+  }
+  if (optional.soa) {
+    u_xs = allocate<float>(a, n);
+    u_ys = allocate<float>(a, n);
+    u_zs = allocate<float>(a, n);
+  }
+  if (optional.packed3) {
+    u_points3 = allocate<glm::vec3>(a, n);
+  }
+}
+
+template <typename Key>
+void BasicPipe<Key>::release_arrays() {
+  auto* a = arena.get();
+  release(a, u_points);
+  release(a, u_morton);
+  release(a, u_morton_alt);
+  release(a, u_edge_counts);
+  release(a, u_edge_offsets);
+  release(a, im_storage.u_flag_heads);
+  release(a, u_point_index);
+  release(a, u_point_index_alt);
+  release(a, u_points_sorted);
+  release(a, u_xs);
+  release(a, u_ys);
+  release(a, u_zs);
+  release(a, u_points3);
+}
+
+template <typename Key>
+void BasicPipe<Key>::reset(const int n) {
+  n_points = n;
+  n_unique = UNINITIALIZED;
+  brt.n_brt_nodes = UNINITIALIZED;
+  oct.n_oct_nodes = UNINITIALIZED;
+  const bool fits = static_cast<size_t>(n) <= capacity;
+  if (fits && oct.abandoned_bytes == 0) return;
+
+  const auto new_capacity = fits ? capacity : grown_capacity(capacity, n);
+  const auto optional = optional_arrays();
+  release_arrays();
+  if (arena != nullptr) {
+    // everything is carved again, the octree keeps its capacity
+    arena->clear();
+    brt.capacity = 0;
+    oct.abandoned_bytes = 0;
+  }
+  allocate_arrays(new_capacity, optional);
 }
 
-Pipe::~Pipe() {
-  delete[] u_points;
-  delete[] u_morton;
-  delete[] u_morton_alt;
-  delete[] u_edge_counts;
-  delete[] u_edge_offsets;
+template <typename Key>
+void BasicPipe<Key>::allocate_point_order() {
+  if (has_point_order()) return;
+  u_point_index = allocate<uint32_t>(arena.get(), capacity);
+  u_point_index_alt = allocate<uint32_t>(arena.get(), capacity);
+  u_points_sorted = allocate<glm::vec4>(arena.get(), capacity);
 }
 
-void Pipe::clearSmem() {
+template <typename Key>
+void BasicPipe<Key>::set_bounds(const shared::Aabb& bounds) {
+  const auto box =
+      shared::make_quantization_box(bounds_mode, bounds, min_coord, range);
+  box_min = box.min;
+  box_range = box.range;
+}
+
+template <typename Key>
+void BasicPipe<Key>::use_point_layout(const shared::PointLayout layout) {
+  point_layout = layout;
+  if (layout == shared::PointLayout::kSoA && u_xs == nullptr) {
+    u_xs = allocate<float>(arena.get(), capacity);
+    u_ys = allocate<float>(arena.get(), capacity);
+    u_zs = allocate<float>(arena.get(), capacity);
+  } else if (layout == shared::PointLayout::kPacked3 && u_points3 == nullptr) {
+    u_points3 = allocate<glm::vec3>(arena.get(), capacity);
+  }
+}
+
+template <typename Key>
+void BasicPipe<Key>::clearSmem() {
   // no effect on CPU
-}
\ No newline at end of file
+}
+
+template struct BasicPipe<morton_t>;
+template struct BasicPipe<morton64_t>;
\ No newline at end of file
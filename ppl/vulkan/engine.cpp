@@ -2,8 +2,34 @@
 
 #include <spdlog/spdlog.h>
 
+Engine::Engine(const bool manage_resources,
+               const std::filesystem::path &pipeline_cache_dir)
+    : manage_resources_(manage_resources) {
+  if (device_ != VK_NULL_HANDLE) {
+    pipeline_cache_ = std::make_unique<PipelineCache>(
+        this->get_device_ptr(), physical_device_, pipeline_cache_dir);
+  }
+}
+
 Engine::~Engine() { destroy(); }
 
+auto Engine::kernel(const KernelKey &key) -> std::shared_ptr<const Kernel> {
+  if (const auto it = kernels_.find(key); it != kernels_.end()) {
+    return it->second;
+  }
+
+  auto kernel = std::make_shared<Kernel>(
+      this->get_device_ptr(), key, get_pipeline_cache());
+  kernels_.emplace(key, kernel);
+  return kernel;
+}
+
+void Engine::save_pipeline_cache() const {
+  if (pipeline_cache_) {
+    pipeline_cache_->save();
+  }
+}
+
 void Engine::destroy() {
   spdlog::debug("Engine::destroy()");
 
@@ -33,4 +59,19 @@ void Engine::destroy() {
       }
     }
   }
+
+  // After the algorithms, which bind them. Unmanaged algorithms keep their
+  // kernel alive, it is freed with the last of them.
+  if (manage_resources_ && !kernels_.empty()) {
+    spdlog::debug("Engine::destroy() explicitly freeing kernels");
+    for (auto &[key, kernel] : kernels_) {
+      kernel->destroy();
+    }
+  }
+  kernels_.clear();
+
+  if (pipeline_cache_) {
+    pipeline_cache_->save();
+    pipeline_cache_->destroy();
+  }
 }
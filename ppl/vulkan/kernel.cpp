@@ -0,0 +1,150 @@
+#include "vulkan/kernel.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <vector>
+
+#include "vulkan/shader_loader.hpp"
+#include "vulkan/vk_helper.hpp"
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+Kernel::Kernel(std::shared_ptr<VkDevice> device_ptr,
+               KernelKey key,
+               const VkPipelineCache pipeline_cache)
+    : VulkanResource<VkShaderModule>(std::move(device_ptr)),
+      key_(std::move(key)) {
+  spdlog::debug("Kernel::Kernel() [{}]: {} buffers, {} bytes of push constants",
+                key_.spirv_filename,
+                key_.n_buffers,
+                key_.push_constants_size);
+
+  create_shader_module();
+  create_descriptor_set_layout();
+  create_pipeline(pipeline_cache);
+}
+
+void Kernel::destroy() {
+  spdlog::debug("Kernel::destroy()");
+
+  if (handle_ == VK_NULL_HANDLE) {
+    return;
+  }
+  vkDestroyPipeline(*device_ptr_, pipeline_, nullptr);
+  vkDestroyPipelineLayout(*device_ptr_, pipeline_layout_, nullptr);
+  vkDestroyDescriptorSetLayout(*device_ptr_, descriptor_set_layout_, nullptr);
+  vkDestroyShaderModule(*device_ptr_, handle_, nullptr);
+  handle_ = VK_NULL_HANDLE;
+}
+
+void Kernel::create_shader_module() {
+  const auto spirv_binary = load_shader_from_file(key_.spirv_filename);
+
+  const VkShaderModuleCreateInfo create_info = {
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .codeSize = spirv_binary.size() * sizeof(uint32_t),
+      .pCode = reinterpret_cast<const uint32_t *>(spirv_binary.data()),
+  };
+
+  check_vk_result(vkCreateShaderModule(
+      *device_ptr_, &create_info, nullptr, &this->get_handle()));
+
+  spdlog::debug("Shader module created successfully");
+}
+
+void Kernel::create_descriptor_set_layout() {
+  std::vector<VkDescriptorSetLayoutBinding> bindings;
+  bindings.reserve(key_.n_buffers);
+
+  for (uint32_t i = 0; i < key_.n_buffers; ++i) {
+    bindings.emplace_back(VkDescriptorSetLayoutBinding{
+        .binding = i,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+    });
+  }
+
+  const VkDescriptorSetLayoutCreateInfo layout_create_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = static_cast<uint32_t>(bindings.size()),
+      .pBindings = bindings.data(),
+  };
+
+  check_vk_result(vkCreateDescriptorSetLayout(
+      *device_ptr_, &layout_create_info, nullptr, &descriptor_set_layout_));
+}
+
+void Kernel::create_pipeline(const VkPipelineCache pipeline_cache) {
+  const VkPushConstantRange push_constant_range = {
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset = 0,
+      .size = key_.push_constants_size,
+  };
+
+  const VkPipelineLayoutCreateInfo layout_create_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &descriptor_set_layout_,
+      .pushConstantRangeCount =
+          static_cast<uint32_t>(key_.push_constants_size > 0 ? 1 : 0),
+      .pPushConstantRanges = &push_constant_range,
+  };
+
+  check_vk_result(vkCreatePipelineLayout(
+      *device_ptr_, &layout_create_info, nullptr, &pipeline_layout_));
+
+  std::vector<VkSpecializationMapEntry> spec_entries;
+  std::vector<uint32_t> spec_data;
+  spec_entries.reserve(key_.spec_constants.size());
+  spec_data.reserve(key_.spec_constants.size());
+  for (const auto &[id, value] : key_.spec_constants) {
+    spec_entries.push_back({
+        .constantID = id,
+        .offset = static_cast<uint32_t>(spec_data.size() * sizeof(uint32_t)),
+        .size = sizeof(uint32_t),
+    });
+    spec_data.push_back(value);
+  }
+
+  const VkSpecializationInfo spec_info = {
+      .mapEntryCount = static_cast<uint32_t>(spec_entries.size()),
+      .pMapEntries = spec_entries.data(),
+      .dataSize = spec_data.size() * sizeof(uint32_t),
+      .pData = spec_data.data(),
+  };
+
+  constexpr auto p_name = "main";
+
+  const VkPipelineShaderStageCreateInfo shader_stage_create_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+      .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+      .module = this->get_handle(),
+      .pName = p_name,
+      .pSpecializationInfo = spec_entries.empty() ? nullptr : &spec_info,
+  };
+
+  const VkComputePipelineCreateInfo pipeline_create_info = {
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage = shader_stage_create_info,
+      .layout = pipeline_layout_,
+      .basePipelineHandle = VK_NULL_HANDLE,
+  };
+
+  spdlog::debug("Creating compute pipeline with:");
+  spdlog::debug("  Shader module handle: {}", (void *)this->get_handle());
+  spdlog::debug("  Pipeline layout handle: {}", (void *)pipeline_layout_);
+  spdlog::debug("  Entry point name: {}", p_name);
+  for (const auto &[id, value] : key_.spec_constants) {
+    spdlog::debug("  Specialization constant {}: {}", id, value);
+  }
+
+  check_vk_result(vkCreateComputePipelines(*device_ptr_,
+                                           pipeline_cache,
+                                           1,
+                                           &pipeline_create_info,
+                                           nullptr,
+                                           &pipeline_));
+
+  spdlog::debug("Pipeline created successfully");
+}
@@ -0,0 +1,453 @@
+#include "vulkan/pipe.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/trace.hpp"
+
+namespace vk {
+
+namespace {
+
+// The widest digit, must match the histograms of radix_histogram.comp and
+// radix_scatter.comp. The passes themselves come from radix_plan.comp.
+constexpr int kRadixBits = 8;
+constexpr uint32_t kRadix = 1u << kRadixBits;
+static_assert(kRadixBits >= shared::kMinRadixBits &&
+              kRadixBits <= shared::kMaxRadixBits);
+// The passes recorded every frame, those the plan does not use return at once
+constexpr int kSortPasses = (morton_bits + kRadixBits - 1) / kRadixBits;
+static_assert(kSortPasses == 4, "radix_plan.comp's 'Plan' holds 4 passes");
+
+// aabb.comp workgroups, each reduces a grid-stride share of the points
+constexpr uint32_t kBoundsWorkgroups = 32;
+
+// must match bounds_box.comp
+static_assert(static_cast<int>(shared::BoundsMode::kFixed) == 0 &&
+              static_cast<int>(shared::BoundsMode::kAabb) == 1 &&
+              static_cast<int>(shared::BoundsMode::kPerAxis) == 2);
+
+struct BoundsBoxPushConstants {
+  uint32_t n_boxes;
+  uint32_t mode;  // 'shared::BoundsMode'
+  float min_coord;
+  float range;
+};
+
+struct SortPushConstants {
+  uint32_t n;
+  uint32_t pass_index;
+  uint32_t n_tiles;
+};
+
+struct ScanPushConstants {
+  uint32_t n;
+  uint32_t block_size;
+};
+
+struct CountPushConstants {
+  uint32_t n;
+};
+
+constexpr auto kRead = BufferAccess::kRead;
+constexpr auto kWrite = BufferAccess::kWrite;
+constexpr auto kReadWrite = BufferAccess::kReadWrite;
+
+[[nodiscard]] uint32_t ceil_div(const uint32_t a, const uint32_t b) {
+  return (a + b - 1) / b;
+}
+
+// workgroups to give every item a thread
+[[nodiscard]] uint32_t n_blocks(const uint32_t n, const uint32_t threads) {
+  return std::max(ceil_div(n, threads), 1u);
+}
+
+[[nodiscard]] SpecConstants workgroup(const uint32_t threads) {
+  return {{spec::kWorkgroupSize, threads}};
+}
+
+[[nodiscard]] uint32_t tile_size(const PipeTuning& tuning) {
+  return tuning.sort_threads * tuning.items_per_thread;
+}
+
+void validate(const PipeTuning& t) {
+  for (const auto threads : {t.bounds_threads,
+                             t.morton_threads,
+                             t.sort_threads,
+                             t.items_per_thread,
+                             t.scan_threads,
+                             t.unique_threads,
+                             t.brt_threads,
+                             t.clear_threads,
+                             t.edge_threads,
+                             t.octree_threads}) {
+    if (threads == 0) {
+      throw std::invalid_argument("vk::PipeTuning: sizes must be positive");
+    }
+  }
+  // naive_prefix_sum.comp is a Blelloch scan of one workgroup, aabb.comp a
+  // tree reduction
+  if ((t.scan_threads & (t.scan_threads - 1)) != 0) {
+    throw std::invalid_argument(
+        "vk::PipeTuning: the scan workgroup must be a power of two");
+  }
+  if ((t.bounds_threads & (t.bounds_threads - 1)) != 0) {
+    throw std::invalid_argument(
+        "vk::PipeTuning: the bounds workgroup must be a power of two");
+  }
+}
+
+}  // namespace
+
+Pipe::Pipe(Engine& engine,
+           const int n_points,
+           const float min_coord,
+           const float range,
+           const PipeTuning& tuning)
+    : engine_(engine),
+      n_points_(n_points),
+      min_coord_(min_coord),
+      range_(range),
+      tuning_(tuning) {
+  if (n_points <= 0) {
+    throw std::invalid_argument("vk::Pipe needs at least one point");
+  }
+  validate(tuning_);
+  n_tiles_ = static_cast<int>(
+      ceil_div(static_cast<uint32_t>(n_points), tile_size(tuning_)));
+
+  const auto n = static_cast<size_t>(n_points);
+  const auto n_histogram = static_cast<size_t>(kRadix) * n_tiles_;
+
+  u_points = engine.typed_buffer<glm::vec4>(n);
+  u_box = engine.typed_buffer<glm::vec4>(2);
+  u_morton = engine.typed_buffer<morton_t>(n);
+  u_morton_alt = engine.typed_buffer<morton_t>(n);
+  u_brt_nodes = engine.typed_buffer<shared::PackedBrtNode>(n);
+  u_parents = engine.typed_buffer<int>(n);
+  u_edge_counts = engine.typed_buffer<int>(n);
+  u_edge_offsets = engine.typed_buffer<int>(n);
+
+  u_bounds_ = engine.typed_buffer<glm::vec4>(2 * kBoundsWorkgroups);
+  u_histogram_ = engine.typed_buffer<uint32_t>(n_histogram);
+  u_histogram_scan_ = engine.typed_buffer<uint32_t>(n_histogram);
+  u_block_sums_ = engine.typed_buffer<uint32_t>(
+      n_blocks(static_cast<uint32_t>(std::max(n, n_histogram)),
+               tuning_.scan_threads));
+  u_key_bits_ = engine.typed_buffer<KeyBits>(1);
+  u_radix_plan_ = engine.typed_buffer<DevicePlan>(1);
+  u_counters_ = engine.typed_buffer<Counters>(1);
+  u_counters_->zeros();
+
+  bounds_ = engine.algorithm("aabb.spv",
+                             {u_points, u_bounds_},
+                             sizeof(CountPushConstants),
+                             {kRead, kWrite},
+                             workgroup(tuning_.bounds_threads));
+  bounds_box_ = engine.algorithm("bounds_box.spv",
+                                 {u_bounds_, u_box},
+                                 sizeof(BoundsBoxPushConstants),
+                                 {kRead, kWrite});
+  morton_ = engine.algorithm("morton.spv",
+                             {u_points, u_morton, u_box, u_key_bits_},
+                             sizeof(CountPushConstants),
+                             {kRead, kWrite, kRead, kReadWrite},
+                             workgroup(tuning_.morton_threads));
+  radix_plan_ = engine.algorithm(
+      "radix_plan.spv", {u_key_bits_, u_radix_plan_}, 0, {kRead, kWrite});
+
+  const std::array<std::shared_ptr<Buffer>, 2> keys = {u_morton, u_morton_alt};
+  const SpecConstants sort_spec = {
+      {spec::kWorkgroupSize, tuning_.sort_threads},
+      {spec::kItemsPerThread, tuning_.items_per_thread},
+  };
+  for (int dir = 0; dir < 2; ++dir) {
+    histogram_[dir] =
+        engine.algorithm("radix_histogram.spv",
+                         {keys[dir], u_histogram_, u_radix_plan_},
+                         sizeof(SortPushConstants),
+                         {kRead, kWrite, kRead},
+                         sort_spec);
+    scatter_[dir] = engine.algorithm(
+        "radix_scatter.spv",
+        {keys[dir],
+         keys[1 - dir],
+         u_histogram_,
+         u_histogram_scan_,
+         u_radix_plan_},
+        sizeof(SortPushConstants),
+        {kRead, kWrite, kRead, kRead, kRead},
+        sort_spec);
+  }
+  histogram_scan_ = make_scan(engine, u_histogram_, u_histogram_scan_);
+  copy_keys_ = engine.algorithm("copy_keys.spv",
+                                {u_morton_alt, u_morton, u_radix_plan_},
+                                sizeof(CountPushConstants),
+                                {kRead, kWrite, kRead},
+                                workgroup(tuning_.sort_threads));
+
+  unique_flags_ = engine.algorithm("unique_flags.spv",
+                                   {u_morton, u_edge_counts},
+                                   sizeof(CountPushConstants),
+                                   {kRead, kWrite},
+                                   workgroup(tuning_.unique_threads));
+  edge_scan_ = make_scan(engine, u_edge_counts, u_edge_offsets);
+  unique_scatter_ = engine.algorithm(
+      "unique_scatter.spv",
+      {u_morton, u_edge_counts, u_edge_offsets, u_morton_alt, u_counters_},
+      sizeof(CountPushConstants),
+      {kRead, kRead, kRead, kWrite, kReadWrite},
+      workgroup(tuning_.unique_threads));
+
+  build_radix_tree_ = engine.algorithm(
+      "build_radix_tree.spv",
+      {u_morton_alt, u_brt_nodes, u_parents, u_counters_},
+      0,
+      {kRead, kWrite, kWrite, kRead},
+      workgroup(tuning_.brt_threads));
+  edge_count_ = engine.algorithm(
+      "edge_count.spv",
+      {u_brt_nodes, u_parents, u_edge_counts, u_counters_},
+      sizeof(CountPushConstants),
+      {kRead, kRead, kWrite, kRead},
+      workgroup(tuning_.edge_threads));
+
+  // a first guess, 'run()' grows it to what the edge offsets need. It holds
+  // at least the root.
+  make_octree(std::max(n_points, 1));
+
+  seq_ = engine.sequence();
+}
+
+// The octree arrays for 'capacity' nodes and the kernels that write them
+void Pipe::make_octree(const int capacity) {
+  const auto n = static_cast<size_t>(capacity);
+  oct_capacity_ = capacity;
+
+  u_children = engine_.typed_buffer<std::array<int, 8>>(n);
+  u_corner = engine_.typed_buffer<glm::vec4>(n);
+  u_cell_size = engine_.typed_buffer<float>(n);
+  u_child_node_mask = engine_.typed_buffer<int>(n);
+  u_child_leaf_mask = engine_.typed_buffer<int>(n);
+
+  clear_octree_ = engine_.algorithm("clear_octree.spv",
+                                    {u_child_node_mask, u_child_leaf_mask},
+                                    sizeof(CountPushConstants),
+                                    {kWrite, kWrite},
+                                    workgroup(tuning_.clear_threads));
+  build_octree_ = engine_.algorithm("build_octree.spv",
+                                    {u_children,
+                                     u_corner,
+                                     u_cell_size,
+                                     u_child_node_mask,
+                                     u_edge_offsets,
+                                     u_edge_counts,
+                                     u_morton_alt,
+                                     u_brt_nodes,
+                                     u_parents,
+                                     u_counters_,
+                                     u_box},
+                                    sizeof(CountPushConstants),
+                                    {kWrite,
+                                     kWrite,
+                                     kWrite,
+                                     kReadWrite,
+                                     kRead,
+                                     kRead,
+                                     kRead,
+                                     kRead,
+                                     kRead,
+                                     kReadWrite,
+                                     kRead},
+                                    workgroup(tuning_.octree_threads));
+  link_leaves_ = engine_.algorithm("link_leaves.spv",
+                                   {u_children,
+                                    u_child_leaf_mask,
+                                    u_edge_offsets,
+                                    u_edge_counts,
+                                    u_morton_alt,
+                                    u_brt_nodes,
+                                    u_parents,
+                                    u_counters_},
+                                   sizeof(CountPushConstants),
+                                   {kWrite,
+                                    kReadWrite,
+                                    kRead,
+                                    kRead,
+                                    kRead,
+                                    kRead,
+                                    kRead,
+                                    kRead},
+                                   workgroup(tuning_.octree_threads));
+}
+
+Pipe::Scan Pipe::make_scan(Engine& engine,
+                           const std::shared_ptr<Buffer>& in,
+                           const std::shared_ptr<Buffer>& out) const {
+  return {
+      engine.algorithm("naive_prefix_sum.spv",
+                       {in, out, u_block_sums_},
+                       sizeof(ScanPushConstants),
+                       {kRead, kWrite, kWrite},
+                       workgroup(tuning_.scan_threads)),
+      engine.algorithm("scan_block_sums.spv",
+                       {u_block_sums_},
+                       sizeof(CountPushConstants),
+                       {kReadWrite},
+                       workgroup(tuning_.scan_threads)),
+      engine.algorithm("add_block_offsets.spv",
+                       {u_block_sums_, out},
+                       sizeof(ScanPushConstants),
+                       {kRead, kReadWrite},
+                       workgroup(tuning_.scan_threads)),
+  };
+}
+
+// naive_prefix_sum.comp scans each block, scan_block_sums.comp turns the block
+// totals into offsets and add_block_offsets.comp adds them
+void Pipe::record_scan(const Scan& scan, const uint32_t n) const {
+  const auto block_size = tuning_.scan_threads;
+  const auto blocks = n_blocks(n, block_size);
+  const ScanPushConstants pc = {n, block_size};
+
+  seq_->record_dispatch(scan.local.get(), pc, blocks);
+  seq_->record_dispatch(scan.blocks.get(), CountPushConstants{blocks}, 1);
+  seq_->record_dispatch(scan.add.get(), pc, blocks);
+}
+
+// LSD radix sort over the digits planned by radix_plan.comp, ping-ponging
+// between the two key buffers. The plan is only known on the device, so every
+// pass a 30-bit key may need is recorded and those past 'n_passes' return at
+// once. After an odd number of passes copy_keys.comp moves the keys back to
+// 'u_morton'.
+void Pipe::record_radix_sort() const {
+  const auto n = static_cast<uint32_t>(n_points_);
+  const auto n_tiles = static_cast<uint32_t>(n_tiles_);
+
+  seq_->record_dispatch(radix_plan_.get(), 1);
+
+  for (int pass = 0; pass < kSortPasses; ++pass) {
+    const auto dir = pass % 2;
+    const SortPushConstants pc = {n, static_cast<uint32_t>(pass), n_tiles};
+
+    seq_->record_dispatch(histogram_[dir].get(), pc, n_tiles);
+    // the widest digit, the counts of a narrower one are a prefix of it
+    record_scan(histogram_scan_, kRadix * n_tiles);
+    seq_->record_dispatch(scatter_[dir].get(), pc, n_tiles);
+  }
+
+  seq_->record_dispatch(copy_keys_.get(),
+                        CountPushConstants{n},
+                        n_blocks(n, tuning_.sort_threads));
+}
+
+// The whole frame in one command buffer, the sequence places the barriers from
+// the accesses declared above. Bounds -> morton codes, which also reduce the
+// key bits for the sort's plan -> radix sort -> unique -> radix tree -> edges
+// -> octree.
+void Pipe::record_frame() const {
+  const auto n = static_cast<uint32_t>(n_points_);
+  const CountPushConstants count = {n};
+
+  seq_->cmd_begin();
+
+  seq_->record_dispatch(bounds_.get(), count, kBoundsWorkgroups);
+  const BoundsBoxPushConstants box = {
+      kBoundsWorkgroups,
+      static_cast<uint32_t>(bounds_mode),
+      min_coord_,
+      range_,
+  };
+  seq_->record_dispatch(bounds_box_.get(), box, 1);
+  seq_->record_dispatch(
+      morton_.get(), count, n_blocks(n, tuning_.morton_threads));
+
+  // independent of the sort, so they run together
+  record_clear_octree();
+  record_radix_sort();
+
+  // unique: flags -> positions -> compaction, sets n_unique and n_brt_nodes
+  seq_->record_dispatch(
+      unique_flags_.get(), count, n_blocks(n, tuning_.unique_threads));
+  record_scan(edge_scan_, n);
+  seq_->record_dispatch(
+      unique_scatter_.get(), count, n_blocks(n, tuning_.unique_threads));
+
+  seq_->record_dispatch(build_radix_tree_.get(),
+                        n_blocks(n, tuning_.brt_threads));
+
+  seq_->record_dispatch(
+      edge_count_.get(), count, n_blocks(n, tuning_.edge_threads));
+  record_scan(edge_scan_, n);
+
+  record_build_octree();
+
+  seq_->cmd_end();
+
+  spdlog::debug("vk::Pipe: {} barriers", seq_->n_recorded_barriers());
+}
+
+void Pipe::record_clear_octree() const {
+  const auto capacity = static_cast<uint32_t>(oct_capacity_);
+  seq_->record_dispatch(clear_octree_.get(),
+                        CountPushConstants{capacity},
+                        n_blocks(capacity, tuning_.clear_threads));
+}
+
+void Pipe::record_build_octree() const {
+  const auto n = static_cast<uint32_t>(n_points_);
+  const CountPushConstants capacity = {static_cast<uint32_t>(oct_capacity_)};
+  seq_->record_dispatch(
+      build_octree_.get(), capacity, n_blocks(n, tuning_.octree_threads));
+  seq_->record_dispatch(
+      link_leaves_.get(), capacity, n_blocks(n, tuning_.octree_threads));
+}
+
+void Pipe::submit() const {
+  seq_->launch_kernel_async();
+  seq_->sync();
+}
+
+shared::RadixPlan Pipe::radix_plan() const {
+  const auto& device = u_radix_plan_->at(0);
+  shared::RadixPlan plan;
+  plan.n_passes = static_cast<int>(device.n_passes);
+  for (int pass = 0; pass < plan.n_passes; ++pass) {
+    plan.passes[pass] = {static_cast<int>(device.passes[pass][0]),
+                         static_cast<int>(device.passes[pass][1])};
+  }
+  return plan;
+}
+
+void Pipe::run() {
+  PPL_TRACE_SCOPE("vk::Pipe");
+
+  u_key_bits_->at(0) = {~0u, 0u};
+  record_frame();
+  submit();
+
+  spdlog::debug("vk::Pipe: {} passes, {} unique, {} brt nodes, {} oct nodes",
+                u_radix_plan_->at(0).n_passes,
+                n_unique(),
+                n_brt_nodes(),
+                n_oct_nodes());
+
+  // The octree kernels dropped what did not fit. Everything before them is
+  // done, so grow the arrays and build only the octree again. The capacity
+  // stays, so this only happens until it fits the input's worst frame.
+  const auto required = n_oct_nodes();
+  if (required > oct_capacity_) {
+    make_octree(std::max(required, oct_capacity_ + oct_capacity_ / 2));
+    spdlog::debug("vk::Pipe: octree grown to {} nodes", oct_capacity_);
+
+    seq_->cmd_begin();
+    record_clear_octree();
+    record_build_octree();
+    seq_->cmd_end();
+    submit();
+  }
+}
+
+}  // namespace vk
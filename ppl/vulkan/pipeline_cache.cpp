@@ -0,0 +1,147 @@
+#include "vulkan/pipeline_cache.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "vulkan/vk_helper.hpp"
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+namespace fs = std::filesystem;
+
+PipelineCache::PipelineCache(std::shared_ptr<VkDevice> device_ptr,
+                             const VkPhysicalDevice physical_device,
+                             const fs::path &directory)
+    : VulkanResource<VkPipelineCache>(std::move(device_ptr)) {
+  vkGetPhysicalDeviceProperties(physical_device, &properties_);
+  if (!directory.empty()) {
+    path_ = directory / file_name(properties_);
+  }
+
+  const auto data = load();
+  loaded_size_ = data.size();
+
+  const VkPipelineCacheCreateInfo create_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+      .initialDataSize = data.size(),
+      .pInitialData = data.empty() ? nullptr : data.data(),
+  };
+
+  check_vk_result(vkCreatePipelineCache(
+      *device_ptr_, &create_info, nullptr, &this->get_handle()));
+
+  spdlog::debug("PipelineCache: {} bytes from '{}'",
+                loaded_size_,
+                path_.string());
+}
+
+void PipelineCache::destroy() {
+  spdlog::debug("PipelineCache::destroy()");
+
+  if (handle_ == VK_NULL_HANDLE) {
+    return;
+  }
+  vkDestroyPipelineCache(*device_ptr_, handle_, nullptr);
+  handle_ = VK_NULL_HANDLE;
+}
+
+std::string PipelineCache::file_name(
+    const VkPhysicalDeviceProperties &properties) {
+  std::string uuid;
+  for (const auto byte : properties.pipelineCacheUUID) {
+    uuid += fmt::format("{:02x}", byte);
+  }
+  return fmt::format("pipeline-cache-{:x}-{:x}-{:x}-{}.bin",
+                     properties.vendorID,
+                     properties.deviceID,
+                     properties.driverVersion,
+                     uuid);
+}
+
+bool PipelineCache::is_compatible(
+    const std::vector<std::byte> &data,
+    const VkPhysicalDeviceProperties &properties) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) &&
+         header.headerSize <= data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID,
+                     properties.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+std::vector<std::byte> PipelineCache::load() const {
+  if (path_.empty() || !fs::exists(path_)) {
+    return {};
+  }
+
+  std::ifstream file(path_, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    spdlog::warn("PipelineCache: can not open '{}'", path_.string());
+    return {};
+  }
+
+  std::vector<std::byte> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(data.data()),
+            static_cast<std::streamsize>(data.size()));
+
+  if (file.fail() || !is_compatible(data, properties_)) {
+    spdlog::warn("PipelineCache: ignoring invalid '{}'", path_.string());
+    return {};
+  }
+  return data;
+}
+
+void PipelineCache::save() const {
+  if (path_.empty() || handle_ == VK_NULL_HANDLE) {
+    return;
+  }
+
+  // called from destructors, so failures are only logged
+  size_t size = 0;
+  std::vector<std::byte> data;
+  if (vkGetPipelineCacheData(*device_ptr_, handle_, &size, nullptr) ==
+      VK_SUCCESS) {
+    data.resize(size);
+  }
+  if (data.empty() ||
+      vkGetPipelineCacheData(*device_ptr_, handle_, &size, data.data()) !=
+          VK_SUCCESS) {
+    spdlog::warn("PipelineCache: can not read the cache data");
+    return;
+  }
+  data.resize(size);
+
+  const auto tmp_path = fs::path(path_).concat(".tmp");
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file) {
+      spdlog::warn("PipelineCache: can not write '{}'", tmp_path.string());
+      return;
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmp_path, path_, ec);
+  if (ec) {
+    spdlog::warn("PipelineCache: can not replace '{}': {}",
+                 path_.string(),
+                 ec.message());
+    fs::remove(tmp_path, ec);
+    return;
+  }
+
+  spdlog::debug("PipelineCache: saved {} bytes to '{}'", size, path_.string());
+}
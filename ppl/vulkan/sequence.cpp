@@ -2,6 +2,9 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
+#include "core/trace.hpp"
 #include "vulkan/vk_helper.hpp"
 
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
@@ -51,9 +54,13 @@ void Sequence::create_sync_objects() {
   check_vk_result(vkCreateFence(*device_ptr_, &create_info, nullptr, &fence_));
 }
 
-void Sequence::cmd_begin() const {
+void Sequence::cmd_begin() {
   spdlog::debug("Sequence::cmd_begin()");
 
+  read_.clear();
+  written_.clear();
+  n_barriers_ = 0;
+
   const VkCommandBufferBeginInfo begin_info = {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
       .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
@@ -62,14 +69,80 @@ void Sequence::cmd_begin() const {
   check_vk_result(vkBeginCommandBuffer(this->get_handle(), &begin_info));
 }
 
-void Sequence::cmd_end() const {
+void Sequence::cmd_end() {
   spdlog::debug("Sequence::cmd_end()");
 
+  if (!written_.empty()) {
+    record_compute_barrier();
+  }
+
   check_vk_result(vkEndCommandBuffer(this->get_handle()));
 }
 
+void Sequence::record_dispatch(const Algorithm *algo,
+                               const uint32_t n_blocks) {
+  const auto contains = [](const std::vector<VkBuffer> &buffers,
+                           const VkBuffer buffer) {
+    return std::ranges::find(buffers, buffer) != buffers.end();
+  };
+  const auto &buffers = algo->buffers();
+
+  bool depends = false;
+  for (size_t i = 0; i < buffers.size() && !depends; ++i) {
+    const auto buffer = buffers[i]->get_handle();
+    const auto writes = algo->access(i) != BufferAccess::kRead;
+    depends = contains(written_, buffer) || (writes && contains(read_, buffer));
+  }
+  if (depends) {
+    record_compute_barrier();
+  }
+
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    const auto buffer = buffers[i]->get_handle();
+    const auto access = algo->access(i);
+    if (access != BufferAccess::kWrite && !contains(read_, buffer)) {
+      read_.push_back(buffer);
+    }
+    if (access != BufferAccess::kRead && !contains(written_, buffer)) {
+      written_.push_back(buffer);
+    }
+  }
+
+  algo->record_bind_core(this->get_handle());
+  algo->record_bind_push(this->get_handle());
+  algo->record_dispatch_with_blocks(this->get_handle(), n_blocks);
+}
+
+void Sequence::record_compute_barrier() {
+  spdlog::debug("Sequence::record_compute_barrier()");
+
+  const VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                       VK_ACCESS_HOST_READ_BIT,
+  };
+
+  vkCmdPipelineBarrier(this->get_handle(),
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_HOST_BIT,
+                       0,
+                       1,
+                       &barrier,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr);
+
+  read_.clear();
+  written_.clear();
+  ++n_barriers_;
+}
+
 void Sequence::launch_kernel_async() {
   spdlog::debug("Sequence::launch_kernel_async()");
+  PPL_TRACE_SCOPE("Sequence::launch_kernel_async");
 
   const VkSubmitInfo submit_info = {
       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
@@ -82,6 +155,7 @@ void Sequence::launch_kernel_async() {
 
 void Sequence::sync() const {
   spdlog::debug("Sequence::sync()");
+  PPL_TRACE_SCOPE("Sequence::sync");
 
   check_vk_result(
       vkWaitForFences(*device_ptr_, 1, &fence_, VK_TRUE, UINT64_MAX));
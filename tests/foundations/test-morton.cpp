@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "host/01_morton_impl.hpp"
+#include "host/brt_func.hpp"
+#include "shared/morton_func.h"
+
+namespace {
+
+// A power-of-two cube, so cell corners are exact in single precision
+constexpr float kMin = 0.0f;
+constexpr float kRange = 1024.0f;
+
+}  // namespace
+
+TEST(Morton64Test, SplitAndGatherRoundTrip) {
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<uint32_t> cell(0, (1u << 21) - 1);
+
+  for (int i = 0; i < 100'000; ++i) {
+    const auto a = cell(gen);
+    const auto spread = shared::morton3D_SplitBy3bits64(a);
+    ASSERT_EQ(shared::morton3D_GetThirdBits64(spread), a);
+  }
+  EXPECT_EQ(shared::morton3D_SplitBy3bits64((1u << 21) - 1),
+            0x1249249249249249ull);
+}
+
+TEST(Morton64Test, EncodeDecodeRoundTrip) {
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> coord(kMin, kMin + kRange);
+
+  for (int i = 0; i < 100'000; ++i) {
+    const glm::vec4 p(coord(gen), coord(gen), coord(gen), 1.0f);
+    const auto code = shared::xyz_to_morton64(p, kMin, kRange);
+    ASSERT_LE(code, (uint64_t{1} << morton64_bits) - 1);
+
+    // decoding yields the cell's lower corner, which holds the point and
+    // encodes to the same code
+    glm::vec4 corner;
+    shared::morton64_to_xyz(&corner, code, kMin, kRange);
+    constexpr float cell = kRange / (1u << 21);
+    for (int axis = 0; axis < 3; ++axis) {
+      ASSERT_LE(corner[axis], p[axis]);
+      ASSERT_LT(p[axis] - corner[axis], cell);
+    }
+    ASSERT_EQ(shared::xyz_to_morton64(corner, kMin, kRange), code);
+  }
+}
+
+TEST(Morton64Test, ClampsTheUpperBound) {
+  const glm::vec4 top(kMin + kRange, kMin + kRange, kMin + kRange, 1.0f);
+  EXPECT_EQ(shared::xyz_to_morton64(top, kMin, kRange),
+            (uint64_t{1} << morton64_bits) - 1);
+  EXPECT_EQ(shared::xyz_to_morton64(glm::vec4(kMin, kMin, kMin, 1.0f),
+                                    kMin,
+                                    kRange),
+            0u);
+}
+
+TEST(Morton64Test, RefinesMorton32) {
+  // the top 30 bits of a 63-bit code are the 32-bit code of the same point,
+  // as long as neither is clamped
+  std::mt19937 gen(13);
+  std::uniform_real_distribution<float> coord(kMin, kMin + kRange * 0.999f);
+
+  for (int i = 0; i < 100'000; ++i) {
+    const glm::vec4 p(coord(gen), coord(gen), coord(gen), 1.0f);
+    ASSERT_EQ(shared::xyz_to_morton64(p, kMin, kRange) >> (63 - 30),
+              shared::xyz_to_morton32(p, kMin, kRange));
+  }
+}
+
+TEST(Morton64Test, Delta) {
+  // common prefix length below the unused top bit
+  EXPECT_EQ(cpu::delta(morton64_t{0}, morton64_t{1}), 62);
+  EXPECT_EQ(cpu::delta(morton64_t{0}, uint64_t{1} << 62), 0);
+  EXPECT_EQ(cpu::delta(morton64_t{0x1234} << 30, morton64_t{0x1235} << 30), 32);
+  EXPECT_EQ(cpu::delta(morton_t{0}, morton_t{1}), 29);
+  EXPECT_EQ(cpu::delta(morton_t{0}, morton_t{1} << 29), 0);
+
+  // a 32-bit delta carries over to the 64-bit codes with the same top bits
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<morton_t> code(0, (1u << morton_bits) - 1);
+  for (int i = 0; i < 10'000; ++i) {
+    const auto a = code(gen);
+    const auto b = code(gen);
+    if (a == b) continue;
+    ASSERT_EQ(cpu::delta(morton64_t{a} << 33, morton64_t{b} << 33),
+              cpu::delta(a, b));
+  }
+}
+
+namespace {
+
+constexpr cpu::MortonKernel kKernels[] = {cpu::MortonKernel::kAuto,
+                                          cpu::MortonKernel::kScalar,
+                                          cpu::MortonKernel::kBmi2,
+                                          cpu::MortonKernel::kSse,
+                                          cpu::MortonKernel::kAvx2,
+                                          cpu::MortonKernel::kAvx512,
+                                          cpu::MortonKernel::kNeon};
+
+// A non-cube box, so every axis is quantized with its own scale
+const glm::vec3 kBoxMin(-3.0f, 10.0f, 0.5f);
+const glm::vec3 kBoxRange(7.0f, 0.25f, 1000.0f);
+
+// Random points inside the box, then the box corners, faces and the upper
+// bound itself (which the kernels mask back into 10 bits). An odd count so
+// the vector kernels run their scalar tails.
+std::vector<glm::vec4> kernel_inputs() {
+  std::mt19937 gen(19);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  std::vector<glm::vec4> points;
+  for (int i = 0; i < 10'007; ++i) {
+    points.emplace_back(kBoxMin + kBoxRange * glm::vec3(unit(gen),
+                                                        unit(gen),
+                                                        unit(gen)),
+                        1.0f);
+  }
+  for (int corner = 0; corner < 8; ++corner) {
+    const glm::vec3 t(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+    points.emplace_back(kBoxMin + kBoxRange * t, 1.0f);
+    points.emplace_back(kBoxMin + kBoxRange * t * 0.999999f, 1.0f);
+  }
+  const auto top = kBoxMin + kBoxRange;
+  points.emplace_back(top.x, kBoxMin.y, kBoxMin.z, 1.0f);
+  points.emplace_back(kBoxMin.x, top.y, kBoxMin.z, 1.0f);
+  points.emplace_back(kBoxMin.x, kBoxMin.y, top.z, 1.0f);
+  return points;
+}
+
+std::vector<morton_t> encode_scalar(const std::vector<glm::vec4>& points) {
+  std::vector<morton_t> codes(points.size());
+  cpu::encode_morton32(points.data(),
+                       static_cast<int>(points.size()),
+                       kBoxMin,
+                       kBoxRange,
+                       codes.data(),
+                       cpu::MortonKernel::kScalar);
+  return codes;
+}
+
+}  // namespace
+
+TEST(MortonKernelTest, ScalarMatchesReference) {
+  const auto points = kernel_inputs();
+  const auto codes = encode_scalar(points);
+  for (size_t i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(codes[i],
+              shared::xyz_to_morton32(points[i], kBoxMin, kBoxRange));
+  }
+}
+
+TEST(MortonKernelTest, KernelsMatchScalar) {
+  const auto points = kernel_inputs();
+  const auto expected = encode_scalar(points);
+
+  for (const auto kernel : kKernels) {
+    if (!cpu::morton_kernel_supported(kernel)) continue;
+    SCOPED_TRACE(cpu::morton_kernel_name(kernel));
+
+    // every length up to a few vectors, then the whole input
+    for (int n = 0; n < 40; ++n) {
+      std::vector<morton_t> codes(n);
+      cpu::encode_morton32(
+          points.data(), n, kBoxMin, kBoxRange, codes.data(), kernel);
+      ASSERT_TRUE(std::equal(codes.begin(), codes.end(), expected.begin()))
+          << "n=" << n;
+    }
+
+    std::vector<morton_t> codes(points.size());
+    cpu::encode_morton32(points.data(),
+                         static_cast<int>(points.size()),
+                         kBoxMin,
+                         kBoxRange,
+                         codes.data(),
+                         kernel);
+    ASSERT_EQ(codes, expected);
+  }
+}
+
+TEST(MortonKernelTest, PointLayoutsMatchScalar) {
+  const auto points = kernel_inputs();
+  const auto expected = encode_scalar(points);
+  const auto n = static_cast<int>(points.size());
+
+  std::vector<float> xs, ys, zs;
+  std::vector<glm::vec3> packed;
+  for (const auto& p : points) {
+    xs.push_back(p.x);
+    ys.push_back(p.y);
+    zs.push_back(p.z);
+    packed.emplace_back(p.x, p.y, p.z);
+  }
+
+  for (const auto kernel : kKernels) {
+    if (!cpu::morton_kernel_supported(kernel)) continue;
+    SCOPED_TRACE(cpu::morton_kernel_name(kernel));
+
+    for (const int len : {0, 1, 3, 5, 15, 17, 33, n}) {
+      std::vector<morton_t> soa(len);
+      cpu::encode_morton32_soa(xs.data(),
+                               ys.data(),
+                               zs.data(),
+                               len,
+                               kBoxMin,
+                               kBoxRange,
+                               soa.data(),
+                               kernel);
+      ASSERT_TRUE(std::equal(soa.begin(), soa.end(), expected.begin()))
+          << "soa, n=" << len;
+
+      std::vector<morton_t> packed3(len);
+      cpu::encode_morton32_packed3(
+          packed.data(), len, kBoxMin, kBoxRange, packed3.data(), kernel);
+      ASSERT_TRUE(std::equal(packed3.begin(), packed3.end(), expected.begin()))
+          << "packed3, n=" << len;
+    }
+  }
+}
+
+TEST(MortonKernelTest, UnsupportedKernelThrows) {
+  for (const auto kernel : kKernels) {
+    if (cpu::morton_kernel_supported(kernel)) continue;
+    glm::vec4 point(0.0f);
+    morton_t code;
+    EXPECT_THROW(cpu::encode_morton32(
+                     &point, 1, kBoxMin, kBoxRange, &code, kernel),
+                 std::invalid_argument);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,536 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/arena.hpp"
+#include "core/thread_pool.hpp"
+#include "host/autotune.hpp"
+#include "host/frame_pipeline.hpp"
+#include "host/fused_pipeline.hpp"
+#include "host/host_dispatcher.hpp"
+
+namespace {
+
+constexpr int kThreads = 4;
+
+// A frame of 'n' copies of the same point, so at most one unique key
+std::shared_ptr<Pipe> degenerate_frame(const int n) {
+  auto p = std::make_shared<Pipe>(1024);
+  p->reset(n);
+  for (int i = 0; i < n; ++i) {
+    p->u_points[i] = glm::vec4(12.0f, 34.0f, 56.0f, 1.0f);
+  }
+  return p;
+}
+
+template <shared::BrtLayout Layout = shared::BrtLayout::kSoA>
+void run_staged(core::thread_pool& pool,
+                const std::shared_ptr<Pipe>& p,
+                const int n_threads = kThreads) {
+  cpu::dispatch_ComputeBounds(pool, n_threads, p);
+  cpu::dispatch_MortonCode(pool, n_threads, p);
+  cpu::dispatch_RadixSortAndRemoveDuplicates(pool, n_threads, p);
+  cpu::dispatch_BuildRadixTree<Layout>(pool, n_threads, p);
+  cpu::dispatch_EdgeCountAndOffset<Layout>(pool, n_threads, p);
+  cpu::dispatch_BuildOctree<Layout>(pool, n_threads, p);
+}
+
+// Radix tree node 'i' of 'p', in whichever layout the tree is allocated in
+struct BrtNode {
+  int prefix_n;
+  int left_child;
+  bool has_leaf_left;
+  bool has_leaf_right;
+  int parent;
+};
+
+BrtNode brt_node(const Pipe& p, const int i) {
+  const auto node = [i](const auto brt) {
+    return BrtNode{brt.prefix_n(i),
+                   brt.left_child(i),
+                   brt.has_leaf_left(i),
+                   brt.has_leaf_right(i),
+                   brt.parent(i)};
+  };
+  return p.brt.layout == shared::BrtLayout::kPacked
+             ? node(p.brt.view<shared::BrtLayout::kPacked>())
+             : node(p.brt.view<shared::BrtLayout::kSoA>());
+}
+
+// One point in each of the first 'n_keys' cells along x, so 'n_keys' unique
+// keys, every one repeated 'copies' times
+std::shared_ptr<Pipe> few_keys_frame(const int n_keys, const int copies) {
+  auto p = std::make_shared<Pipe>(1024);
+  p->reset(n_keys * copies);
+  for (int i = 0; i < n_keys * copies; ++i) {
+    const auto x = static_cast<float>(i % n_keys) * 64.0f + 1.0f;
+    p->u_points[i] = glm::vec4(x, 1.0f, 1.0f, 1.0f);
+  }
+  return p;
+}
+
+// every node has a parent inside the tree (the root is its own), and no edge
+// count is negative
+void expect_valid_tree(const Pipe& p) {
+  const auto n_brt_nodes = p.n_brt_nodes();
+  for (int i = 0; i < n_brt_nodes; ++i) {
+    EXPECT_GE(brt_node(p, i).parent, 0) << i;
+    EXPECT_LT(brt_node(p, i).parent, n_brt_nodes) << i;
+    EXPECT_GE(p.u_edge_counts[i], 0) << i;
+  }
+  if (n_brt_nodes > 0) {
+    EXPECT_EQ(p.n_oct_nodes(), p.u_edge_offsets[n_brt_nodes - 1] + 1);
+  }
+}
+
+// 'n' random points in the default cube
+std::shared_ptr<Pipe> random_frame(const int n, const unsigned seed) {
+  auto p = std::make_shared<Pipe>(n);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dis(0.0f, 1024.0f);
+  for (int i = 0; i < n; ++i) {
+    p->u_points[i] = glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f);
+  }
+  return p;
+}
+
+// Every third point repeats the one before it, so the sort has duplicates
+// to remove
+std::shared_ptr<Pipe> random_frame_with_duplicates(const int n,
+                                                   const unsigned seed) {
+  auto p = random_frame(n, seed);
+  for (int i = 1; i < n; i += 3) p->u_points[i] = p->u_points[i - 1];
+  return p;
+}
+
+// The same keys, tree, edges and octree. Every octnode but the root (0) has its
+// cell written once, by the radix tree node that adds it, and a child slot is
+// only compared where the mask says it is set.
+void expect_same_octree(const Pipe& a, const Pipe& b) {
+  ASSERT_EQ(a.n_unique_mortons(), b.n_unique_mortons());
+  ASSERT_EQ(a.n_brt_nodes(), b.n_brt_nodes());
+  ASSERT_EQ(a.n_oct_nodes(), b.n_oct_nodes());
+  for (int i = 0; i < a.n_unique_mortons(); ++i) {
+    ASSERT_EQ(a.u_morton_alt[i], b.u_morton_alt[i]) << i;
+  }
+  for (int i = 0; i < a.n_brt_nodes(); ++i) {
+    const auto a_node = brt_node(a, i);
+    const auto b_node = brt_node(b, i);
+    ASSERT_EQ(a_node.prefix_n, b_node.prefix_n) << i;
+    ASSERT_EQ(a_node.left_child, b_node.left_child) << i;
+    ASSERT_EQ(a_node.has_leaf_left, b_node.has_leaf_left) << i;
+    ASSERT_EQ(a_node.has_leaf_right, b_node.has_leaf_right) << i;
+    ASSERT_EQ(a_node.parent, b_node.parent) << i;
+    ASSERT_EQ(a.u_edge_counts[i], b.u_edge_counts[i]) << i;
+    ASSERT_EQ(a.u_edge_offsets[i], b.u_edge_offsets[i]) << i;
+  }
+  for (int i = 0; i < a.n_oct_nodes(); ++i) {
+    ASSERT_EQ(a.oct.u_child_node_mask[i], b.oct.u_child_node_mask[i]) << i;
+    ASSERT_EQ(a.oct.u_child_leaf_mask[i], b.oct.u_child_leaf_mask[i]) << i;
+    for (int c = 0; c < 8; ++c) {
+      if (a.oct.u_child_node_mask[i] & (1 << c)) {
+        ASSERT_EQ(a.oct.u_children[i][c], b.oct.u_children[i][c]) << i;
+      }
+    }
+    if (i == 0) continue;
+    ASSERT_EQ(a.oct.u_corner[i], b.oct.u_corner[i]) << i;
+    ASSERT_EQ(a.oct.u_cell_size[i], b.oct.u_cell_size[i]) << i;
+  }
+}
+
+// a plan file of its own, removed at the end of the test
+class PlanFile {
+ public:
+  explicit PlanFile(const std::string& name)
+      : path_((std::filesystem::temp_directory_path() / name).string()) {
+    std::remove(path_.c_str());
+  }
+  ~PlanFile() { std::remove(path_.c_str()); }
+
+  [[nodiscard]] const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// Runs 'tuner' to the end with made-up timings: each phase is fastest on
+// the candidate whose index is the phase's, modulo the candidates.
+void tune(cpu::PipelineTuner& tuner, const int n_candidates) {
+  for (int frame = 0; !tuner.tuned(); ++frame) {
+    const auto candidate = frame / 2;
+    const auto ms = [&](const int phase) {
+      return candidate == phase % n_candidates ? 1.0 : 2.0;
+    };
+    cpu::PipelineTimings t;
+    t.morton_ms = ms(0);
+    t.sort_unique_ms = ms(1);
+    t.radix_tree_ms = ms(2);
+    t.edge_ms = ms(3);
+    t.octree_ms = ms(4);
+    tuner.record(t);
+  }
+}
+
+}  // namespace
+
+// An empty frame and a single-key one have no radix tree and no octree
+TEST(DegenerateFrame, Staged) {
+  core::thread_pool pool(kThreads);
+  for (const int n : {0, 1, 1000}) {
+    const auto p = degenerate_frame(n);
+    run_staged(pool, p);
+    EXPECT_EQ(p->n_unique_mortons(), n > 0 ? 1 : 0) << "n=" << n;
+    EXPECT_EQ(p->n_brt_nodes(), 0) << "n=" << n;
+    EXPECT_EQ(p->n_oct_nodes(), 0) << "n=" << n;
+  }
+}
+
+TEST(DegenerateFrame, Fused) {
+  core::thread_pool pool(kThreads);
+  for (const int n : {0, 1, 1000}) {
+    const auto p = degenerate_frame(n);
+    cpu::run_fused_pipeline(pool, kThreads, p);
+    EXPECT_EQ(p->n_unique_mortons(), n > 0 ? 1 : 0) << "n=" << n;
+    EXPECT_EQ(p->n_brt_nodes(), 0) << "n=" << n;
+    EXPECT_EQ(p->n_oct_nodes(), 0) << "n=" << n;
+  }
+}
+
+// The smallest radix trees, a root with two leaves and a root with one inner
+// node, on fresh arrays and on arrays a larger frame left behind
+TEST(FewKeysFrame, Staged) {
+  core::thread_pool pool(kThreads);
+  for (const int n_keys : {2, 3, 4, 5}) {
+    const auto p = few_keys_frame(n_keys, 3);
+    run_staged(pool, p);
+    EXPECT_EQ(p->n_unique_mortons(), n_keys) << "keys=" << n_keys;
+    EXPECT_EQ(p->n_brt_nodes(), n_keys - 1) << "keys=" << n_keys;
+    expect_valid_tree(*p);
+  }
+}
+
+TEST(FewKeysFrame, Fused) {
+  core::thread_pool pool(kThreads);
+  for (const int n_keys : {2, 3, 4, 5}) {
+    const auto p = few_keys_frame(n_keys, 3);
+    cpu::run_fused_pipeline(pool, kThreads, p);
+    EXPECT_EQ(p->n_unique_mortons(), n_keys) << "keys=" << n_keys;
+    EXPECT_EQ(p->n_brt_nodes(), n_keys - 1) << "keys=" << n_keys;
+    expect_valid_tree(*p);
+  }
+}
+
+TEST(FewKeysFrame, AfterRegularFrame) {
+  core::thread_pool pool(kThreads);
+  const auto p = random_frame(1000, 3);
+  cpu::run_fused_pipeline(pool, kThreads, p);
+  for (const int n_keys : {2, 3}) {
+    p->reset(n_keys);
+    for (int i = 0; i < n_keys; ++i) {
+      p->u_points[i] =
+          glm::vec4(static_cast<float>(i) * 64.0f + 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    cpu::run_fused_pipeline(pool, kThreads, p);
+    EXPECT_EQ(p->n_brt_nodes(), n_keys - 1) << "keys=" << n_keys;
+    expect_valid_tree(*p);
+  }
+}
+
+// the arrays of an empty frame are reused by the next, regular one
+TEST(DegenerateFrame, ThenRegularFrame) {
+  constexpr int kN = 1000;
+  const auto fill = [](Pipe& p) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dis(0.0f, 1024.0f);
+    for (int i = 0; i < kN; ++i) {
+      p.u_points[i] = glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f);
+    }
+  };
+
+  core::thread_pool pool(kThreads);
+  const auto p = degenerate_frame(0);
+  cpu::run_fused_pipeline(pool, kThreads, p);
+  p->reset(kN);
+  fill(*p);
+  cpu::run_fused_pipeline(pool, kThreads, p);
+
+  const auto fresh = std::make_shared<Pipe>(kN);
+  fill(*fresh);
+  cpu::run_fused_pipeline(pool, kThreads, fresh);
+
+  EXPECT_EQ(p->n_unique_mortons(), fresh->n_unique_mortons());
+  EXPECT_EQ(p->n_brt_nodes(), fresh->n_brt_nodes());
+  EXPECT_EQ(p->n_oct_nodes(), fresh->n_oct_nodes());
+}
+
+// On an arena, an octree that outgrows its arrays leaves the old ones in the
+// arena until the next reset carves everything again, so a stream of frames
+// does not keep mapping memory.
+TEST(ArenaPipe, OutgrownOctreeIsCarvedAgain) {
+  constexpr int kN = 20'000;
+  const auto fill = [](Pipe& p, const float extent) {
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dis(0.0f, extent);
+    for (int i = 0; i < kN; ++i) {
+      p.u_points[i] = glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f);
+    }
+  };
+
+  core::thread_pool pool(kThreads);
+  const auto p = std::make_shared<Pipe>(
+      kN, 0.0f, 1024.0f, 114514, core::arena_options{core::huge_pages::kNone});
+  p->bounds_mode = shared::BoundsMode::kFixed;
+
+  // a few cells only, then the whole cube: the second octree is larger
+  fill(*p, 4.0f);
+  cpu::run_fused_pipeline(pool, kThreads, p);
+  p->reset(kN);
+  fill(*p, 1024.0f);
+  cpu::run_fused_pipeline(pool, kThreads, p);
+  ASSERT_GT(p->oct.abandoned_bytes, 0u);
+
+  p->reset(kN);
+  EXPECT_EQ(p->oct.abandoned_bytes, 0u);
+  const auto mapped = p->arena->bytes_mapped();
+  for (int frame = 0; frame < 3; ++frame) {
+    fill(*p, 1024.0f);
+    cpu::run_fused_pipeline(pool, kThreads, p);
+    EXPECT_EQ(p->oct.abandoned_bytes, 0u);
+    p->reset(kN);
+    EXPECT_EQ(p->arena->bytes_mapped(), mapped);
+  }
+}
+
+// A tuned plan is saved, and a tuner for the same device and clusters loads
+// it instead of tuning again. Other devices keep their plans.
+TEST(PipelineTuner, PlanRoundTrips) {
+  const PlanFile file("ppl-test-plans.txt");
+
+  // candidates: {0,1} {0,2} {1,1} {1,2} {1,3}
+  const std::vector<int> clusters = {2, 3};
+  cpu::PipelineTuner tuner("device-a", clusters, file.path());
+  ASSERT_FALSE(tuner.tuned());
+  tune(tuner, 5);
+  const cpu::PipelinePlan expected = {{{0, 1}, {0, 2}, {1, 1}, {1, 2}, {1, 3}}};
+  EXPECT_EQ(tuner.plan(), expected);
+
+  cpu::PipelineTuner other("device-b", clusters, file.path());
+  tune(other, 5);
+
+  const cpu::PipelineTuner loaded("device-a", clusters, file.path());
+  EXPECT_TRUE(loaded.tuned());
+  EXPECT_EQ(loaded.plan(), expected);
+
+  // other clusters, the saved plan does not apply
+  const cpu::PipelineTuner resized("device-a", {2, 4}, file.path());
+  EXPECT_FALSE(resized.tuned());
+}
+
+// The fused pipeline on four threads builds the octree the staged calls
+// build on one, duplicates included
+TEST(FusedPipeline, MatchesStaged) {
+  constexpr int kN = 300'000;
+  core::thread_pool pool(kThreads);
+
+  const auto staged = random_frame_with_duplicates(kN, 11);
+  run_staged(pool, staged, 1);
+  const auto fused = random_frame_with_duplicates(kN, 11);
+  cpu::run_fused_pipeline(pool, kThreads, fused);
+
+  ASSERT_LT(staged->n_unique_mortons(), kN);
+  expect_same_octree(*fused, *staged);
+}
+
+// Only the arrays of the layout in use are allocated, and the stages refuse
+// the other layout
+TEST(BrtLayout, AllocatesOnlyTheLayoutInUse) {
+  core::thread_pool pool(kThreads);
+  const auto p = random_frame(1000, 7);
+  EXPECT_NE(p->brt.u_prefix_n, nullptr);
+  EXPECT_EQ(p->brt.u_nodes, nullptr);
+
+  p->use_brt_layout(shared::BrtLayout::kPacked);
+  EXPECT_EQ(p->brt.u_prefix_n, nullptr);
+  EXPECT_EQ(p->brt.u_left_child, nullptr);
+  EXPECT_NE(p->brt.u_nodes, nullptr);
+  EXPECT_NE(p->brt.u_parents, nullptr);
+  EXPECT_THROW(run_staged(pool, p), std::runtime_error);
+
+  // still one layout after the arrays grow
+  p->reset(5000);
+  EXPECT_EQ(p->brt.u_prefix_n, nullptr);
+  EXPECT_NE(p->brt.u_nodes, nullptr);
+}
+
+// The packed tree gives the same tree, edges and octree as the SoA one,
+// staged and fused
+TEST(BrtLayout, PackedMatchesSoA) {
+  constexpr int kN = 100'000;
+  core::thread_pool pool(kThreads);
+
+  const auto soa = random_frame_with_duplicates(kN, 13);
+  run_staged(pool, soa);
+
+  const auto packed = random_frame_with_duplicates(kN, 13);
+  packed->use_brt_layout(shared::BrtLayout::kPacked);
+  run_staged<shared::BrtLayout::kPacked>(pool, packed);
+  expect_same_octree(*packed, *soa);
+
+  const auto fused = random_frame_with_duplicates(kN, 13);
+  fused->use_brt_layout(shared::BrtLayout::kPacked);
+  cpu::run_fused_pipeline(pool, kThreads, fused);
+  expect_same_octree(*fused, *soa);
+}
+
+// The same octree whether the phases run on one pool or across two
+TEST(PipelineTuner, MultiClusterMatchesSinglePool) {
+  constexpr int kN = 50'000;
+  core::thread_pool big(3);
+  core::thread_pool little(2);
+  core::thread_pool* const clusters[] = {&big, &little};
+  const cpu::PipelinePlan plan = {{{1, 2}, {0, 3}, {1, 1}, {0, 2}, {1, 2}}};
+
+  const auto single = random_frame(kN, 5);
+  cpu::run_fused_pipeline(big, 3, single);
+  const auto split = random_frame(kN, 5);
+  cpu::run_fused_pipeline(
+      std::span<core::thread_pool* const>(clusters), plan, split);
+
+  expect_same_octree(*split, *single);
+}
+
+namespace {
+
+using Cluster = cpu::StageCluster<core::thread_pool>;
+
+// 'k' pipes smaller than the frames, so the first frames grow them
+std::vector<std::shared_ptr<Pipe>> make_pipes(const int k) {
+  std::vector<std::shared_ptr<Pipe>> pipes;
+  for (int i = 0; i < k; ++i) pipes.push_back(std::make_shared<Pipe>(100));
+  return pipes;
+}
+
+// Frame 'frame' of the runs below, a size of its own every frame
+std::shared_ptr<Pipe> input_frame(const int frame) {
+  return random_frame_with_duplicates(2000 + 700 * (frame % 5), 100 + frame);
+}
+
+void fill_from(Pipe& p, const Pipe& input) {
+  p.reset(input.n_input());
+  std::copy_n(input.u_points, input.n_input(), p.u_points);
+}
+
+}  // namespace
+
+TEST(FramePipeline, ConsumesInOrder) {
+  constexpr int kFrames = 12;
+  core::thread_pool front_pool(2);
+  core::thread_pool back_pool(2);
+  const auto pipes = make_pipes(3);
+
+  std::vector<int> consumed;
+  const auto stats = cpu::run_frame_pipeline(
+      Cluster{front_pool, 2},
+      Cluster{back_pool, 2},
+      std::span<const std::shared_ptr<Pipe>>(pipes),
+      kFrames,
+      [](Pipe& p, const int frame) { fill_from(p, *input_frame(frame)); },
+      [&](const Pipe&, const int frame) { consumed.push_back(frame); });
+
+  ASSERT_EQ(consumed.size(), static_cast<size_t>(kFrames));
+  for (int i = 0; i < kFrames; ++i) EXPECT_EQ(consumed[i], i);
+  EXPECT_EQ(stats.n_frames, kFrames);
+  EXPECT_EQ(stats.latency_ms.size(), static_cast<size_t>(kFrames));
+}
+
+// K pipes over many more frames of changing sizes, every frame's octree the
+// one the staged calls build for it alone. Both halves share one pool.
+TEST(FramePipeline, ReusedPipesMatchStaged) {
+  constexpr int kPipes = 2;
+  constexpr int kFrames = 9;
+  core::thread_pool pool(kThreads);
+
+  std::vector<std::shared_ptr<Pipe>> inputs;
+  std::vector<std::shared_ptr<Pipe>> expected;
+  for (int frame = 0; frame < kFrames; ++frame) {
+    inputs.push_back(input_frame(frame));
+    expected.push_back(input_frame(frame));
+    run_staged(pool, expected.back());
+  }
+
+  const auto pipes = make_pipes(kPipes);
+  int n_consumed = 0;
+  cpu::run_frame_pipeline(
+      Cluster{pool, kThreads},
+      Cluster{pool, kThreads},
+      std::span<const std::shared_ptr<Pipe>>(pipes),
+      kFrames,
+      [&](Pipe& p, const int frame) { fill_from(p, *inputs[frame]); },
+      [&](const Pipe& p, const int frame) {
+        expect_same_octree(p, *expected[frame]);
+        ++n_consumed;
+      });
+  EXPECT_EQ(n_consumed, kFrames);
+}
+
+// The first exception of either half stops both and is rethrown, after the
+// frames before it were consumed in order
+TEST(FramePipeline, ExceptionStopsBothHalves) {
+  constexpr int kPipes = 2;
+  constexpr int kFrames = 100;
+  constexpr int kFailing = 3;
+  core::thread_pool front_pool(2);
+  core::thread_pool back_pool(2);
+
+  for (const bool in_fill : {true, false}) {
+    const auto pipes = make_pipes(kPipes);
+    std::mutex mutex;
+    int n_filled = 0;
+    std::vector<int> consumed;
+    const auto fill = [&](Pipe& p, const int frame) {
+      {
+        std::lock_guard lock(mutex);
+        ++n_filled;
+      }
+      if (in_fill && frame == kFailing) throw std::runtime_error("fill");
+      fill_from(p, *input_frame(frame));
+    };
+    const auto consume = [&](const Pipe&, const int frame) {
+      if (!in_fill && frame == kFailing) throw std::runtime_error("consume");
+      consumed.push_back(frame);
+    };
+
+    EXPECT_THROW(cpu::run_frame_pipeline(
+                     Cluster{front_pool, 2},
+                     Cluster{back_pool, 2},
+                     std::span<const std::shared_ptr<Pipe>>(pipes),
+                     kFrames,
+                     fill,
+                     consume),
+                 std::runtime_error)
+        << (in_fill ? "fill" : "consume");
+
+    // the back half stopped at the failing frame, the front at most the
+    // pipes' worth of frames after it
+    ASSERT_LE(consumed.size(), static_cast<size_t>(kFailing));
+    for (size_t i = 0; i < consumed.size(); ++i) {
+      EXPECT_EQ(consumed[i], static_cast<int>(i));
+    }
+    if (!in_fill) EXPECT_EQ(consumed.size(), static_cast<size_t>(kFailing));
+    EXPECT_LE(n_filled, kFailing + kPipes + 1);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "core/thread_pool.hpp"
+#include "host/02_sort_impl.hpp"
+
+namespace {
+
+constexpr int kN = 100'003;
+constexpr size_t kMaxThreads = 8;
+constexpr size_t kThreadCounts[] = {1, 2, 3, 8};
+constexpr cpu::ScatterMode kModes[] = {cpu::ScatterMode::kDirect,
+                                       cpu::ScatterMode::kWriteCombining};
+
+template <typename Key>
+std::vector<Key> random_keys(const int n, const Key mask, const unsigned seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<Key> keys(n);
+  std::generate(keys.begin(), keys.end(), [&] {
+    return static_cast<Key>(gen()) & mask;
+  });
+  return keys;
+}
+
+// The inputs every sort test runs on: random over all key bits, random with
+// constant low and high bits (skipped digits), a single value, and already
+// sorted keys
+template <typename Key>
+std::vector<std::vector<Key>> inputs(const Key key_mask) {
+  auto sorted = random_keys<Key>(kN, key_mask, 3);
+  std::sort(sorted.begin(), sorted.end());
+
+  return {
+      random_keys<Key>(kN, key_mask, 1),
+      random_keys<Key>(kN, key_mask & ~Key{0xff} & (key_mask >> 4), 2),
+      std::vector<Key>(kN, Key{0x1234}),
+      sorted,
+  };
+}
+
+template <typename Key>
+void check_sort(const Key key_mask) {
+  core::thread_pool pool(kMaxThreads);
+
+  for (const auto& input : inputs(key_mask)) {
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (const auto n_threads : kThreadCounts) {
+      for (const auto mode : kModes) {
+        auto keys = input;
+        std::vector<Key> alt(kN);
+        cpu::dispatch_parallel_radix_sort(
+            pool, n_threads, kN, keys.data(), alt.data(), mode);
+        ASSERT_EQ(keys, expected) << "n_threads=" << n_threads;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ParallelRadixSortTest, MatchesStdSort32) {
+  check_sort<morton_t>((1u << morton_bits) - 1);
+}
+
+TEST(ParallelRadixSortTest, MatchesStdSort64) {
+  check_sort<morton64_t>((uint64_t{1} << morton64_bits) - 1);
+}
+
+TEST(ParallelRadixSortTest, KeyValueReturnsPermutation) {
+  core::thread_pool pool(kMaxThreads);
+
+  for (const auto& input : inputs<morton_t>((1u << morton_bits) - 1)) {
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (const auto n_threads : kThreadCounts) {
+      for (const auto mode : kModes) {
+        auto keys = input;
+        std::vector<morton_t> alt(kN);
+        std::vector<uint32_t> index(kN);
+        std::vector<uint32_t> index_alt(kN);
+        cpu::dispatch_parallel_radix_sort_kv(pool,
+                                             n_threads,
+                                             kN,
+                                             keys.data(),
+                                             alt.data(),
+                                             index.data(),
+                                             index_alt.data(),
+                                             mode);
+        ASSERT_EQ(keys, expected) << "n_threads=" << n_threads;
+
+        // a permutation, pointing at the original key of every position
+        auto seen = index;
+        std::sort(seen.begin(), seen.end());
+        for (int i = 0; i < kN; ++i) {
+          ASSERT_EQ(seen[i], static_cast<uint32_t>(i));
+          ASSERT_EQ(input[index[i]], keys[i]);
+        }
+      }
+    }
+  }
+}
+
+TEST(ParallelRadixSortTest, UniqueMatchesStdUnique) {
+  core::thread_pool pool(kMaxThreads);
+
+  // few distinct values, so runs cross block and bucket boundaries
+  for (const auto& input : inputs<morton_t>(0x3f0f)) {
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()),
+                   expected.end());
+
+    for (const auto n_threads : kThreadCounts) {
+      for (const auto mode : kModes) {
+        auto keys = input;
+        std::vector<morton_t> alt(kN);
+        const auto n_unique = cpu::dispatch_parallel_radix_sort_unique(
+            pool, n_threads, kN, keys.data(), alt.data(), mode);
+        ASSERT_EQ(n_unique, static_cast<int>(expected.size()))
+            << "n_threads=" << n_threads;
+        ASSERT_TRUE(std::equal(expected.begin(), expected.end(), alt.begin()));
+      }
+    }
+  }
+}
+
+// the blocks follow the pool's partition: one per worker sized by its weight,
+// or equal ones for the sort's cooperating passes under kDynamic
+TEST(ParallelRadixSortTest, MatchesStdSortUnderPartitions) {
+  core::thread_pool pool(kMaxThreads);
+  pool.set_worker_weights({1.0, 1.0, 1.0, 1.0, 0.5, 0.5, 0.25, 0.25});
+
+  for (const auto partition : {core::thread_pool::partition::kWeighted,
+                               core::thread_pool::partition::kDynamic}) {
+    pool.set_partition(partition);
+    for (const auto& input : inputs<morton_t>(0x3fff'ffff)) {
+      auto expected = input;
+      std::sort(expected.begin(), expected.end());
+      auto unique = expected;
+      unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+      for (const auto n_threads : kThreadCounts) {
+        auto keys = input;
+        std::vector<morton_t> alt(kN);
+        const auto n_unique = cpu::dispatch_parallel_radix_sort_unique(
+            pool, n_threads, kN, keys.data(), alt.data());
+        ASSERT_EQ(keys, expected) << "n_threads=" << n_threads;
+        ASSERT_EQ(n_unique, static_cast<int>(unique.size()));
+        ASSERT_TRUE(std::equal(unique.begin(), unique.end(), alt.begin()));
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
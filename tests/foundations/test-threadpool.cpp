@@ -1,10 +1,12 @@
 #include <gtest/gtest.h>
 
 #include <atomic>
+#include <numeric>
 
 // #include "third-party/BS_thread_pool.hpp"
 
 #include "core/thread_pool.hpp"
+#include "core/work_stealing_pool.hpp"
 
 // Test case for verifying the thread pool functionality
 TEST(ThreadPoolTest, BasicTaskSubmission) {
@@ -28,6 +30,254 @@ TEST(ThreadPoolTest, BasicTaskSubmission) {
   EXPECT_EQ(counter.load(), 10);
 }
 
+TEST(ThreadPoolTest, ParallelForCoversRange) {
+  core::thread_pool pool(3);
+
+  constexpr int n = 100'003;
+  std::vector<int> data(n, 0);
+
+  // back-to-back regions, with more and with fewer blocks than members
+  for (const size_t num_blocks : {0, 1, 2, 7, 1000}) {
+    pool.parallel_for(
+        0,
+        n,
+        [&data](const int start, const int end) {
+          for (int i = start; i < end; ++i) ++data[i];
+        },
+        num_blocks);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(data[i], 5) << "at index " << i;
+  }
+}
+
+TEST(ThreadPoolTest, PartitionedBlocksCoverRange) {
+  core::thread_pool pool(3);
+  pool.set_worker_weights({1.0, 2.5, 0.5});
+
+  constexpr int n = 100'003;
+  std::vector<int> data(n, 0);
+
+  for (const auto mode : {core::thread_pool::partition::kWeighted,
+                          core::thread_pool::partition::kDynamic}) {
+    pool.set_partition(mode);
+    // fewer blocks than workers, one per worker, more than workers
+    for (const size_t num_blocks : {0, 1, 2, 7, 1000}) {
+      pool.submit_blocks(
+              0,
+              n,
+              [&data](const int start, const int end) {
+                for (int i = start; i < end; ++i) ++data[i];
+              },
+              num_blocks)
+          .wait();
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(data[i], 10) << "at index " << i;
+  }
+
+  // blocks with a result stay equal, one future per block
+  auto sizes = pool.submit_blocks(
+      0, 10, [](const int start, const int end) { return end - start; }, 5);
+  ASSERT_EQ(sizes.futures.size(), 5u);
+  for (auto& size : sizes.futures) {
+    EXPECT_EQ(size.get(), 2);
+  }
+}
+
+// one share per weight, sized by it, none empty while there are enough
+TEST(ThreadPoolTest, WeightedBounds) {
+  const std::vector<double> weights = {1.0, 2.5, 0.5};
+
+  const auto bounds = core::thread_pool::weighted_bounds(0, 4000, weights);
+  EXPECT_EQ(bounds, (std::vector<int>{0, 1000, 3500, 4000}));
+
+  const auto tiny = core::thread_pool::weighted_bounds(0, 3, {1.0, 100.0, 1.0});
+  EXPECT_EQ(tiny, (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST(ThreadPoolTest, WorkerWeights) {
+  core::thread_pool pool(2);
+
+  EXPECT_THROW(pool.set_worker_weights({1.0}), std::invalid_argument);
+  EXPECT_THROW(pool.set_worker_weights({1.0, 0.0}), std::invalid_argument);
+
+  const auto weights = pool.calibrate_weights();
+  ASSERT_EQ(weights.size(), 2u);
+  for (const double w : weights) {
+    EXPECT_GT(w, 0.0);
+    EXPECT_LE(w, 1.0);
+  }
+  pool.set_worker_weights(weights);
+  EXPECT_EQ(pool.get_worker_weights(), weights);
+}
+
+TEST(ThreadPoolTest, ParallelForMixedWithTasks) {
+  core::thread_pool pool(2);
+
+  std::atomic<int> counter(0);
+
+  for (int round = 0; round < 100; ++round) {
+    pool.parallel_for(0, 64, [&counter](const int start, const int end) {
+      counter += end - start;
+    });
+    pool.submit_task([&counter] { ++counter; }).wait();
+  }
+
+  EXPECT_EQ(counter.load(), 100 * 65);
+}
+
+TEST(ThreadPoolTest, ParallelForRethrows) {
+  core::thread_pool pool(2);
+
+  EXPECT_THROW(pool.parallel_for(
+                   0,
+                   4,
+                   [](const int start, int) {
+                     if (start != 0) throw std::runtime_error("block failed");
+                   },
+                   4),
+               std::runtime_error);
+
+  // the team is still usable afterwards
+  std::atomic<int> counter(0);
+  pool.parallel_for(0, 10, [&counter](const int start, const int end) {
+    counter += end - start;
+  });
+  EXPECT_EQ(counter.load(), 10);
+}
+
+TEST(WorkStealingPoolTest, BasicTaskSubmission) {
+  core::work_stealing_pool pool({0, 1, 2});
+
+  std::atomic<int> counter(0);
+
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 10; ++i) {
+    futures.push_back(pool.submit_task([&counter] { counter++; }));
+  }
+
+  for (auto& future : futures) {
+    future.wait();
+  }
+
+  EXPECT_EQ(counter.load(), 10);
+}
+
+TEST(WorkStealingPoolTest, SubmitBlocksCoversRange) {
+  core::work_stealing_pool pool(4);
+
+  constexpr int n = 100'003;
+  std::vector<int> data(n, 0);
+
+  // more blocks than workers, and more submissions than the task arena holds
+  for (int round = 0; round < 8; ++round) {
+    pool.submit_blocks(
+            0,
+            n,
+            [&data](const int start, const int end) {
+              for (int i = start; i < end; ++i) ++data[i];
+            },
+            1000)
+        .wait();
+  }
+
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(data[i], 8) << "at index " << i;
+  }
+}
+
+TEST(WorkStealingPoolTest, NestedSubmissionFromWorker) {
+  core::work_stealing_pool pool(2);
+
+  std::atomic<int> counter(0);
+
+  pool.submit_task([&] {
+        // waiting inside a worker must not deadlock the pool
+        pool.submit_blocks(
+                0,
+                64,
+                [&counter](const int start, const int end) {
+                  counter += end - start;
+                },
+                16)
+            .wait();
+      })
+      .wait();
+
+  EXPECT_EQ(counter.load(), 64);
+}
+
+TEST(WorkStealingPoolTest, NestedSubmissionOverflowsDeque) {
+  core::work_stealing_pool pool(2);
+
+  std::atomic<int> counter(0);
+
+  // far more blocks than the worker's deque holds, the rest spill over to the
+  // injection queue
+  pool.submit_task([&] {
+        pool.submit_blocks(
+                0,
+                10'000,
+                [&counter](const int start, const int end) {
+                  counter += end - start;
+                },
+                5000)
+            .wait();
+      })
+      .wait();
+
+  EXPECT_EQ(counter.load(), 10'000);
+}
+
+TEST(WorkStealingPoolTest, NestedSubmissionsOverflowInjection) {
+  core::work_stealing_pool pool(2);
+
+  std::atomic<int> counter(0);
+
+  // both workers fill their deques and then the injection queue, each has to
+  // run queued blocks itself to make room for the rest
+  const auto outer = [&] {
+    pool.submit_blocks(
+            0,
+            10'000,
+            [&counter](const int start, const int end) {
+              counter += end - start;
+            },
+            5000)
+        .wait();
+  };
+  auto first = pool.submit_task(outer);
+  auto second = pool.submit_task(outer);
+  first.wait();
+  second.wait();
+
+  EXPECT_EQ(counter.load(), 20'000);
+}
+
+TEST(WorkStealingPoolTest, BlockResultsAndExceptions) {
+  core::work_stealing_pool pool(3);
+
+  const auto sums = pool.submit_blocks(
+                            0,
+                            10,
+                            [](const int start, const int end) {
+                              int sum = 0;
+                              for (int i = start; i < end; ++i) sum += i;
+                              return sum;
+                            },
+                            3)
+                        .get();
+  EXPECT_EQ(std::accumulate(sums.begin(), sums.end(), 0), 45);
+
+  auto failing = pool.submit_blocks(
+      0, 4, [](int, int) { throw std::runtime_error("block failed"); }, 2);
+  EXPECT_THROW(failing.get(), std::runtime_error);
+}
+
 // Main function to run the tests
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
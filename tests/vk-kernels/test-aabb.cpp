@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+
+#include "test-base.hpp"
+
+class VulkanAabbKernelTest
+    : public VulkanKernelTestBase,
+      public ::testing::WithParamInterface<InitTestParams> {
+ protected:
+  void RunAabbTestWithBlocks(int n_points, int num_blocks);
+};
+
+TEST_P(VulkanAabbKernelTest, AabbTest) {
+  const auto& params = GetParam();
+  RunAabbTestWithBlocks(params.n_points, params.n_blocks);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AabbSweep,
+    VulkanAabbKernelTest,
+    ::testing::Values(InitTestParams{1, 1, "Single_1Block"},
+                      InitTestParams{1000, 4, "Small_4Blocks"},
+                      InitTestParams{640 * 480, 1, "Medium_1Block"},
+                      InitTestParams{640 * 480, 16, "Medium_16Blocks"},
+                      InitTestParams{1920 * 1080, 32, "Large_32Blocks"}));
+
+void VulkanAabbKernelTest::RunAabbTestWithBlocks(int n_points,
+                                                 int num_blocks) {
+  auto u_points = engine.buffer(n_points * sizeof(glm::vec4));
+  auto u_boxes = engine.buffer(2 * num_blocks * sizeof(glm::vec4));
+
+  // a different extent per axis, shifted off the origin
+  glm::vec3 lower(std::numeric_limits<float>::infinity());
+  glm::vec3 upper(-std::numeric_limits<float>::infinity());
+  {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dis_x(-50.0f, 30.0f);
+    std::uniform_real_distribution<float> dis_y(5.0f, 6.0f);
+    std::uniform_real_distribution<float> dis_z(1000.0f, 3000.0f);
+
+    auto points = u_points->span<glm::vec4>();
+    for (int i = 0; i < n_points; ++i) {
+      points[i] = glm::vec4(dis_x(gen), dis_y(gen), dis_z(gen), 1.0f);
+      lower = glm::min(lower, glm::vec3(points[i]));
+      upper = glm::max(upper, glm::vec3(points[i]));
+    }
+  }
+
+  struct PushConstants {
+    uint n;
+  } pc = {static_cast<uint>(n_points)};
+
+  auto algo = engine.algorithm("aabb.spv",
+                               {
+                                   u_points,
+                                   u_boxes,
+                               },
+                               sizeof(pc));
+  algo->set_push_constants(pc);
+
+  auto seq = engine.sequence();
+  seq->record_commands_with_blocks(algo.get(), num_blocks);
+  seq->launch_kernel_async();
+  seq->sync();
+
+  // merge the per-workgroup boxes. min/max are exact, so no tolerance
+  auto boxes = u_boxes->span<glm::vec4>();
+  glm::vec3 gpu_lower(std::numeric_limits<float>::infinity());
+  glm::vec3 gpu_upper(-std::numeric_limits<float>::infinity());
+  for (int g = 0; g < num_blocks; ++g) {
+    gpu_lower = glm::min(gpu_lower, glm::vec3(boxes[2 * g]));
+    gpu_upper = glm::max(gpu_upper, glm::vec3(boxes[2 * g + 1]));
+  }
+
+  for (int axis = 0; axis < 3; ++axis) {
+    EXPECT_EQ(gpu_lower[axis], lower[axis]) << "min of axis " << axis;
+    EXPECT_EQ(gpu_upper[axis], upper[axis]) << "max of axis " << axis;
+  }
+}
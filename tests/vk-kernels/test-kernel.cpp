@@ -0,0 +1,41 @@
+#include "test-base.hpp"
+
+// Algorithms of the same shader share the compiled kernel, and each still
+// writes its own buffers.
+TEST_F(VulkanKernelTestBase, AlgorithmsShareKernels) {
+  struct {
+    int n;
+    float min_coord;
+    float range;
+    int seed;
+  } pc = {1024, min_coord, range, seed};
+
+  auto u_a = engine.buffer(pc.n * sizeof(glm::vec4));
+  auto u_b = engine.buffer(pc.n * sizeof(glm::vec4));
+  u_a->zeros();
+  u_b->zeros();
+
+  const auto n_kernels = engine.n_kernels();
+  auto a = engine.algorithm("init.spv", {u_a}, sizeof(pc));
+  auto b = engine.algorithm("init.spv", {u_b}, sizeof(pc));
+  EXPECT_EQ(&a->kernel(), &b->kernel());
+  EXPECT_EQ(engine.n_kernels(), n_kernels + 1);
+
+  // another layout is another kernel
+  auto c = engine.algorithm("init.spv", {u_a, u_b}, sizeof(pc));
+  EXPECT_NE(&a->kernel(), &c->kernel());
+  EXPECT_EQ(engine.n_kernels(), n_kernels + 2);
+
+  a->set_push_constants(pc);
+  b->set_push_constants(pc);
+  auto seq = engine.sequence();
+  seq->cmd_begin();
+  seq->record_dispatch(a.get(), 1);
+  seq->record_dispatch(b.get(), 1);
+  seq->cmd_end();
+  seq->launch_kernel_async();
+  seq->sync();
+
+  ValidatePoints(u_a->span<glm::vec4>(), min_coord, range);
+  ValidatePoints(u_b->span<glm::vec4>(), min_coord, range);
+}
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
 #include "test-base.hpp"
 
 class VulkanMergeSortKernelsParamTest
@@ -104,3 +108,84 @@ void VulkanMergeSortKernelsParamTest::RunMergeSortTestWithBlocks(
   EXPECT_FALSE(buf_b_sorted);
   EXPECT_NE(buf_a_sorted, buf_b_sorted);
 }
+
+// ---------------------------------------------------------------------------
+// Key-value variant
+// ---------------------------------------------------------------------------
+
+class VulkanMergeSortKVKernelsParamTest
+    : public VulkanKernelTestBase,
+      public ::testing::WithParamInterface<InitTestParams> {};
+
+TEST_P(VulkanMergeSortKVKernelsParamTest, MergeSortKVTest) {
+  const auto& params = GetParam();
+  const auto n_points = params.n_points;
+
+  struct PushConstants {
+    uint32_t n_logical_blocks;
+    uint32_t n;
+    uint32_t width;
+    uint32_t num_pairs;
+  };
+
+  auto u_keys = engine.typed_buffer<uint32_t>(n_points);
+  u_keys->random(1, n_points);
+  auto u_keys_alt = engine.typed_buffer<uint32_t>(n_points);
+  u_keys_alt->zeros();
+
+  auto u_values = engine.typed_buffer<uint32_t>(n_points);
+  std::iota(u_values->begin(), u_values->end(), 0u);
+  auto u_values_alt = engine.typed_buffer<uint32_t>(n_points);
+  u_values_alt->zeros();
+
+  const std::vector<uint32_t> original(u_keys->begin(), u_keys->end());
+
+  auto algorithm =
+      engine.algorithm("merge_sort_kv.spv",
+                       {u_keys, u_keys_alt, u_values, u_values_alt},
+                       sizeof(PushConstants));
+  auto seq = engine.sequence();
+
+  constexpr auto threads_per_block = 256;
+
+  for (int width = 1; width < n_points; width *= 2) {
+    int num_pairs = (n_points + 2 * width - 1) / (2 * width);
+    int logical_blocks =
+        (num_pairs + threads_per_block - 1) / threads_per_block;
+
+    const PushConstants pc = {uint32_t(logical_blocks),
+                              uint32_t(n_points),
+                              uint32_t(width),
+                              uint32_t(num_pairs)};
+    algorithm->set_push_constants(pc);
+    algorithm->update_descriptor_sets_with_buffers(
+        {u_keys, u_keys_alt, u_values, u_values_alt});
+
+    seq->record_commands_with_blocks(algorithm.get(), params.n_blocks);
+    seq->launch_kernel_async();
+    seq->sync();
+
+    std::swap(u_keys, u_keys_alt);
+    std::swap(u_values, u_values_alt);
+  }
+
+  // every payload must point back at its key, and ties keep input order
+  std::vector<uint32_t> expected(n_points);
+  std::iota(expected.begin(), expected.end(), 0u);
+  std::ranges::stable_sort(
+      expected, [&](auto a, auto b) { return original[a] < original[b]; });
+
+  EXPECT_TRUE(std::ranges::is_sorted(*u_keys));
+  EXPECT_TRUE(std::ranges::equal(*u_values, expected));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    MergeSortKVSweep,
+    VulkanMergeSortKVKernelsParamTest,
+    ::testing::Values(InitTestParams{1024, 1, "Small_1Block"},
+                      InitTestParams{640 * 48, 2, "Medium_2Blocks"},
+                      InitTestParams{99999, 3, "Irregular_3Blocks"},
+                      InitTestParams{124, 4, "Irregular_4Blocks"}),
+    [](const testing::TestParamInfo<InitTestParams>& info) {
+      return info.param.name;
+    });
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <functional>
+#include <numeric>
 #include <random>
 
 #include "test-base.hpp"
@@ -43,16 +46,26 @@ void VulkanMortonKernelTest::RunMortonTestWithBlocks(int n_points,
 
   u_morton_keys->zeros();
 
+  // the fixed cube
+  auto u_box = engine.buffer(2 * sizeof(glm::vec4));
+  u_box->span<glm::vec4>()[0] = glm::vec4(min_coord);
+  u_box->span<glm::vec4>()[1] = glm::vec4(range);
+
+  // AND and OR of all keys
+  auto u_key_bits = engine.buffer(2 * sizeof(uint));
+  u_key_bits->span<uint>()[0] = ~0u;
+  u_key_bits->span<uint>()[1] = 0u;
+
   struct PushConstants {
     uint n;
-    float min_coord;
-    float range;
-  } pc = {static_cast<uint>(n_points), min_coord, range};
+  } pc = {static_cast<uint>(n_points)};
 
   auto algo = engine.algorithm("morton.spv",
                                {
                                    u_points,
                                    u_morton_keys,
+                                   u_box,
+                                   u_key_bits,
                                },
                                sizeof(pc));
   algo->set_push_constants(pc);
@@ -64,6 +77,15 @@ void VulkanMortonKernelTest::RunMortonTestWithBlocks(int n_points,
 
   auto morton_keys = u_morton_keys->span<uint32_t>();
 
+  EXPECT_EQ(u_key_bits->span<uint>()[0],
+            std::reduce(morton_keys.begin(),
+                        morton_keys.end(),
+                        ~0u,
+                        std::bit_and{}));
+  EXPECT_EQ(u_key_bits->span<uint>()[1],
+            std::reduce(
+                morton_keys.begin(), morton_keys.end(), 0u, std::bit_or{}));
+
   std::ranges::sort(morton_keys);
 
   // check if the morton keys are sorted
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "host/brt_func.hpp"
+#include "shared/edge_func.h"
+#include "shared/oct_func.h"
+#include "shared/structures.h"
+#include "test-base.hpp"
+#include "vulkan/pipe.hpp"
+
+namespace {
+
+// number of indices where 'gpu(i) != cpu(i)'
+template <typename Gpu, typename Cpu>
+int count_mismatches(const int n, Gpu gpu, Cpu cpu) {
+  int mismatches = 0;
+  for (int i = 0; i < n; ++i) {
+    mismatches += gpu(i) != cpu(i);
+  }
+  return mismatches;
+}
+
+// 'u_points' uniform in '[min_coord, min_coord + extent)' on every axis
+void fill_uniform(vk::Pipe& pipe, const float extent) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution dis(min_coord, min_coord + extent);
+  for (auto& point : *pipe.u_points) {
+    point = glm::vec4(dis(gen), dis(gen), dis(gen), 1.0f);
+  }
+}
+
+}  // namespace
+
+// The whole device pipeline of 'vk::Pipe' against the CPU stages run on the
+// host over the same points.
+class VulkanPipeTest : public VulkanKernelTestBase,
+                       public ::testing::WithParamInterface<InitTestParams> {
+ protected:
+  void RunPipeTest(int n_points, const vk::PipeTuning& tuning = {});
+  void RunBoundsTest(int n_points, shared::BoundsMode mode);
+  // every stage of the last 'run()' against the CPU, for the kFixed cube
+  void ExpectMatchesCpu(const vk::Pipe& pipe);
+};
+
+TEST_P(VulkanPipeTest, MatchesCpu) { RunPipeTest(GetParam().n_points); }
+
+// other workgroup sizes and tiles, through specialization constants
+TEST_P(VulkanPipeTest, MatchesCpuWithSmallWorkgroups) {
+  RunPipeTest(GetParam().n_points,
+              {
+                  .morton_threads = 64,
+                  .sort_threads = 64,
+                  .items_per_thread = 4,
+                  .scan_threads = 64,
+                  .unique_threads = 64,
+                  .brt_threads = 64,
+                  .clear_threads = 64,
+                  .edge_threads = 64,
+                  .octree_threads = 64,
+              });
+}
+
+// Points in a corner of the cube leave the high bits of every key zero, and
+// the sort only visits the digits that vary (odd counts copy the keys back).
+TEST_P(VulkanPipeTest, SkipsConstantDigits) {
+  const auto n_points = GetParam().n_points;
+  // 'extent' cells per axis -> passes of at most 8 bits over 3 * log2(extent)
+  for (const auto [extent, n_passes] :
+       {std::pair{4.0f, 1}, std::pair{64.0f, 3}}) {
+    vk::Pipe pipe(engine, n_points, min_coord, range);
+    pipe.bounds_mode = shared::BoundsMode::kFixed;
+    fill_uniform(pipe, extent);
+
+    pipe.run();
+
+    // planned on the device, from the keys' AND and OR as on the host
+    morton_t and_bits = ~0u;
+    morton_t or_bits = 0;
+    for (const auto key : *pipe.u_morton) {
+      and_bits &= key;
+      or_bits |= key;
+    }
+    const auto expected =
+        shared::make_radix_plan(and_bits, or_bits, shared::kMinRadixBits);
+    const auto plan = pipe.radix_plan();
+    ASSERT_EQ(plan.n_passes, n_passes) << "extent " << extent;
+    ASSERT_EQ(plan.n_passes, expected.n_passes) << "extent " << extent;
+    for (int pass = 0; pass < plan.n_passes; ++pass) {
+      EXPECT_EQ(plan.passes[pass].shift, expected.passes[pass].shift);
+      EXPECT_EQ(plan.passes[pass].bits, expected.passes[pass].bits);
+    }
+    ExpectMatchesCpu(pipe);
+  }
+}
+
+// Pairs of points in neighboring cells, each pair alone in a cell 8 wide,
+// give chains of single-child nodes and more octree nodes than points. The
+// pipe grows the arrays it guessed from the point count.
+TEST_P(VulkanPipeTest, OctreeGrowsPastFirstGuess) {
+  const auto n_points = GetParam().n_points;
+  vk::Pipe pipe(engine, n_points, min_coord, range);
+  pipe.bounds_mode = shared::BoundsMode::kFixed;
+  const auto first_guess = pipe.oct_capacity();
+
+  auto* points = pipe.u_points->data();
+  for (int i = 0; i < n_points; ++i) {
+    const auto pair = i / 2;
+    const glm::vec3 cell(8 * (pair % 128) + i % 2,
+                         8 * (pair / 128 % 128),
+                         8 * (pair / (128 * 128)));
+    points[i] = glm::vec4(glm::vec3(min_coord) + cell + 0.5f, 1.0f);
+  }
+
+  pipe.run();
+
+  EXPECT_GT(pipe.oct_capacity(), first_guess);
+  ExpectMatchesCpu(pipe);
+}
+
+// the quantization box reduced on the device, as 'BasicPipe::set_bounds'
+TEST_P(VulkanPipeTest, AabbBoundsMatchCpu) {
+  RunBoundsTest(GetParam().n_points, shared::BoundsMode::kAabb);
+}
+
+TEST_P(VulkanPipeTest, PerAxisBoundsMatchCpu) {
+  RunBoundsTest(GetParam().n_points, shared::BoundsMode::kPerAxis);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PipeSweep,
+    VulkanPipeTest,
+    ::testing::Values(InitTestParams{1024, 1, "Small"},
+                      InitTestParams{12345, 1, "Irregular"},
+                      InitTestParams{640 * 480, 1, "Medium"}),
+    [](const testing::TestParamInfo<InitTestParams>& info) {
+      return info.param.name;
+    });
+
+void VulkanPipeTest::RunPipeTest(const int n_points,
+                                 const vk::PipeTuning& tuning) {
+  vk::Pipe pipe(engine, n_points, min_coord, range, tuning);
+  // the fixed cube maps every cell exactly, so the codes are bit-identical to
+  // the CPU ones (see RunBoundsTest for the measured boxes)
+  pipe.bounds_mode = shared::BoundsMode::kFixed;
+  fill_uniform(pipe, range);
+
+  pipe.run();
+
+  ExpectMatchesCpu(pipe);
+}
+
+void VulkanPipeTest::ExpectMatchesCpu(const vk::Pipe& pipe) {
+  const auto n_points = pipe.n_input();
+
+  // sort and unique
+  std::vector<morton_t> keys(n_points);
+  std::ranges::transform(*pipe.u_points, keys.begin(), [](const auto& point) {
+    return shared::xyz_to_morton32(point, min_coord, range);
+  });
+  std::ranges::sort(keys);
+  EXPECT_TRUE(std::ranges::equal(keys, *pipe.u_morton));
+
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  const auto n_unique = static_cast<int>(keys.size());
+  const auto n_brt_nodes = n_unique - 1;
+  ASSERT_EQ(pipe.n_unique(), n_unique);
+  ASSERT_EQ(pipe.n_brt_nodes(), n_brt_nodes);
+  EXPECT_TRUE(std::equal(keys.begin(), keys.end(), pipe.u_morton_alt->begin()));
+
+  // radix tree
+  RadixTree brt(n_brt_nodes);
+  brt.set_n_nodes(n_brt_nodes);
+  for (int i = 0; i < n_brt_nodes; ++i) {
+    cpu::process_radix_tree_i(i, n_brt_nodes, keys.data(), &brt);
+  }
+  const auto cpu_brt = brt.view<shared::BrtLayout::kSoA>();
+  const auto gpu_brt = pipe.brt();
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return gpu_brt.prefix_n(i); },
+                [&](const int i) { return cpu_brt.prefix_n(i); }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return gpu_brt.left_child(i); },
+                [&](const int i) { return cpu_brt.left_child(i); }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return gpu_brt.has_leaf_left(i); },
+                [&](const int i) { return cpu_brt.has_leaf_left(i); }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return gpu_brt.has_leaf_right(i); },
+                [&](const int i) { return cpu_brt.has_leaf_right(i); }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return gpu_brt.parent(i); },
+                [&](const int i) { return cpu_brt.parent(i); }),
+            0);
+
+  // edge counts and offsets
+  std::vector<int> edge_counts(n_brt_nodes);
+  std::vector<int> edge_offsets(n_brt_nodes);
+  for (int i = 0; i < n_brt_nodes; ++i) {
+    shared::process_edge_count_i(i, cpu_brt, edge_counts.data());
+  }
+  std::inclusive_scan(
+      edge_counts.begin(), edge_counts.end(), edge_offsets.begin());
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return pipe.u_edge_counts->at(i); },
+                [&](const int i) { return edge_counts[i]; }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                n_brt_nodes,
+                [&](const int i) { return pipe.u_edge_offsets->at(i); },
+                [&](const int i) { return edge_offsets[i]; }),
+            0);
+
+  // Octree. Every node is written by one radix tree node, placed as on the
+  // CPU, so every node the CPU writes must match. The root cell is never
+  // written.
+  const auto n_oct_nodes = pipe.n_oct_nodes();
+  ASSERT_EQ(n_oct_nodes, edge_offsets.back() + 1);
+  const auto capacity = n_oct_nodes;
+  ASSERT_LE(capacity, pipe.oct_capacity());
+
+  std::vector<std::array<int, 8>> children(capacity);
+  std::ranges::fill(children, std::array{-1, -1, -1, -1, -1, -1, -1, -1});
+  std::vector<glm::vec4> corner(capacity);
+  std::vector<float> cell_size(capacity, -1.0f);
+  std::vector<int> child_node_mask(capacity, 0);
+  std::vector<int> child_leaf_mask(capacity, 0);
+  auto* const cpu_children = reinterpret_cast<int(*)[8]>(children.data());
+  for (int i = 1; i < n_brt_nodes; ++i) {
+    shared::process_oct_node(i,
+                             cpu_children,
+                             corner.data(),
+                             cell_size.data(),
+                             child_node_mask.data(),
+                             edge_offsets.data(),
+                             edge_counts.data(),
+                             keys.data(),
+                             cpu_brt,
+                             pipe.box_min(),
+                             pipe.box_range());
+  }
+  for (int i = 0; i < n_brt_nodes; ++i) {
+    shared::process_link_leaf(i,
+                              cpu_children,
+                              child_leaf_mask.data(),
+                              edge_offsets.data(),
+                              edge_counts.data(),
+                              keys.data(),
+                              cpu_brt);
+  }
+
+  const auto written = [&](const int i) { return cell_size[i] >= 0.0f; };
+  EXPECT_EQ(count_mismatches(
+                capacity,
+                [&](const int i) {
+                  return written(i) ? pipe.u_corner->at(i) : glm::vec4(0.0f);
+                },
+                [&](const int i) {
+                  return written(i) ? corner[i] : glm::vec4(0.0f);
+                }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                capacity,
+                [&](const int i) {
+                  return written(i) ? pipe.u_cell_size->at(i) : 0.0f;
+                },
+                [&](const int i) { return written(i) ? cell_size[i] : 0.0f; }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                capacity,
+                [&](const int i) { return pipe.u_child_node_mask->at(i); },
+                [&](const int i) { return child_node_mask[i]; }),
+            0);
+  EXPECT_EQ(count_mismatches(
+                capacity,
+                [&](const int i) { return pipe.u_child_leaf_mask->at(i); },
+                [&](const int i) { return child_leaf_mask[i]; }),
+            0);
+  // the child slots the CPU set, nodes and leaves
+  EXPECT_EQ(count_mismatches(
+                capacity * 8,
+                [&](const int i) {
+                  const auto cpu = children[i / 8][i % 8];
+                  return cpu < 0 ? cpu : pipe.u_children->at(i / 8)[i % 8];
+                },
+                [&](const int i) { return children[i / 8][i % 8]; }),
+            0);
+}
+
+void VulkanPipeTest::RunBoundsTest(const int n_points,
+                                   const shared::BoundsMode mode) {
+  vk::Pipe pipe(engine, n_points, min_coord, range);
+  pipe.bounds_mode = mode;
+
+  // a different extent per axis, shifted off the fixed cube, each at least a
+  // few cells wide in the kAabb cube. The first two points are the box
+  // corners, so the bounding box is known up front.
+  const glm::vec3 lower(-50.0f, 5.0f, 1000.0f);
+  const glm::vec3 upper(30.0f, 15.0f, 3000.0f);
+  const auto box =
+      shared::make_quantization_box(mode, {lower, upper}, min_coord, range);
+
+  // The division by the range is not correctly rounded on every GPU, so the
+  // other points sit at cell centers, far from where rounding could move them
+  // to the neighboring cell
+  {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> cell(0, 1023);
+    const auto center = [&](const int axis) {
+      // the last cell that lies wholly inside the box
+      const auto last = static_cast<int>((upper[axis] - lower[axis]) /
+                                         box.range[axis] * 1024.0f) -
+                        1;
+      const auto c = static_cast<float>(std::min(cell(gen), last));
+      return lower[axis] + (c + 0.5f) / 1024.0f * box.range[axis];
+    };
+
+    auto* points = pipe.u_points->data();
+    points[0] = glm::vec4(lower, 1.0f);
+    points[1] = glm::vec4(upper, 1.0f);
+    for (int i = 2; i < n_points; ++i) {
+      points[i] = glm::vec4(center(0), center(1), center(2), 1.0f);
+    }
+  }
+
+  pipe.run();
+
+  // min/max and the padding are exact, so is the box
+  for (int axis = 0; axis < 3; ++axis) {
+    EXPECT_EQ(pipe.box_min()[axis], box.min[axis]) << "axis " << axis;
+    EXPECT_EQ(pipe.box_range()[axis], box.range[axis]) << "axis " << axis;
+  }
+
+  std::vector<morton_t> keys(n_points);
+  std::ranges::transform(*pipe.u_points, keys.begin(), [&](const auto& point) {
+    return shared::xyz_to_morton32(point, box.min, box.range);
+  });
+  std::ranges::sort(keys);
+  EXPECT_TRUE(std::ranges::equal(keys, *pipe.u_morton));
+}
@@ -0,0 +1,85 @@
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "test-base.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+VkPhysicalDeviceProperties fake_properties() {
+  VkPhysicalDeviceProperties properties = {};
+  properties.vendorID = 0x13b5;
+  properties.deviceID = 0x92020010;
+  properties.driverVersion = 42;
+  for (uint8_t i = 0; i < VK_UUID_SIZE; ++i) {
+    properties.pipelineCacheUUID[i] = i;
+  }
+  return properties;
+}
+
+std::vector<std::byte> header_for(
+    const VkPhysicalDeviceProperties& properties) {
+  VkPipelineCacheHeaderVersionOne header = {};
+  header.headerSize = sizeof(header);
+  header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  std::memcpy(header.pipelineCacheUUID,
+              properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+
+  std::vector<std::byte> data(sizeof(header));
+  std::memcpy(data.data(), &header, sizeof(header));
+  return data;
+}
+
+}  // namespace
+
+TEST(PipelineCacheTest, AcceptsOnlyItsOwnDevice) {
+  const auto properties = fake_properties();
+  const auto data = header_for(properties);
+  EXPECT_TRUE(PipelineCache::is_compatible(data, properties));
+
+  // truncated
+  EXPECT_FALSE(PipelineCache::is_compatible(
+      {data.begin(), data.end() - 1}, properties));
+
+  auto other = properties;
+  other.deviceID += 1;
+  EXPECT_FALSE(PipelineCache::is_compatible(data, other));
+
+  other = properties;
+  other.pipelineCacheUUID[0] ^= 1;
+  EXPECT_FALSE(PipelineCache::is_compatible(data, other));
+}
+
+TEST(PipelineCacheTest, FileNameChangesWithDriver) {
+  auto properties = fake_properties();
+  const auto name = PipelineCache::file_name(properties);
+  properties.driverVersion += 1;
+  EXPECT_NE(PipelineCache::file_name(properties), name);
+}
+
+// A second engine starts from what the first one saved.
+TEST(PipelineCacheTest, PersistsAcrossEngines) {
+  const auto dir = fs::temp_directory_path() / "ppl-test-pipeline-cache";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  {
+    Engine engine(true, dir);
+    EXPECT_EQ(engine.pipeline_cache()->loaded_size(), 0u);
+    auto u_points = engine.buffer(1024 * sizeof(glm::vec4));
+    auto algo = engine.algorithm("init.spv", {u_points}, 16);
+  }
+
+  {
+    Engine engine(true, dir);
+    EXPECT_TRUE(fs::exists(engine.pipeline_cache()->path()));
+    EXPECT_GT(engine.pipeline_cache()->loaded_size(), 0u);
+  }
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "test-base.hpp"
+
+// Several dispatches recorded into one 'Sequence', which places the barriers
+// from the accesses the algorithms declare.
+class VulkanSequenceTest : public VulkanKernelTestBase {
+ protected:
+  static constexpr uint32_t kBlockSize = 256;  // of naive_prefix_sum.comp
+
+  struct PushConstants {
+    uint32_t n;
+    uint32_t block_size;
+  };
+
+  // A two pass prefix sum of ones: naive_prefix_sum.spv scans each block,
+  // block_add.spv adds the totals of the blocks before it.
+  struct PrefixSum {
+    std::shared_ptr<Buffer> input;
+    std::shared_ptr<Buffer> output;
+    std::shared_ptr<Algorithm> local;
+    std::shared_ptr<Algorithm> add;
+  };
+
+  PrefixSum MakePrefixSum(const uint32_t n) {
+    const auto n_blocks = (n + kBlockSize - 1) / kBlockSize;
+
+    PrefixSum scan;
+    scan.input = engine.buffer(n * sizeof(uint32_t));
+    scan.input->ones();
+    scan.output = engine.buffer(n * sizeof(uint32_t));
+    scan.output->zeros();
+    auto block_sums = engine.buffer(n_blocks * sizeof(uint32_t));
+    block_sums->zeros();
+
+    scan.local = engine.algorithm(
+        "naive_prefix_sum.spv",
+        {scan.input, scan.output, block_sums},
+        sizeof(PushConstants),
+        {BufferAccess::kRead, BufferAccess::kWrite, BufferAccess::kWrite});
+    scan.add =
+        engine.algorithm("block_add.spv",
+                         {block_sums, scan.output},
+                         sizeof(PushConstants),
+                         {BufferAccess::kRead, BufferAccess::kReadWrite});
+    return scan;
+  }
+
+  static void ExpectPrefixSum(const PrefixSum& scan, const uint32_t n) {
+    std::vector<uint32_t> expected(n);
+    std::inclusive_scan(scan.input->span<uint32_t>().begin(),
+                        scan.input->span<uint32_t>().end(),
+                        expected.begin());
+    EXPECT_TRUE(std::ranges::equal(scan.output->span<uint32_t>(), expected));
+  }
+};
+
+TEST_F(VulkanSequenceTest, DependentDispatchesInOneSubmit) {
+  constexpr uint32_t n = 12345;
+  constexpr uint32_t n_blocks = (n + kBlockSize - 1) / kBlockSize;
+  const auto scan = MakePrefixSum(n);
+  const PushConstants pc = {n, kBlockSize};
+
+  auto seq = engine.sequence();
+  seq->cmd_begin();
+  seq->record_dispatch(scan.local.get(), pc, n_blocks);
+  seq->record_dispatch(scan.add.get(), pc, n_blocks);
+  seq->cmd_end();
+  seq->launch_kernel_async();
+  seq->sync();
+
+  // one between the passes, one for the host
+  EXPECT_EQ(seq->n_recorded_barriers(), 2);
+  ExpectPrefixSum(scan, n);
+}
+
+TEST_F(VulkanSequenceTest, IndependentDispatchesShareBarriers) {
+  constexpr uint32_t n = 4096;
+  constexpr uint32_t n_blocks = n / kBlockSize;
+  const auto a = MakePrefixSum(n);
+  const auto b = MakePrefixSum(n);
+  const PushConstants pc = {n, kBlockSize};
+
+  auto seq = engine.sequence();
+  seq->cmd_begin();
+  seq->record_dispatch(a.local.get(), pc, n_blocks);
+  seq->record_dispatch(b.local.get(), pc, n_blocks);
+  seq->record_dispatch(a.add.get(), pc, n_blocks);
+  seq->record_dispatch(b.add.get(), pc, n_blocks);
+  seq->cmd_end();
+  seq->launch_kernel_async();
+  seq->sync();
+
+  EXPECT_EQ(seq->n_recorded_barriers(), 2);
+  ExpectPrefixSum(a, n);
+  ExpectPrefixSum(b, n);
+}
+
+TEST_F(VulkanSequenceTest, RerecordingResetsTracking) {
+  constexpr uint32_t n = 1000;
+  constexpr uint32_t n_blocks = (n + kBlockSize - 1) / kBlockSize;
+  const auto scan = MakePrefixSum(n);
+  const PushConstants pc = {n, kBlockSize};
+
+  auto seq = engine.sequence();
+  for (int frame = 0; frame < 3; ++frame) {
+    scan.output->zeros();
+    seq->cmd_begin();
+    seq->record_dispatch(scan.local.get(), pc, n_blocks);
+    seq->record_dispatch(scan.add.get(), pc, n_blocks);
+    seq->cmd_end();
+    seq->launch_kernel_async();
+    seq->sync();
+
+    EXPECT_EQ(seq->n_recorded_barriers(), 2);
+    ExpectPrefixSum(scan, n);
+  }
+}
@@ -26,6 +26,33 @@ target("test-threadpool")
     if is_plat("android") then on_run(run_on_android) end
 target_end()
 
+target("test-sort")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("foundations/test-sort.cpp")
+    add_deps("ppl")
+    add_packages("gtest", "glm")
+    if is_plat("android") then on_run(run_on_android) end
+target_end()
+
+target("test-morton")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("foundations/test-morton.cpp")
+    add_deps("ppl")
+    add_packages("gtest", "glm")
+    if is_plat("android") then on_run(run_on_android) end
+target_end()
+
+target("test-pipeline")
+    set_kind("binary")
+    add_includedirs("$(projectdir)/include")
+    add_files("foundations/test-pipeline.cpp")
+    add_deps("ppl")
+    add_packages("gtest", "glm")
+    if is_plat("android") then on_run(run_on_android) end
+target_end()
+
 -- ---------------------------------------------------------------------
 -- Thread Pinning
 -- ---------------------------------------------------------------------
@@ -65,7 +92,8 @@ target("test-vk-kernels")
     set_kind("binary")
     add_includedirs("$(projectdir)/include")
     add_files("vk-kernels/*.cpp")
-    add_deps("ppl-vulkan")
+    add_deps("ppl-vulkan", "ppl")
     add_packages("gtest", "glm", "spdlog", "volk", "vulkan-memory-allocator")
     if is_plat("android") then on_run(run_on_android) end
+    after_build(compile_shaders)
 target_end()
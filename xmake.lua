@@ -29,6 +29,17 @@ if is_plat("android") then
     package_end()
 end
 
+-- Hot-path tracing (include/core/trace.hpp), off by default
+option("trace")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Record per-stage and per-worker trace events")
+option_end()
+
+if has_config("trace") then
+    add_defines("PPL_TRACE")
+end
+
 -- Application requires
 add_requires("glm 1.0.*", {alias = "glm"})
 add_requires("spdlog")
@@ -126,6 +137,20 @@ function run_on_android(target)
     end
 end
 
+-- Compiles every compute shader to SPIR-V, after the build of any target that
+-- loads them. A shader that does not compile fails the build.
+function compile_shaders()
+    local shader_files = os.files("$(projectdir)/ppl/vulkan/shaders/*.comp")
+
+    for _, shader_file in ipairs(shader_files) do
+        local output_path = "$(projectdir)/ppl/vulkan/shaders/compiled_shaders/" .. path.basename(shader_file) .. ".spv"
+        -- local command = "glslangValidator --target-env vulkan1.2 -e main -o " .. output_path .. " " .. shader_file
+        local command = "glslangValidator -V --target-env spirv1.3 " .. shader_file .. " -o " .. output_path
+        print(command)
+        os.run(command)
+    end
+end
+
 --
 
 includes("ppl")